@@ -0,0 +1,363 @@
+/**
+ * Copyright 2022 hupeng.
+ * SPDX-License-Identifier: MIT
+ */
+#include <benchmark/benchmark.h>
+#include <fcntl.h>
+#include <llvm/Object/ELF.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <spdlog/fmt/fmt.h>
+#include <unistd.h>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "address_index.h"
+#include "elf.h"
+#include "output.h"
+#include "string_index.h"
+#include "synthetic_elf.h"
+
+namespace {
+
+const std::size_t kNameLength = 24;
+const std::size_t kBatch = 1024;
+
+// Generated files, shared by all benchmarks of a run and removed at exit.
+class SyntheticFiles {
+ public:
+  ~SyntheticFiles() {
+    for (const auto& it : m_paths_) {
+      std::remove(it.second.c_str());
+    }
+  }
+
+  const std::string& Get(std::size_t symbols, std::size_t sections) {
+    auto key = std::make_pair(symbols, sections);
+    auto it = m_paths_.find(key);
+    if (it != m_paths_.end())
+      return it->second;
+
+    auto path = std::filesystem::temp_directory_path() /
+                fmt::format("elfstudy-bench-{}-{}-{}.so", getpid(), symbols,
+                            sections);
+    xorg::SyntheticElfSpec spec;
+    spec.symbols = symbols;
+    spec.sections = sections;
+    spec.name_length = kNameLength;
+    if (!xorg::WriteSyntheticElf(path.string(), spec))
+      std::abort();
+    return m_paths_[key] = path.string();
+  }
+
+ private:
+  std::map<std::pair<std::size_t, std::size_t>, std::string> m_paths_;
+};
+
+const std::string& SyntheticFile(const benchmark::State& state) {
+  static SyntheticFiles files;
+  return files.Get(state.range(0), state.range(1));
+}
+
+// {symbols, sections}
+void Shapes(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"symbols", "sections"});
+  for (std::int64_t symbols = 1000; symbols <= 10000000; symbols *= 10) {
+    b->Args({symbols, 16});
+  }
+  b->Args({10000, 60000});
+  b->Unit(benchmark::kMicrosecond);
+}
+
+std::unique_ptr<xorg::Elf> Open(benchmark::State& state) {
+  auto elf = std::make_unique<xorg::Elf>(SyntheticFile(state));
+  if (!elf->Parse()) {
+    state.SkipWithError("parse failed");
+    return nullptr;
+  }
+  return elf;
+}
+
+// Every (symbols / kBatch)th symbol, the same set for all benchmarks.
+std::vector<std::size_t> Sample(std::size_t symbols) {
+  std::vector<std::size_t> sample;
+  for (std::size_t i = 0; i < kBatch; i++) {
+    sample.push_back(i * symbols / kBatch);
+  }
+  return sample;
+}
+
+void BM_Parse(benchmark::State& state) {
+  const auto& path = SyntheticFile(state);
+  for (auto _ : state) {
+    xorg::Elf elf(path);
+    if (!elf.Parse()) {
+      state.SkipWithError("parse failed");
+      break;
+    }
+    benchmark::DoNotOptimize(elf.Symbols().data());
+  }
+}
+BENCHMARK(BM_Parse)->Apply(Shapes);
+
+void BM_Columns(benchmark::State& state) {
+  const auto& path = SyntheticFile(state);
+  for (auto _ : state) {
+    xorg::Elf elf(path);
+    if (!elf.Parse()) {
+      state.SkipWithError("parse failed");
+      break;
+    }
+    benchmark::DoNotOptimize(elf.Columns().size());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Columns)->Apply(Shapes);
+
+void BM_SectionNames(benchmark::State& state) {
+  auto elf = Open(state);
+  if (elf == nullptr)
+    return;
+
+  for (auto _ : state) {
+    std::size_t length = 0;
+    for (const auto& sh : elf->Sections()) {
+      length += elf->SectionName(sh).size();
+    }
+    benchmark::DoNotOptimize(length);
+  }
+  state.SetItemsProcessed(state.iterations() * elf->Sections().size());
+}
+BENCHMARK(BM_SectionNames)->Apply(Shapes);
+
+void BM_SymbolNames(benchmark::State& state) {
+  auto elf = Open(state);
+  if (elf == nullptr)
+    return;
+
+  for (auto _ : state) {
+    std::size_t length = 0;
+    for (const auto& symbol : elf->Symbols()) {
+      length += elf->SymbolName(symbol).size();
+    }
+    benchmark::DoNotOptimize(length);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SymbolNames)->Apply(Shapes);
+
+void BM_FindSymbol(benchmark::State& state) {
+  auto elf = Open(state);
+  if (elf == nullptr)
+    return;
+
+  std::vector<std::string> names;
+  for (auto i : Sample(state.range(0))) {
+    names.push_back(xorg::SyntheticSymbolName(i, kNameLength));
+  }
+  // the first lookup builds the name index
+  elf->FindSymbol(names.front());
+
+  for (auto _ : state) {
+    for (const auto& name : names) {
+      benchmark::DoNotOptimize(elf->FindSymbol(name));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * names.size());
+}
+BENCHMARK(BM_FindSymbol)->Apply(Shapes);
+
+// .strtab of the file, nullptr when it has none
+const xorg::StringTab* SymbolNames(const xorg::Elf& elf) {
+  if (elf.SymbolsSection() == 0)
+    return nullptr;
+  return elf.StrTab(elf.Sections()[elf.SymbolsSection()].Link());
+}
+
+// Splitting .strtab one string at a time, as StringTab::Print used to.
+void BM_StringTabWalk(benchmark::State& state) {
+  auto elf = Open(state);
+  const auto* strtab = elf == nullptr ? nullptr : SymbolNames(*elf);
+  if (strtab == nullptr)
+    return;
+
+  for (auto _ : state) {
+    std::size_t strings = 0;
+    for (std::uint64_t offset = 0; offset < strtab->size();) {
+      offset += strnlen(strtab->data() + offset, strtab->size() - offset) + 1;
+      strings++;
+    }
+    benchmark::DoNotOptimize(strings);
+  }
+  state.SetBytesProcessed(state.iterations() * strtab->size());
+}
+BENCHMARK(BM_StringTabWalk)->Apply(Shapes);
+
+void BM_StringIndex(benchmark::State& state) {
+  auto elf = Open(state);
+  const auto* strtab = elf == nullptr ? nullptr : SymbolNames(*elf);
+  if (strtab == nullptr)
+    return;
+
+  for (auto _ : state) {
+    xorg::StringIndex index;
+    index.Build(*strtab);
+    benchmark::DoNotOptimize(index.size());
+  }
+  state.SetBytesProcessed(state.iterations() * strtab->size());
+}
+BENCHMARK(BM_StringIndex)->Apply(Shapes);
+
+void BM_AddressLookup(benchmark::State& state) {
+  auto elf = Open(state);
+  if (elf == nullptr)
+    return;
+
+  xorg::AddressIndex index;
+  index.Build(*elf);
+  std::vector<std::uint64_t> addrs;
+  for (auto i : Sample(state.range(0))) {
+    const auto& symbol = elf->Symbols()[i + 1];
+    addrs.push_back(symbol.Value() + symbol.Size() / 2);
+  }
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        index.Lookup(xorg::Span<std::uint64_t>(addrs.data(), addrs.size())));
+  }
+  state.SetItemsProcessed(state.iterations() * addrs.size());
+}
+BENCHMARK(BM_AddressLookup)->Apply(Shapes);
+
+void BM_Print(benchmark::State& state) {
+  auto elf = Open(state);
+  if (elf == nullptr)
+    return;
+
+  int fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+  for (auto _ : state) {
+    xorg::Output out(fd, static_cast<xorg::OutputFormat>(state.range(2)));
+    elf->Print(out);
+  }
+  close(fd);
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Print)
+    ->ArgNames({"symbols", "sections", "format"})
+    ->ArgsProduct({{1000, 100000, 1000000},
+                   {16},
+                   {static_cast<std::int64_t>(xorg::OutputFormat::kTable),
+                    static_cast<std::int64_t>(xorg::OutputFormat::kJsonLines),
+                    static_cast<std::int64_t>(xorg::OutputFormat::kCsv)}})
+    ->Unit(benchmark::kMillisecond);
+
+// llvm::object::ELFFile on the same files. It has no name index, so there is
+// no counterpart to BM_FindSymbol or BM_AddressLookup.
+
+using LlvmElf = llvm::object::ELF64LEFile;
+
+std::unique_ptr<llvm::MemoryBuffer> LlvmBuffer(benchmark::State& state) {
+  auto buffer = llvm::MemoryBuffer::getFile(SyntheticFile(state));
+  if (!buffer) {
+    state.SkipWithError("cannot read file");
+    return nullptr;
+  }
+  return std::move(*buffer);
+}
+
+const LlvmElf::Elf_Shdr* LlvmSymtab(const LlvmElf& file) {
+  auto sections = file.sections();
+  if (!sections) {
+    llvm::consumeError(sections.takeError());
+    return nullptr;
+  }
+  for (const auto& sec : *sections) {
+    if (sec.sh_type == llvm::ELF::SHT_SYMTAB)
+      return &sec;
+  }
+  return nullptr;
+}
+
+void BM_LlvmParse(benchmark::State& state) {
+  const auto& path = SyntheticFile(state);
+  for (auto _ : state) {
+    auto buffer = llvm::MemoryBuffer::getFile(path);
+    if (!buffer) {
+      state.SkipWithError("cannot read file");
+      break;
+    }
+    auto file = LlvmElf::create((*buffer)->getBuffer());
+    if (!file) {
+      llvm::consumeError(file.takeError());
+      state.SkipWithError("parse failed");
+      break;
+    }
+    auto symbols = file->symbols(LlvmSymtab(*file));
+    if (!symbols) {
+      llvm::consumeError(symbols.takeError());
+      state.SkipWithError("no symbols");
+      break;
+    }
+    benchmark::DoNotOptimize(symbols->begin());
+  }
+}
+BENCHMARK(BM_LlvmParse)->Apply(Shapes);
+
+void BM_LlvmSectionNames(benchmark::State& state) {
+  auto buffer = LlvmBuffer(state);
+  if (buffer == nullptr)
+    return;
+  auto file = cantFail(LlvmElf::create(buffer->getBuffer()));
+  auto sections = cantFail(file.sections());
+
+  for (auto _ : state) {
+    std::size_t length = 0;
+    for (const auto& sec : sections) {
+      auto name = file.getSectionName(sec);
+      if (name) {
+        length += name->size();
+      } else {
+        llvm::consumeError(name.takeError());
+      }
+    }
+    benchmark::DoNotOptimize(length);
+  }
+  state.SetItemsProcessed(state.iterations() * sections.size());
+}
+BENCHMARK(BM_LlvmSectionNames)->Apply(Shapes);
+
+void BM_LlvmSymbolNames(benchmark::State& state) {
+  auto buffer = LlvmBuffer(state);
+  if (buffer == nullptr)
+    return;
+  auto file = cantFail(LlvmElf::create(buffer->getBuffer()));
+  const auto* symtab = LlvmSymtab(file);
+  auto symbols = cantFail(file.symbols(symtab));
+  auto strtab = cantFail(file.getStringTableForSymtab(*symtab));
+
+  for (auto _ : state) {
+    std::size_t length = 0;
+    for (const auto& symbol : symbols) {
+      auto name = symbol.getName(strtab);
+      if (name) {
+        length += name->size();
+      } else {
+        llvm::consumeError(name.takeError());
+      }
+    }
+    benchmark::DoNotOptimize(length);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_LlvmSymbolNames)->Apply(Shapes);
+
+}  // namespace
+
+BENCHMARK_MAIN();
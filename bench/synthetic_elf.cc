@@ -0,0 +1,181 @@
+/**
+ * Copyright 2022 hupeng.
+ * SPDX-License-Identifier: MIT
+ */
+#include "synthetic_elf.h"
+
+#include <spdlog/fmt/fmt.h>
+#include <spdlog/spdlog.h>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "elf_spec.h"
+
+namespace xorg {
+
+static const std::uint64_t kTextBase = 0x1000;
+static const std::uint64_t kSymbolSize = 16;
+
+static std::uint64_t Align8(std::uint64_t offset) {
+  return (offset + 7) & ~static_cast<std::uint64_t>(7);
+}
+
+std::string SyntheticSymbolName(std::size_t idx, std::size_t name_length) {
+  auto name = fmt::format("bench_symbol_{}", idx);
+  if (name.size() < name_length)
+    name.append(name_length - name.size(), '_');
+  return name;
+}
+
+bool WriteSyntheticElf(const std::string& path, const SyntheticElfSpec& spec) {
+  const std::size_t max_sections =
+      static_cast<std::size_t>(SHNdx::SHN_LORESERVE) - 4;
+  if (spec.sections > max_sections) {
+    spdlog::error("at most {} sections can be generated", max_sections);
+    return false;
+  }
+
+  // [0] null, [1, n] .text.*, then .symtab, .strtab and .shstrtab
+  const std::uint16_t symtab = spec.sections + 1;
+  const std::uint16_t strtab = symtab + 1;
+  const std::uint16_t shstrtab = strtab + 1;
+  const std::uint16_t shnum = shstrtab + 1;
+
+  std::string shstr("\0", 1);
+  std::vector<std::uint32_t> sh_names(shnum, 0);
+  auto add_name = [&](std::uint16_t idx, const std::string& name) {
+    sh_names[idx] = shstr.size();
+    shstr.append(name).push_back('\0');
+  };
+  for (std::uint16_t i = 1; i <= spec.sections; i++) {
+    add_name(i, fmt::format(".text.{}", i));
+  }
+  add_name(symtab, ".symtab");
+  add_name(strtab, ".strtab");
+  add_name(shstrtab, ".shstrtab");
+
+  // names are regenerated while writing, only their sizes are needed here
+  std::uint64_t strtab_size = 1;
+  for (std::size_t i = 0; i < spec.symbols; i++) {
+    strtab_size += SyntheticSymbolName(i, spec.name_length).size() + 1;
+  }
+
+  const std::uint64_t strtab_offset = sizeof(Elf64_Ehdr);
+  const std::uint64_t shstrtab_offset = strtab_offset + strtab_size;
+  const std::uint64_t symtab_offset = Align8(shstrtab_offset + shstr.size());
+  const std::uint64_t symtab_size = (spec.symbols + 1) * sizeof(Elf64_Sym);
+  const std::uint64_t shoff = Align8(symtab_offset + symtab_size);
+
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  if (!file) {
+    spdlog::error("cannot create {}", path);
+    return false;
+  }
+  auto pad_to = [&](std::uint64_t offset) {
+    static const char kZero[8] = {};
+    file.write(kZero, offset - file.tellp());
+  };
+
+  Elf64_Ehdr header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.e_ident, "\x7f" "ELF", 4);
+  header.e_ident[static_cast<int>(EIdent::EI_CLASS)] =
+      static_cast<unsigned char>(EIClass::ELFCLASS64);
+  header.e_ident[static_cast<int>(EIdent::EI_DATA)] =
+      static_cast<unsigned char>(EIdata::ELFDATA2LSB);
+  header.e_ident[static_cast<int>(EIdent::EI_VERSION)] =
+      static_cast<unsigned char>(EVersion::EV_CURRENT);
+  header.e_type = static_cast<Elf64_Half>(EType::ET_DYN);
+  header.e_machine = static_cast<Elf64_Half>(EMachine::EM_X86_64);
+  header.e_version = static_cast<Elf64_Word>(EVersion::EV_CURRENT);
+  header.e_shoff = shoff;
+  header.e_ehsize = sizeof(Elf64_Ehdr);
+  header.e_phentsize = sizeof(Elf64_Phdr);
+  header.e_shentsize = sizeof(Elf64_Shdr);
+  header.e_shnum = shnum;
+  header.e_shstrndx = shstrtab;
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+  file.put('\0');
+  for (std::size_t i = 0; i < spec.symbols; i++) {
+    auto name = SyntheticSymbolName(i, spec.name_length);
+    file.write(name.c_str(), name.size() + 1);
+  }
+  file.write(shstr.data(), shstr.size());
+
+  pad_to(symtab_offset);
+  Elf64_Sym symbol;
+  std::memset(&symbol, 0, sizeof(symbol));
+  file.write(reinterpret_cast<const char*>(&symbol), sizeof(symbol));
+  symbol.st_info = static_cast<unsigned char>(STType::STT_FUNC) |
+                   (static_cast<unsigned char>(STBind::STB_GLOBAL) << 4);
+  symbol.st_size = kSymbolSize;
+  std::uint32_t name = 1;
+  for (std::size_t i = 0; i < spec.symbols; i++) {
+    symbol.st_name = name;
+    symbol.st_value = kTextBase + i * kSymbolSize;
+    symbol.st_shndx =
+        spec.sections > 0 ? 1 + i * spec.sections / spec.symbols
+                          : static_cast<Elf64_Section>(SHNdx::SHN_ABS);
+    file.write(reinterpret_cast<const char*>(&symbol), sizeof(symbol));
+    name += SyntheticSymbolName(i, spec.name_length).size() + 1;
+  }
+
+  pad_to(shoff);
+  std::vector<Elf64_Shdr> sections(shnum);
+  std::memset(sections.data(), 0, shnum * sizeof(Elf64_Shdr));
+  // the symbols of .text.i are consecutive, the section spans them
+  std::uint64_t addr = kTextBase;
+  for (std::uint16_t i = 1; i <= spec.sections; i++) {
+    std::uint64_t end =
+        kTextBase + (i * spec.symbols + spec.sections - 1) / spec.sections *
+                        kSymbolSize;
+    auto& sh = sections[i];
+    sh.sh_type = static_cast<Elf64_Word>(SHType::SHT_NOBITS);
+    sh.sh_flags = static_cast<Elf64_Xword>(SHFlags::SHF_ALLOC) |
+                  static_cast<Elf64_Xword>(SHFlags::SHF_EXECINSTR);
+    sh.sh_addr = addr;
+    sh.sh_size = end - addr;
+    sh.sh_addralign = kSymbolSize;
+    addr = end;
+  }
+
+  auto& sym = sections[symtab];
+  sym.sh_type = static_cast<Elf64_Word>(SHType::SHT_SYMTAB);
+  sym.sh_offset = symtab_offset;
+  sym.sh_size = symtab_size;
+  sym.sh_link = strtab;
+  // index of the first non-local symbol
+  sym.sh_info = 1;
+  sym.sh_addralign = 8;
+  sym.sh_entsize = sizeof(Elf64_Sym);
+
+  auto& str = sections[strtab];
+  str.sh_type = static_cast<Elf64_Word>(SHType::SHT_STRTAB);
+  str.sh_offset = strtab_offset;
+  str.sh_size = strtab_size;
+  str.sh_addralign = 1;
+
+  auto& shstr_sh = sections[shstrtab];
+  shstr_sh.sh_type = static_cast<Elf64_Word>(SHType::SHT_STRTAB);
+  shstr_sh.sh_offset = shstrtab_offset;
+  shstr_sh.sh_size = shstr.size();
+  shstr_sh.sh_addralign = 1;
+
+  for (std::uint16_t i = 1; i < shnum; i++) {
+    sections[i].sh_name = sh_names[i];
+  }
+  file.write(reinterpret_cast<const char*>(sections.data()),
+             shnum * sizeof(Elf64_Shdr));
+
+  if (!file) {
+    spdlog::error("cannot write {}", path);
+    return false;
+  }
+  return true;
+}
+
+}  // namespace xorg
@@ -0,0 +1,32 @@
+/**
+ * Copyright 2022 hupeng.
+ * SPDX-License-Identifier: MIT
+ */
+#ifndef XORG_BENCH_SYNTHETIC_ELF_H_
+#define XORG_BENCH_SYNTHETIC_ELF_H_
+
+#include <cstddef>
+#include <string>
+
+namespace xorg {
+
+// Shape of a generated file. Section counts stay below SHN_LORESERVE, the
+// parser does not implement extended section numbering.
+struct SyntheticElfSpec {
+  std::size_t symbols = 1000;
+  // PROGBITS sections besides .symtab, .strtab and .shstrtab
+  std::size_t sections = 16;
+  // symbol names are padded to at least this length
+  std::size_t name_length = 24;
+};
+
+// Writes a little endian ELF64 shared object with `spec.symbols` defined
+// functions, 16 bytes apart and spread over the sections. Symbol i is named
+// SyntheticSymbolName(i, ...).
+bool WriteSyntheticElf(const std::string& path, const SyntheticElfSpec& spec);
+
+std::string SyntheticSymbolName(std::size_t idx, std::size_t name_length);
+
+}  // namespace xorg
+
+#endif  // XORG_BENCH_SYNTHETIC_ELF_H_
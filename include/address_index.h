@@ -0,0 +1,67 @@
+/**
+ * Copyright 2022 hupeng.
+ * SPDX-License-Identifier: MIT
+ */
+#ifndef XORG_ADDRESS_INDEX_H_
+#define XORG_ADDRESS_INDEX_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "common.h"
+
+namespace xorg {
+
+class Elf;
+class SymbolColumns;
+
+// Symbol containing an address, `symbol` indexes Elf::Symbols().
+struct SymbolHit {
+  static const std::uint32_t kNoSymbol = UINT32_MAX;
+
+  std::uint32_t symbol = kNoSymbol;
+  std::uint64_t offset = 0;
+
+  bool Found() const { return symbol != kNoSymbol; }
+};
+
+// Sorted interval index over the defined STT_FUNC and STT_OBJECT symbols,
+// absolute ones excluded. Single lookups search an Eytzinger (BFS ordered)
+// copy of the start addresses, batches are sorted and merge-joined against
+// the sorted ranges. An address past a symbol nested in a larger one (asm
+// labels, objects inside functions) resolves to the enclosing symbol that
+// reaches furthest.
+class AddressIndex {
+ public:
+  AddressIndex() = default;
+  ~AddressIndex() = default;
+
+  void Build(const Elf& elf);
+  // over columns kept elsewhere, e.g. a CachedParse
+  void Build(const SymbolColumns& columns);
+
+  std::size_t size() const { return m_start_.size(); }
+
+  SymbolHit Lookup(std::uint64_t addr) const;
+  // One hit per address, in the order of `addrs`.
+  std::vector<SymbolHit> Lookup(Span<std::uint64_t> addrs) const;
+
+ private:
+  void BuildEytzinger(std::size_t& src, std::size_t k);
+  SymbolHit Hit(std::size_t rank, std::uint64_t addr) const;
+
+  // sorted by start address
+  std::vector<std::uint64_t> m_start_;
+  std::vector<std::uint64_t> m_end_;
+  std::vector<std::uint32_t> m_symbol_;
+  // per rank, the rank up to it with the largest end
+  std::vector<std::uint32_t> m_cover_;
+
+  // m_start_ in Eytzinger order, 1-based, with the sorted rank of each node
+  std::vector<std::uint64_t> m_eytzinger_;
+  std::vector<std::uint32_t> m_rank_;
+};
+
+}  // namespace xorg
+
+#endif  // XORG_ADDRESS_INDEX_H_
@@ -0,0 +1,86 @@
+/**
+ * Copyright 2022 hupeng.
+ * SPDX-License-Identifier: MIT
+ */
+#ifndef XORG_ADDRESS_SPACE_H_
+#define XORG_ADDRESS_SPACE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "common.h"
+#include "output.h"
+
+namespace xorg {
+
+class Elf;
+
+// The memory image the PT_LOAD segments of a file describe, to read data by
+// virtual address: .rodata strings, jump tables, the memory of a core.
+// Lookups binary search the segments sorted by address, after checking the
+// segment of the previous lookup, which runs of nearby reads hit.
+class AddressSpace {
+ public:
+  // more is cut by Dump(), a dump is for looking at
+  static constexpr std::uint64_t kMaxDump = 16 << 20;
+
+  // `memsz` bytes at `vaddr`, the first `filesz` of them at `offset` in the
+  // file. `data` views them, it is empty when the file is cut short.
+  struct Segment {
+    std::uint64_t vaddr;
+    std::uint64_t memsz;
+    std::uint64_t offset;
+    std::uint64_t filesz;
+    Span<char> data;
+  };
+
+  AddressSpace() = default;
+  ~AddressSpace() = default;
+
+  // `elf` outlives this. The bytes of a segment past p_filesz are zeros
+  // (.bss), in core files they are absent: the dump left them out.
+  void Build(const Elf& elf);
+
+  // sorted by vaddr
+  const std::vector<Segment>& Segments() const { return m_segments_; }
+
+  // segment holding `vaddr`, nullptr when there is none
+  const Segment* Find(std::uint64_t vaddr) const;
+  // File offset of `vaddr`, false when the file does not hold it.
+  bool ToOffset(std::uint64_t vaddr, std::uint64_t* offset) const;
+
+  // `size` bytes at `vaddr` without a copy: a view into the file, or into
+  // zeros for .bss. A range running from file bytes into .bss is assembled
+  // in `scratch`. Empty when some byte is not mapped, or the range crosses
+  // segments or needs a scratch that was not given.
+  Span<char> ReadAt(std::uint64_t vaddr,
+                    std::size_t size,
+                    std::vector<char>* scratch = nullptr) const;
+  // Copies up to `size` bytes at `vaddr` to `dst` and returns how many,
+  // stopping at the first byte that is not mapped.
+  std::size_t Read(std::uint64_t vaddr, char* dst, std::size_t size) const;
+  // NUL terminated string at `vaddr` in the file, at most `max` bytes of it.
+  std::string_view StringAt(std::uint64_t vaddr, std::size_t max = 4096) const;
+
+  // Prints up to `size` bytes at `vaddr`, 16 a line like xxd in a table and
+  // as one hex string otherwise, stopping at the first byte that is not
+  // mapped. Returns how many were printed.
+  std::uint64_t Dump(std::uint64_t vaddr,
+                     std::uint64_t size,
+                     Output& out) const;
+
+ private:
+  std::vector<Segment> m_segments_;
+  bool m_zero_fill_ = true;
+  // index of the last segment found, a hint shared by all threads
+  mutable std::atomic<std::size_t> m_last_{0};
+
+  DISALLOW_COPY_AND_ASSIGN(AddressSpace);
+};
+
+}  // namespace xorg
+
+#endif  // XORG_ADDRESS_SPACE_H_
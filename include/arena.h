@@ -0,0 +1,62 @@
+/**
+ * Copyright 2022 hupeng.
+ * SPDX-License-Identifier: MIT
+ */
+#ifndef XORG_ARENA_H_
+#define XORG_ARENA_H_
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+
+#include "common.h"
+
+namespace xorg {
+
+// Monotonic memory for one parse at a time: allocations bump a pointer and
+// deallocations are no-ops until Reset() drops everything at once. After a
+// parse that outgrew the arena, Reset() swaps its chunks for one block as
+// large as that parse's peak, so that the parses after it allocate from a
+// single block and the heap is not touched at all.
+//
+// Not thread safe, give each thread its own.
+class Arena : public std::pmr::memory_resource {
+ public:
+  explicit Arena(std::size_t initial = 64 << 10);
+  ~Arena() override = default;
+
+  // Frees everything allocated since the last Reset(). Nothing allocated
+  // from the arena may be used after this.
+  void Reset();
+
+  // bytes allocated since the last Reset(), the peak of the current parse
+  // since nothing is given back before Reset()
+  std::size_t Used() const { return m_used_; }
+  // largest Used() seen
+  std::size_t Peak() const { return m_peak_ > m_used_ ? m_peak_ : m_used_; }
+  // size of the block allocations are served from before going upstream
+  std::size_t Capacity() const { return m_capacity_; }
+
+ private:
+  void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+  void do_deallocate(void* p, std::size_t bytes, std::size_t alignment)
+      override {}
+  bool do_is_equal(const std::pmr::memory_resource& other) const
+      noexcept override {
+    return this == &other;
+  }
+
+  std::unique_ptr<char[]> m_block_;
+  std::size_t m_capacity_;
+  std::optional<std::pmr::monotonic_buffer_resource> m_resource_;
+
+  std::size_t m_used_ = 0;
+  std::size_t m_peak_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(Arena);
+};
+
+}  // namespace xorg
+
+#endif  // XORG_ARENA_H_
@@ -0,0 +1,61 @@
+/**
+ * Copyright 2022 hupeng.
+ * SPDX-License-Identifier: MIT
+ */
+#ifndef XORG_BLOAT_REPORT_H_
+#define XORG_BLOAT_REPORT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "common.h"
+#include "output.h"
+
+namespace xorg {
+
+// Symbol sizes summed by scope (see Demangler). Every namespace, class and
+// template on the way to a symbol is charged its size, so "std" holds all
+// of std:: and "std::vector<>" every instantiation of std::vector.
+class BloatReport {
+ public:
+  BloatReport();
+  ~BloatReport() = default;
+
+  // `scope` has to outlive the report
+  void Add(std::string_view scope, std::uint64_t size);
+  // The `top` largest scopes under each one, `depth` levels deep.
+  void Print(Output& out, std::size_t top, std::size_t depth) const;
+
+  std::uint64_t TotalSize() const { return m_nodes_[0].size; }
+  std::uint64_t TotalSymbols() const { return m_nodes_[0].symbols; }
+
+ private:
+  struct Node {
+    // last component, and the scope up to and including it
+    std::string_view name;
+    std::string_view path;
+    std::uint64_t size = 0;
+    std::uint64_t symbols = 0;
+    std::vector<std::uint32_t> children;
+  };
+
+  void PrintNode(Output& out,
+                 std::uint32_t idx,
+                 std::size_t level,
+                 std::size_t top,
+                 std::size_t depth) const;
+
+  // 0 is the root
+  std::vector<Node> m_nodes_;
+  // by path
+  std::unordered_map<std::string_view, std::uint32_t> m_index_;
+
+  DISALLOW_COPY_AND_ASSIGN(BloatReport);
+};
+
+}  // namespace xorg
+
+#endif  // XORG_BLOAT_REPORT_H_
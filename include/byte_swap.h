@@ -0,0 +1,47 @@
+/**
+ * Copyright 2022 hupeng.
+ * SPDX-License-Identifier: MIT
+ */
+#ifndef XORG_BYTE_SWAP_H_
+#define XORG_BYTE_SWAP_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+namespace xorg {
+
+// Byte order reversal of a table of fixed size records, described by the
+// widths of their fields, e.g. {4, 1, 1, 2, 8, 8} for Elf64_Sym.
+//
+// Records are reversed a 16 byte chunk at a time with one SSSE3 shuffle per
+// chunk when every field lies within a chunk, which holds for naturally
+// aligned records; the rest is done field by field.
+class SwapLayout {
+ public:
+  explicit SwapLayout(std::initializer_list<std::uint8_t> widths);
+  ~SwapLayout() = default;
+
+  std::size_t RecordSize() const { return m_record_; }
+
+  // Reverses every field of `count` records from `src` into `dst`, which may
+  // be `src` itself.
+  void Swap(const void* src, void* dst, std::size_t count) const;
+
+ private:
+  void SwapScalar(const char* src, char* dst, std::size_t count) const;
+  std::size_t SwapSsse3(const char* src, char* dst, std::size_t count) const;
+
+  std::vector<std::uint8_t> m_widths_;
+  std::size_t m_record_ = 0;
+
+  // a group is the smallest run of whole records that fills whole chunks,
+  // m_shuffle_ holds one pshufb mask per chunk of it
+  std::size_t m_group_records_ = 0;
+  std::vector<std::uint8_t> m_shuffle_;
+};
+
+}  // namespace xorg
+
+#endif  // XORG_BYTE_SWAP_H_
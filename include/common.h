@@ -5,6 +5,7 @@
 #ifndef XORG_COMMON_H_
 #define XORG_COMMON_H_
 
+#include <cstddef>
 #include <map>
 
 #define DISALLOW_COPY_AND_ASSIGN(TypeName) \
@@ -22,4 +23,29 @@ const V& GetMapValWithDef(const std::map<K, V>& map,
   return it->second;
 }
 
+namespace xorg {
+
+// Non-owning view of `size` contiguous objects, e.g. a table inside a mapped
+// ELF file.
+template <class T>
+class Span {
+ public:
+  Span() = default;
+  Span(const T* data, std::size_t size) : m_data_(data), m_size_(size) {}
+
+  const T* begin() const { return m_data_; }
+  const T* end() const { return m_data_ + m_size_; }
+  const T* data() const { return m_data_; }
+  std::size_t size() const { return m_size_; }
+  bool empty() const { return m_size_ == 0; }
+
+  const T& operator[](std::size_t idx) const { return m_data_[idx]; }
+
+ private:
+  const T* m_data_ = nullptr;
+  std::size_t m_size_ = 0;
+};
+
+}  // namespace xorg
+
 #endif  // XORG_COMMON_H_
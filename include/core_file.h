@@ -0,0 +1,100 @@
+/**
+ * Copyright 2022 hupeng.
+ * SPDX-License-Identifier: MIT
+ */
+#ifndef XORG_CORE_FILE_H_
+#define XORG_CORE_FILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "address_space.h"
+#include "common.h"
+#include "elf.h"
+#include "elf_spec.h"
+#include "output.h"
+
+namespace xorg {
+
+// A thread of the process, from its NT_PRSTATUS note.
+struct CoreThread {
+  std::uint32_t tid = 0;
+  // signal the thread stopped on
+  std::uint16_t signal = 0;
+  // 0 on machines whose register layout is not known
+  std::uint64_t pc = 0;
+  std::uint64_t sp = 0;
+  // pr_reg as stored, in the byte order of the file
+  Span<char> registers;
+};
+
+// A file mapped into the process, from the NT_FILE note.
+struct CoreMapping {
+  std::uint64_t start = 0;
+  std::uint64_t end = 0;
+  // offset into the file, in bytes
+  std::uint64_t offset = 0;
+  std::string_view path;
+};
+
+struct AuxEntry {
+  std::uint64_t type = 0;
+  std::uint64_t value = 0;
+};
+
+// The process an ET_CORE file was dumped from. Parse() decodes the PT_NOTE
+// segments only, the PT_LOAD payloads that make up most of the file are
+// left alone, so looking at a few addresses of a core of many GB stays
+// cheap.
+class CoreFile {
+ public:
+  // `elf` has been parsed and outlives the CoreFile
+  explicit CoreFile(const Elf& elf) : m_elf_(elf) {}
+  ~CoreFile() = default;
+
+  // false unless the file is a core
+  bool Parse();
+  void Print(Output& out) const;
+
+  const std::vector<CoreThread>& Threads() const { return m_threads_; }
+  const std::vector<CoreMapping>& Mappings() const { return m_mappings_; }
+  const std::vector<AuxEntry>& Auxv() const { return m_auxv_; }
+  // value of auxv entry `type`, 0 when there is none
+  std::uint64_t Aux(AuxType type) const;
+  // mapped file holding `addr`, nullptr when there is none
+  const CoreMapping* FindMapping(std::uint64_t addr) const;
+
+  // Memory of the process. Reads touch the pages they copy from and no
+  // other, bytes the dump left out (past p_filesz, mostly file mappings
+  // that FindMapping() names) cannot be read.
+  const AddressSpace& Memory() const { return m_memory_; }
+
+ private:
+  void ParseNotes(Span<char> data, std::uint64_t align);
+  void ParseStatus(Span<char> desc);
+  void ParseFiles(Span<char> desc);
+  void ParseAuxv(Span<char> desc);
+
+  // an unsigned of `size` bytes at `offset` of `data`, 0 past its end
+  std::uint64_t Read(Span<char> data,
+                     std::uint64_t offset,
+                     std::size_t size) const;
+
+  const Elf& m_elf_;
+  bool m_swap_ = false;
+  // size of a long in the process
+  std::size_t m_word_ = 8;
+
+  std::vector<CoreThread> m_threads_;
+  std::vector<CoreMapping> m_mappings_;
+  std::vector<AuxEntry> m_auxv_;
+  AddressSpace m_memory_;
+
+  DISALLOW_COPY_AND_ASSIGN(CoreFile);
+};
+
+}  // namespace xorg
+
+#endif  // XORG_CORE_FILE_H_
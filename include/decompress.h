@@ -0,0 +1,69 @@
+/**
+ * Copyright 2022 hupeng.
+ * SPDX-License-Identifier: MIT
+ */
+#ifndef XORG_DECOMPRESS_H_
+#define XORG_DECOMPRESS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include "common.h"
+#include "elf_spec.h"
+
+namespace xorg {
+
+// Buffers for decompressed sections, handed back when their Elf goes away so
+// that the next file reuses them instead of allocating. Thread safe.
+class BufferPool {
+ public:
+  // kept for reuse, larger releases are freed
+  static const std::size_t kDefaultMaxBytes = std::size_t{256} << 20;
+
+  struct Buffer {
+    std::unique_ptr<char[]> data;
+    std::size_t capacity = 0;
+  };
+
+  explicit BufferPool(std::size_t max_bytes = kDefaultMaxBytes)
+      : m_max_bytes_(max_bytes) {}
+  ~BufferPool() = default;
+
+  // shared by every Elf of the process
+  static BufferPool& Default();
+
+  // the smallest pooled buffer of at least `size` bytes, or a new one
+  Buffer Acquire(std::size_t size);
+  void Release(Buffer buffer);
+
+  std::size_t PooledBytes() const;
+
+ private:
+  std::size_t m_max_bytes_;
+
+  mutable std::mutex m_mutex_;
+  // by capacity
+  std::multimap<std::size_t, std::unique_ptr<char[]>> m_free_;
+  std::size_t m_pooled_bytes_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(BufferPool);
+};
+
+// True when data compressed with `type` can be decompressed by this build.
+bool CanDecompress(ChType type);
+
+// False when `src`, the bytes following the compression header, cannot
+// decompress to `size` bytes: a corrupt ch_size that is not worth a buffer.
+bool PlausibleSize(ChType type, Span<char> src, std::uint64_t size);
+
+// Decompresses `src`, the bytes following the compression header, into the
+// `size` bytes at `dst`. False when the data is corrupt or does not have
+// exactly `size` bytes.
+bool Decompress(ChType type, Span<char> src, char* dst, std::uint64_t size);
+
+}  // namespace xorg
+
+#endif  // XORG_DECOMPRESS_H_
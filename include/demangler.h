@@ -0,0 +1,54 @@
+/**
+ * Copyright 2022 hupeng.
+ * SPDX-License-Identifier: MIT
+ */
+#ifndef XORG_DEMANGLER_H_
+#define XORG_DEMANGLER_H_
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "common.h"
+
+namespace xorg {
+
+// Scopes of symbol names: the demangled qualified name without parameters
+// or return type, with template arguments emptied so that instantiations of
+// one template fall together, e.g. "std::vector<>::_M_realloc_insert<>".
+// Special names keep their kind in front ("vtable for Foo"), GCC clones are
+// put with the function they came from. Names that are not mangled, or do
+// not demangle, are their own scope.
+//
+// Demangling runs on a thread pool and every distinct name is demangled
+// once over the life of the Demangler, whichever file it came from.
+class Demangler {
+ public:
+  // `jobs` threads, 0 for one per core
+  explicit Demangler(std::size_t jobs = 0) : m_jobs_(jobs) {}
+  ~Demangler() = default;
+
+  // One scope per name, in order. They live as long as the Demangler.
+  std::vector<std::string_view> Scopes(
+      const std::vector<std::string_view>& names);
+
+  // distinct names demangled so far
+  std::size_t size() const { return m_memo_.size(); }
+
+  // Splits a scope at the "::" outside brackets, e.g. "(anonymous
+  // namespace)::Foo<>::{lambda(int)#1}" into three.
+  static std::vector<std::string_view> Split(std::string_view scope);
+
+ private:
+  std::size_t m_jobs_;
+  // mangled name to scope, nodes stay put so views of the scopes do too
+  std::unordered_map<std::string, std::string> m_memo_;
+
+  DISALLOW_COPY_AND_ASSIGN(Demangler);
+};
+
+}  // namespace xorg
+
+#endif  // XORG_DEMANGLER_H_
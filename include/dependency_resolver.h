@@ -0,0 +1,127 @@
+/**
+ * Copyright 2022 hupeng.
+ * SPDX-License-Identifier: MIT
+ */
+#ifndef XORG_DEPENDENCY_RESOLVER_H_
+#define XORG_DEPENDENCY_RESOLVER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "common.h"
+
+namespace xorg {
+
+// What the resolver needs of an ELF file, copied out of it so the file can be
+// closed and the object shared between threads.
+struct SharedObject {
+  // path inside the root
+  std::string path;
+  std::uint8_t elf_class = 0;
+  std::uint16_t machine = 0;
+  std::string soname;
+  std::vector<std::string> needed;
+  std::string rpath;
+  std::string runpath;
+};
+
+// Shared objects by their path inside the root. Each one is parsed once, by
+// the first thread to ask for it, the others wait for that parse.
+class SharedObjectCache {
+ public:
+  // `root` is prepended to every path, "" for the host itself
+  explicit SharedObjectCache(const std::string& root) : m_root_(root) {}
+  ~SharedObjectCache() = default;
+
+  // nullptr when `path` is not an ELF file that can be parsed
+  std::shared_ptr<const SharedObject> Get(const std::string& path);
+  // parses so far, one per distinct path
+  std::size_t size() const;
+
+ private:
+  std::string m_root_;
+
+  mutable std::mutex m_mutex_;
+  std::unordered_map<std::string,
+                     std::shared_future<std::shared_ptr<const SharedObject>>>
+      m_objects_;
+
+  DISALLOW_COPY_AND_ASSIGN(SharedObjectCache);
+};
+
+// One DT_NEEDED entry of a Closure.
+struct Dependency {
+  std::string name;
+  // inside the root, empty when the library was not found
+  std::string path;
+  // path of the object whose DT_NEEDED named it
+  std::string needed_by;
+  std::size_t depth = 0;
+};
+
+// Libraries an executable loads, in the breadth first order of ld.so and each
+// of them once.
+struct Closure {
+  std::string path;
+  bool ok = false;
+  std::vector<Dependency> dependencies;
+};
+
+// Resolves DT_NEEDED the way ld.so does, below `root` instead of "/":
+// DT_RPATH of the object and its loaders unless it has a DT_RUNPATH, the
+// library path (LD_LIBRARY_PATH), DT_RUNPATH, the directories listed in
+// /etc/ld.so.conf and finally the default system directories. Candidates of
+// another ELF class or machine are skipped, as ld.so does.
+class DependencyResolver {
+ public:
+  // `library_path` is colon separated like LD_LIBRARY_PATH
+  explicit DependencyResolver(const std::string& root = "/",
+                              const std::string& library_path = "");
+  ~DependencyResolver() = default;
+
+  // `path` is on the host, not inside the root
+  Closure Resolve(const std::string& path);
+  // Resolves `paths` on `jobs` threads (0 for one per core), sharing the
+  // parsed libraries between them. Results are in the order of `paths`.
+  std::vector<Closure> ResolveAll(const std::vector<std::string>& paths,
+                                  std::size_t jobs);
+
+  const SharedObjectCache& Cache() const { return m_cache_; }
+
+ private:
+  struct Loaded;
+
+  // `name` searched for on behalf of `loaded[requester]`, the path inside the
+  // root or empty
+  std::string Find(const std::string& name,
+                   const std::vector<Loaded>& loaded,
+                   std::size_t requester);
+  // first directory in the colon separated `dirs` holding a usable `name`
+  std::string Search(const std::string& dirs,
+                     const std::string& name,
+                     const SharedObject& requester);
+  // `path` with every symlink followed inside the root, empty when missing
+  std::string RealPath(const std::string& path) const;
+
+  void ReadLdSoConf(const std::string& path, std::size_t depth);
+
+  // without the trailing slash, "" for "/"
+  std::string m_root_;
+  std::string m_library_path_;
+  // from ld.so.conf
+  std::vector<std::string> m_conf_dirs_;
+
+  SharedObjectCache m_cache_;
+
+  DISALLOW_COPY_AND_ASSIGN(DependencyResolver);
+};
+
+}  // namespace xorg
+
+#endif  // XORG_DEPENDENCY_RESOLVER_H_
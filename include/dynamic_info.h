@@ -0,0 +1,26 @@
+/**
+ * Copyright 2022 hupeng.
+ * SPDX-License-Identifier: MIT
+ */
+#ifndef XORG_DYNAMIC_INFO_H_
+#define XORG_DYNAMIC_INFO_H_
+
+#include <string_view>
+#include <vector>
+
+namespace xorg {
+
+// The entries of a .dynamic section the dynamic loader searches libraries
+// with. Names are views into the string table the section links to.
+struct DynamicInfo {
+  std::string_view soname;
+  // DT_NEEDED in load order
+  std::vector<std::string_view> needed;
+  // colon separated directory lists
+  std::string_view rpath;
+  std::string_view runpath;
+};
+
+}  // namespace xorg
+
+#endif  // XORG_DYNAMIC_INFO_H_
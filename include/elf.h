@@ -6,48 +6,184 @@
 #define XORG_ELF_H_
 
 #include <cstdint>
-#include <fstream>
-#include <functional>
 #include <map>
+#include <memory>
+#include <memory_resource>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 #include "common.h"
+#include "decompress.h"
+#include "dynamic_info.h"
+#include "elf_decoder.h"
 #include "elf_header.h"
+#include "file_source.h"
+#include "output.h"
 #include "program_header.h"
+#include "relocations.h"
 #include "section_header.h"
+#include "stream_file.h"
 #include "string_tab.h"
+#include "symbol_columns.h"
+#include "symbol_hash.h"
 #include "symbol_tab.h"
+#include "symbol_versions.h"
 
 namespace xorg {
 
+// An ELF file. Headers, sections and symbols are typed views onto its bytes:
+// regular files are mapped, anything else ("-" for stdin, pipes) is read in a
+// single forward pass keeping only the regions that get decoded.
+//
+// Parse() only reads the ELF, program and section headers. Section contents
+// are decoded the first time an accessor asks for them and cached after that.
+//
+// What is decoded is kept in `memory`, which outlives the Elf. Batch jobs
+// pass an Arena reset between files, so that a parse is a few pointer bumps
+// instead of one heap allocation per table.
 class Elf {
  public:
-  Elf(const std::string& filename);
+  explicit Elf(
+      const std::string& filename,
+      std::pmr::memory_resource* memory = std::pmr::get_default_resource());
   ~Elf();
 
-  void Parse();
-  void Print() const;
+  bool Parse();
+  void Print(Output& out) const;
 
-  const ElfHeader& Header() const { return m_header_; }
+  const std::string& Filename() const { return m_filename_; }
+  const ElfHeader& Header() const { return *m_header_; }
+  Span<ProgramHeader> Segments() const { return m_program_headers_; }
+  Span<SectionHeader> Sections() const { return m_section_headers_; }
+
+  // File contents of segment `idx`, p_filesz bytes at p_offset, empty when
+  // the file does not hold them. Mapped files are not read before the bytes
+  // are, streams only keep PT_NOTE segments.
+  Span<char> SegmentData(std::size_t idx) const;
+
+  // Contents of section `idx`, empty for SHT_NOBITS. SHF_COMPRESSED sections
+  // are decompressed on first use and kept as long as this Elf, they are
+  // empty when that fails.
+  Span<char> SectionData(std::uint16_t idx) const;
+  const SectionHeader* FindSection(std::string_view name) const;
+  // Decompresses the SHF_COMPRESSED sections among `idxs` on `jobs` threads
+  // (0 for one per core), ahead of SectionData() asking for them one by one.
+  void Decompress(const std::vector<std::uint16_t>& idxs,
+                  std::size_t jobs = 0) const;
+
+  // nullptr unless section `idx` is a string table
+  const StringTab* StrTab(std::uint16_t idx) const;
+
+  // empty unless section `idx` is a SHT_SYMTAB or SHT_DYNSYM
+  Span<SymbolTab> SymbolTable(std::uint16_t idx) const;
+  // .symtab, or .dynsym in stripped files
+  Span<SymbolTab> Symbols() const;
+  // section index of Symbols(), 0 when there is none
+  std::uint16_t SymbolsSection() const;
+  Span<SymbolTab> DynSymbols() const;
+  // Symbols() in columns, built on first use
+  const SymbolColumns& Columns() const;
+
+  // Looks `name` up through .gnu.hash or .hash when there is one. A miss is
+  // final when that hash covers Symbols() (stripped shared objects); without
+  // a hash, or when Symbols() is .symtab, it falls back to an index over
+  // Symbols() built on first use.
+  const SymbolTab* FindSymbol(std::string_view name) const;
+
+  // Names point into the string tables, they live as long as this Elf.
+  std::string_view SectionName(const SectionHeader& sh) const;
+  std::string_view SymbolName(const SymbolTab& symbol) const;
+  // GNU version of a .dynsym entry, empty for any other symbol
+  SymbolVersion Version(const SymbolTab& symbol) const;
+
+  // .dynamic, empty for static executables and objects
+  const DynamicInfo& Dynamic() const;
+
+  // nullptr unless section `idx` is a SHT_REL or SHT_RELA
+  const Relocations* RelocationTable(std::uint16_t idx) const;
+  // Symbol of relocation `row` of section `idx`, looked up in the symbol
+  // table the section links to. nullptr for relocations without one.
+  const SymbolTab* RelocationSymbol(std::uint16_t idx, std::size_t row) const;
+  // name of relocation `type` on the machine of this file
+  std::string_view RelocationTypeName(std::uint32_t type) const;
+  // Counts over every relocation section, which are all decoded for it.
+  RelocationStats CountRelocations() const;
+  void PrintRelocations(Output& out) const;
+  void PrintRelocationStats(Output& out) const;
+
+  // Descriptor of the NT_GNU_BUILD_ID note, empty when there is none.
+  Span<std::uint8_t> BuildId() const;
 
  private:
-  void ParseStrTab(std::uint16_t idx);
-  void ParseSymbolTab(std::uint16_t idx);
-  void ParseSymbolTabName();
+  bool OpenSource();
+  bool PlanStream(StreamFile* file) const;
+
+  // `count` records at `offset` as native views, converted by m_decoder_
+  // for ELF32 and foreign byte order files
+  template <class T>
+  const T* Table(ElfRecord record,
+                 std::uint64_t offset,
+                 std::uint64_t count) const;
+  // storage for converted tables, lives as long as this Elf
+  char* NativeBuffer(std::uint64_t size) const;
+  // SectionData() converted by m_decoder_, empty when it has no native form
+  Span<char> NativeSectionData(std::uint16_t idx) const;
+  // bytes of section `idx` as stored in the file
+  Span<char> RawSectionData(std::uint16_t idx) const;
+  // Decompresses section `idx` into a buffer from the pool, `buffer` is left
+  // empty when the section cannot be decompressed. Touches no member, several
+  // sections are decompressed at once.
+  Span<char> Inflate(std::uint16_t idx, BufferPool::Buffer* buffer) const;
+
+  using Parser = void (Elf::*)(std::uint16_t idx) const;
+  // decoder of sections of `type`, nullptr for those that have none
+  static Parser ParserOf(std::uint32_t type);
+
+  void Decode(std::uint16_t idx) const;
+  void ParseStrTab(std::uint16_t idx) const;
+  void ParseSymbolTab(std::uint16_t idx) const;
+  void ParseHashTab(std::uint16_t idx) const;
+  void ParseVersions(std::uint16_t idx) const;
+  void ParseNotes(std::uint16_t idx) const;
+  void ParseRelocations(std::uint16_t idx) const;
+  void ParseDynamic(std::uint16_t idx) const;
 
-  ElfHeader m_header_;
-  std::vector<ProgramHeader> m_program_headers_;
-  std::vector<SectionHeader> m_section_headers_;
+  // first section of `type`, 0 (SHN_UNDEF) when there is none
+  std::uint16_t FirstSection(SHType type) const;
 
-  std::map<std::uint16_t, StringTab> m_str_sections_;
-  std::vector<SymbolTab> m_symbols_;
+  std::string m_filename_;
+  std::pmr::memory_resource* m_memory_;
+  std::unique_ptr<FileSource> m_file_;
+  // nullptr for ELF64 files in host byte order
+  std::unique_ptr<ElfDecoder> m_decoder_;
+  // from m_memory_, given back by the destructor
+  mutable std::pmr::vector<Span<char>> m_native_;
 
-  std::ifstream m_ifs_;
+  const ElfHeader* m_header_ = nullptr;
+  Span<ProgramHeader> m_program_headers_;
+  Span<SectionHeader> m_section_headers_;
 
-  std::map<SHType, std::function<void(std::uint16_t)>> m_sht_parse_map_;
+  // lazily decoded sections
+  mutable std::pmr::vector<bool> m_decoded_;
+  mutable std::pmr::map<std::uint16_t, StringTab> m_str_sections_;
+  mutable std::pmr::map<std::uint16_t, Span<SymbolTab>> m_symbol_tabs_;
+  mutable std::unique_ptr<SymbolColumns> m_columns_;
+  mutable std::pmr::map<std::uint16_t, SymbolHash> m_hash_sections_;
+  mutable std::unique_ptr<std::unordered_map<std::string_view, std::uint32_t>>
+      m_symbol_names_;
+  // shared by all .dynsym entries
+  mutable SymbolVersions m_versions_;
+  mutable Span<std::uint8_t> m_build_id_;
+  mutable std::pmr::map<std::uint16_t, std::unique_ptr<Relocations>>
+      m_relocations_;
+  mutable DynamicInfo m_dynamic_;
+  // SHF_COMPRESSED sections decompressed so far, into m_buffers_
+  mutable std::pmr::map<std::uint16_t, Span<char>> m_decompressed_;
+  mutable std::vector<BufferPool::Buffer> m_buffers_;
 
-  std::uint16_t m_symbol_idx_;
+  std::pmr::map<SHType, std::uint16_t> m_first_section_;
 
   DISALLOW_COPY_AND_ASSIGN(Elf);
 };
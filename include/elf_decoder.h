@@ -0,0 +1,66 @@
+/**
+ * Copyright 2022 hupeng.
+ * SPDX-License-Identifier: MIT
+ */
+#ifndef XORG_ELF_DECODER_H_
+#define XORG_ELF_DECODER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "elf_spec.h"
+#include "section_header.h"
+
+namespace xorg {
+
+// Tables the views read directly from the file.
+enum class ElfRecord {
+  kHeader,
+  kProgramHeader,
+  kSectionHeader,
+  kSymbol,
+  // converted to Elf64_Rel and Elf64_Rela, r_info split as in ELF64
+  kRel,
+  kRela,
+  kDynamic,
+  // header of a SHF_COMPRESSED section
+  kCompressionHeader,
+};
+
+// Converts the tables of files that are not ELF64 in host byte order to the
+// Elf64 layout the views are made for. One specialization per class and
+// byte order is picked from e_ident when a file is opened, so conversion
+// loops carry no per field checks; native files get no decoder at all and
+// are used in place.
+class ElfDecoder {
+ public:
+  virtual ~ElfDecoder() = default;
+
+  // nullptr for native files, `elf_class` and `data` come from e_ident
+  static std::unique_ptr<ElfDecoder> Create(std::uint8_t elf_class,
+                                            std::uint8_t data);
+
+  // on-disk size of a `record`
+  virtual std::size_t Size(ElfRecord record) const = 0;
+  // `count` records from `src` into the Elf64 layout at `dst`
+  virtual void Convert(ElfRecord record,
+                       const char* src,
+                       std::size_t count,
+                       void* dst) const = 0;
+
+  // Converts a copy of the contents of `sh` in place. False when the section
+  // has no Elf64 equivalent, e.g. the 32 bit bloom filter of an ELF32
+  // .gnu.hash.
+  virtual bool ConvertSection(const SectionHeader& sh,
+                              char* data,
+                              std::uint64_t size) const = 0;
+};
+
+// Size of a `record` as stored in the file, `decoder` is nullptr for native
+// files.
+std::size_t RecordSize(const ElfDecoder* decoder, ElfRecord record);
+
+}  // namespace xorg
+
+#endif  // XORG_ELF_DECODER_H_
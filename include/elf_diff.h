@@ -0,0 +1,73 @@
+/**
+ * Copyright 2022 hupeng.
+ * SPDX-License-Identifier: MIT
+ */
+#ifndef XORG_ELF_DIFF_H_
+#define XORG_ELF_DIFF_H_
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "common.h"
+#include "output.h"
+
+namespace xorg {
+
+class Elf;
+
+enum class DiffChange {
+  kAdded,
+  kRemoved,
+  kResized,
+};
+
+// A section or symbol present in only one of the files, or in both with
+// different sizes. `name` points into the string table of either file.
+struct DiffEntry {
+  DiffChange change;
+  std::string_view name;
+  std::uint64_t old_size = 0;
+  std::uint64_t new_size = 0;
+
+  std::int64_t Delta() const {
+    return static_cast<std::int64_t>(new_size - old_size);
+  }
+};
+
+// Changes of one kind of entry, largest growth first, with the sizes summed
+// over every entry of that kind in each file.
+struct DiffList {
+  std::vector<DiffEntry> entries;
+  std::uint64_t old_total = 0;
+  std::uint64_t new_total = 0;
+};
+
+// Sections and defined symbols of two builds matched by name. A name that
+// appears several times, e.g. a static function in many files, is matched
+// by order of appearance.
+//
+// Names are hashed and both sides radix sorted by hash, one merge pass then
+// pairs them, so the cost grows linearly with the number of symbols. The
+// result points into both files, which have to outlive it.
+class ElfDiff {
+ public:
+  ElfDiff() = default;
+  ~ElfDiff() = default;
+
+  void Build(const Elf& old_elf, const Elf& new_elf);
+  void Print(Output& out) const;
+
+  const DiffList& Sections() const { return m_sections_; }
+  const DiffList& Symbols() const { return m_symbols_; }
+
+ private:
+  DiffList m_sections_;
+  DiffList m_symbols_;
+
+  DISALLOW_COPY_AND_ASSIGN(ElfDiff);
+};
+
+}  // namespace xorg
+
+#endif  // XORG_ELF_DIFF_H_
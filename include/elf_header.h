@@ -7,9 +7,11 @@
 
 #include <cstdint>
 #include <string>
+#include <string_view>
 
 #include "common.h"
 #include "elf_spec.h"
+#include "output.h"
 
 namespace xorg {
 
@@ -18,7 +20,19 @@ class ElfHeader : private Elf64_Ehdr {
   ElfHeader() = default;
   ~ElfHeader() = default;
 
-  void Print() const;
+  void Print(Output& out) const;
+
+  // ELF magic and a class and byte order this parser decodes
+  bool IsValid() const;
+
+  // EI_CLASS and EI_DATA of e_ident
+  std::uint8_t GetClass() const;
+  std::uint8_t GetData() const;
+
+  std::uint16_t GetType() const { return e_type; }
+  std::uint16_t GetMachine() const { return e_machine; }
+  const std::string& TypeName() const;
+  const std::string& MachineName() const;
 
   std::uint64_t GetPhOff() const { return e_phoff; }
   std::uint16_t GetPhSize() const { return e_phentsize; }
@@ -31,19 +45,28 @@ class ElfHeader : private Elf64_Ehdr {
   std::uint16_t GetShStrndx() const { return e_shstrndx; }
 
  private:
-  void PrintMagic() const;
-  void PrintClass() const;
-  void PrintData() const;
-  void PrintVersion() const;
-  void PrintOsABI() const;
-  void PrintType() const;
-  void PrintMachine() const;
-
-  void PrintDec(const std::string& key,
-                const std::uint64_t& value,
-                const std::string& suffix = "") const;
-  void PrintHex(const std::string& key, const std::uint64_t& value) const;
-  void PrintCommon(const std::string& key, const std::string& value) const;
+  void PrintMagic(Output& out) const;
+  void PrintClass(Output& out) const;
+  void PrintData(Output& out) const;
+  void PrintVersion(Output& out) const;
+  void PrintOsABI(Output& out) const;
+  void PrintType(Output& out) const;
+  void PrintMachine(Output& out) const;
+
+  // `key` labels table output, `name` is the record field
+  void PrintDec(Output& out,
+                std::string_view key,
+                std::string_view name,
+                std::uint64_t value,
+                std::string_view suffix = "") const;
+  void PrintHex(Output& out,
+                std::string_view key,
+                std::string_view name,
+                std::uint64_t value) const;
+  void PrintCommon(Output& out,
+                   std::string_view key,
+                   std::string_view name,
+                   std::string_view value) const;
 
   DISALLOW_COPY_AND_ASSIGN(ElfHeader);
 };
@@ -0,0 +1,241 @@
+/**
+ * Copyright 2022 hupeng.
+ * SPDX-License-Identifier: MIT
+ */
+#ifndef XORG_ELF_RANGE_H_
+#define XORG_ELF_RANGE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <string_view>
+
+#include "common.h"
+#include "elf.h"
+#include "program_header.h"
+#include "section_header.h"
+#include "string_tab.h"
+#include "symbol_tab.h"
+
+namespace xorg {
+
+// Ranges over the tables of an Elf for range-for loops and <algorithm>. An
+// entry is a small value built when the iterator is dereferenced, from views
+// into the file: iterating allocates nothing. The tables an entry names are
+// decoded when the range is made, so entries of a range are as cheap as
+// indexing the Span they come from.
+
+struct SectionEntry {
+  std::uint16_t index;
+  const SectionHeader& header;
+  std::string_view name;
+};
+
+struct SegmentEntry {
+  std::size_t index;
+  const ProgramHeader& header;
+  // see Elf::SegmentData()
+  Span<char> data;
+};
+
+struct SymbolEntry {
+  std::size_t index;
+  const SymbolTab& symbol;
+  std::string_view name;
+};
+
+struct StringEntry {
+  std::uint64_t offset;
+  std::string_view str;
+};
+
+// Iterates positions 0 to size() of `Range`, dereferenced through its At().
+// Holds a copy of the range, which is a few pointers, so that it stays valid
+// after a temporary range is gone.
+template <class Range>
+class IndexIterator {
+ public:
+  // entries are values, not references into the range
+  using iterator_category = std::input_iterator_tag;
+  using value_type = typename Range::Entry;
+  using difference_type = std::ptrdiff_t;
+  using pointer = void;
+  using reference = value_type;
+
+  IndexIterator(const Range& range, std::size_t pos)
+      : m_range_(range), m_pos_(pos) {}
+
+  value_type operator*() const { return m_range_.At(m_pos_); }
+  IndexIterator& operator++() {
+    m_pos_++;
+    return *this;
+  }
+  IndexIterator operator++(int) {
+    auto it = *this;
+    m_pos_++;
+    return it;
+  }
+
+  bool operator==(const IndexIterator& other) const {
+    return m_pos_ == other.m_pos_;
+  }
+  bool operator!=(const IndexIterator& other) const {
+    return m_pos_ != other.m_pos_;
+  }
+
+ private:
+  Range m_range_;
+  std::size_t m_pos_;
+};
+
+// The section headers with their names.
+class SectionRange {
+ public:
+  using Entry = SectionEntry;
+  using Iterator = IndexIterator<SectionRange>;
+
+  explicit SectionRange(const Elf& elf)
+      : m_headers_(elf.Sections()),
+        m_names_(elf.StrTab(elf.Header().GetShStrndx())) {}
+
+  Iterator begin() const { return Iterator(*this, 0); }
+  Iterator end() const { return Iterator(*this, size()); }
+  std::size_t size() const { return m_headers_.size(); }
+
+  Entry At(std::size_t idx) const {
+    const auto& sh = m_headers_[idx];
+    return {static_cast<std::uint16_t>(idx), sh,
+            m_names_ != nullptr ? m_names_->Get(sh.NameValue())
+                                : std::string_view()};
+  }
+
+ private:
+  Span<SectionHeader> m_headers_;
+  const StringTab* m_names_;
+};
+
+// The program headers with the file bytes of their segments.
+class SegmentRange {
+ public:
+  using Entry = SegmentEntry;
+  using Iterator = IndexIterator<SegmentRange>;
+
+  explicit SegmentRange(const Elf& elf) : m_elf_(&elf) {}
+
+  Iterator begin() const { return Iterator(*this, 0); }
+  Iterator end() const { return Iterator(*this, size()); }
+  std::size_t size() const { return m_elf_->Segments().size(); }
+
+  Entry At(std::size_t idx) const {
+    return {idx, m_elf_->Segments()[idx], m_elf_->SegmentData(idx)};
+  }
+
+ private:
+  const Elf* m_elf_;
+};
+
+// A symbol table with the names of its symbols, Elf::Symbols() by default.
+// Names come from the string table the section links to, found once here
+// rather than for each symbol as Elf::SymbolName() does.
+class SymbolRange {
+ public:
+  using Entry = SymbolEntry;
+  using Iterator = IndexIterator<SymbolRange>;
+
+  explicit SymbolRange(const Elf& elf)
+      : SymbolRange(elf, elf.SymbolsSection()) {}
+  // empty unless section `idx` is a SHT_SYMTAB or SHT_DYNSYM
+  SymbolRange(const Elf& elf, std::uint16_t idx)
+      : m_symbols_(elf.SymbolTable(idx)),
+        m_names_(m_symbols_.empty()
+                     ? nullptr
+                     : elf.StrTab(elf.Sections()[idx].Link())) {}
+
+  Iterator begin() const { return Iterator(*this, 0); }
+  Iterator end() const { return Iterator(*this, size()); }
+  std::size_t size() const { return m_symbols_.size(); }
+
+  Entry At(std::size_t idx) const {
+    const auto& symbol = m_symbols_[idx];
+    return {idx, symbol,
+            m_names_ != nullptr ? m_names_->Get(symbol.Name())
+                                : std::string_view()};
+  }
+
+ private:
+  Span<SymbolTab> m_symbols_;
+  const StringTab* m_names_;
+};
+
+// The NUL terminated strings of a string table in file order, starting with
+// the empty one at offset 0. Bytes after the last NUL are not a string.
+class StringRange {
+ public:
+  class Iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = StringEntry;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const StringEntry*;
+    using reference = const StringEntry&;
+
+    Iterator(const char* data, std::uint64_t size, std::uint64_t offset)
+        : m_data_(data), m_size_(size) {
+      Seek(offset);
+    }
+
+    reference operator*() const { return m_entry_; }
+    pointer operator->() const { return &m_entry_; }
+    Iterator& operator++() {
+      Seek(m_entry_.offset + m_entry_.str.size() + 1);
+      return *this;
+    }
+    Iterator operator++(int) {
+      auto it = *this;
+      ++*this;
+      return it;
+    }
+
+    bool operator==(const Iterator& other) const {
+      return m_entry_.offset == other.m_entry_.offset;
+    }
+    bool operator!=(const Iterator& other) const {
+      return m_entry_.offset != other.m_entry_.offset;
+    }
+
+   private:
+    // to the string at `offset`, or to the end when none is left there
+    void Seek(std::uint64_t offset) {
+      const void* nul = offset < m_size_
+                            ? std::memchr(m_data_ + offset, '\0',
+                                          m_size_ - offset)
+                            : nullptr;
+      if (nul == nullptr) {
+        m_entry_ = {m_size_, {}};
+        return;
+      }
+      const char* str = m_data_ + offset;
+      m_entry_ = {offset,
+                  std::string_view(str, static_cast<const char*>(nul) - str)};
+    }
+
+    const char* m_data_;
+    std::uint64_t m_size_;
+    StringEntry m_entry_;
+  };
+
+  explicit StringRange(const StringTab& strtab)
+      : m_data_(strtab.data()), m_size_(strtab.size()) {}
+
+  Iterator begin() const { return Iterator(m_data_, m_size_, 0); }
+  Iterator end() const { return Iterator(m_data_, m_size_, m_size_); }
+
+ private:
+  const char* m_data_;
+  std::uint64_t m_size_;
+};
+
+}  // namespace xorg
+
+#endif  // XORG_ELF_RANGE_H_
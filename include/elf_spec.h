@@ -20,6 +20,13 @@ typedef uint64_t Elf64_Xword;
 typedef uint8_t Elf64_Byte;
 typedef uint16_t Elf64_Section;
 
+typedef uint32_t Elf32_Addr;
+typedef uint16_t Elf32_Half;
+typedef uint32_t Elf32_Off;
+typedef int32_t Elf32_Sword;
+typedef uint32_t Elf32_Word;
+typedef uint16_t Elf32_Section;
+
 static const intptr_t EI_NIDENT = 16;
 
 #pragma pack(push, 1)
@@ -108,6 +115,23 @@ struct Elf64_Ehdr {
   Elf64_Half e_shstrndx;            /* Section header string table index */
 };
 
+struct Elf32_Ehdr {
+  unsigned char e_ident[EI_NIDENT]; /* Magic number and other info */
+  Elf32_Half e_type;                /* Object file type */
+  Elf32_Half e_machine;             /* Architecture */
+  Elf32_Word e_version;             /* Object file version */
+  Elf32_Addr e_entry;               /* Entry point virtual address */
+  Elf32_Off e_phoff;                /* Program header table file offset */
+  Elf32_Off e_shoff;                /* Section header table file offset */
+  Elf32_Word e_flags;               /* Processor-specific flags */
+  Elf32_Half e_ehsize;              /* ELF header size in bytes */
+  Elf32_Half e_phentsize;           /* Program header table entry size */
+  Elf32_Half e_phnum;               /* Program header table entry count */
+  Elf32_Half e_shentsize;           /* Section header table entry size */
+  Elf32_Half e_shnum;               /* Section header table entry count */
+  Elf32_Half e_shstrndx;            /* Section header string table index */
+};
+
 enum class SHType : uint32_t {
   SHT_NULL = 0,                    /* Section header table entry unused */
   SHT_PROGBITS,                    /* Program data */
@@ -166,6 +190,19 @@ struct Elf64_Shdr {
   Elf64_Xword sh_entsize;   /* Entry size if section holds table */
 };
 
+struct Elf32_Shdr {
+  Elf32_Word sh_name;      /* Section name (string tbl index) */
+  Elf32_Word sh_type;      /* Section type */
+  Elf32_Word sh_flags;     /* Section flags */
+  Elf32_Addr sh_addr;      /* Section virtual addr at execution */
+  Elf32_Off sh_offset;     /* Section file offset */
+  Elf32_Word sh_size;      /* Section size in bytes */
+  Elf32_Word sh_link;      /* Link to another section */
+  Elf32_Word sh_info;      /* Additional section information */
+  Elf32_Word sh_addralign; /* Section alignment */
+  Elf32_Word sh_entsize;   /* Entry size if section holds table */
+};
+
 enum class PHType : uint32_t {
   PT_NULL = 0,                  /* Program header table entry unused */
   PT_LOAD,                      /* Loadable program segment */
@@ -197,6 +234,17 @@ struct Elf64_Phdr {
   Elf64_Xword p_align;  /* Segment alignment */
 };
 
+struct Elf32_Phdr {
+  Elf32_Word p_type;   /* Segment type */
+  Elf32_Off p_offset;  /* Segment file offset */
+  Elf32_Addr p_vaddr;  /* Segment virtual address */
+  Elf32_Addr p_paddr;  /* Segment physical address */
+  Elf32_Word p_filesz; /* Segment size in file */
+  Elf32_Word p_memsz;  /* Segment size in memory */
+  Elf32_Word p_flags;  /* Segment flags */
+  Elf32_Word p_align;  /* Segment alignment */
+};
+
 enum class STBind : uint32_t {
   STB_LOCAL = 0,       /* Local symbol */
   STB_GLOBAL,          /* Global symbol */
@@ -254,6 +302,163 @@ struct Elf64_Sym {
   Elf64_Xword st_size;    /* Symbol size */
 };
 
+struct Elf32_Sym {
+  Elf32_Word st_name;     /* Symbol name (string tbl index) */
+  Elf32_Addr st_value;    /* Symbol value */
+  Elf32_Word st_size;     /* Symbol size */
+  unsigned char st_info;  /* Symbol type and binding */
+  unsigned char st_other; /* Symbol visibility */
+  Elf32_Section st_shndx; /* Section index */
+};
+
+struct Elf64_Rel {
+  Elf64_Addr r_offset; /* Address */
+  Elf64_Xword r_info;  /* Relocation type and symbol index */
+};
+
+struct Elf64_Rela {
+  Elf64_Addr r_offset;   /* Address */
+  Elf64_Xword r_info;    /* Relocation type and symbol index */
+  Elf64_Sxword r_addend; /* Addend */
+};
+
+struct Elf32_Rel {
+  Elf32_Addr r_offset; /* Address */
+  Elf32_Word r_info;   /* Relocation type and symbol index */
+};
+
+struct Elf32_Rela {
+  Elf32_Addr r_offset;   /* Address */
+  Elf32_Word r_info;    /* Relocation type and symbol index */
+  Elf32_Sword r_addend; /* Addend */
+};
+
+enum class DTag : int64_t {
+  DT_NULL = 0,     /* Marks end of dynamic section */
+  DT_NEEDED = 1,   /* Name of needed library */
+  DT_STRTAB = 5,   /* Address of string table */
+  DT_SONAME = 14,  /* Name of shared object */
+  DT_RPATH = 15,   /* Library search path (deprecated) */
+  DT_RUNPATH = 29, /* Library search path */
+};
+
+struct Elf64_Dyn {
+  Elf64_Sxword d_tag; /* Dynamic entry type */
+  Elf64_Xword d_val;  /* Integer or address value */
+};
+
+struct Elf32_Dyn {
+  Elf32_Sword d_tag; /* Dynamic entry type */
+  Elf32_Word d_val;  /* Integer or address value */
+};
+
+// Compression header at the start of a SHF_COMPRESSED section
+enum class ChType : uint32_t {
+  ELFCOMPRESS_ZLIB = 1, /* zlib/deflate */
+  ELFCOMPRESS_ZSTD = 2, /* Zstandard */
+};
+
+struct Elf64_Chdr {
+  Elf64_Word ch_type;       /* Compression format */
+  Elf64_Word ch_reserved;   /* Padding */
+  Elf64_Xword ch_size;      /* Uncompressed data size */
+  Elf64_Xword ch_addralign; /* Uncompressed data alignment */
+};
+
+struct Elf32_Chdr {
+  Elf32_Word ch_type;      /* Compression format */
+  Elf32_Word ch_size;      /* Uncompressed data size */
+  Elf32_Word ch_addralign; /* Uncompressed data alignment */
+};
+
+// Values of .gnu.version (SHT_GNU_VERSYM) entries
+static const uint16_t VER_NDX_LOCAL = 0;       /* Symbol is local */
+static const uint16_t VER_NDX_GLOBAL = 1;      /* Symbol is global */
+static const uint16_t VERSYM_HIDDEN = 0x8000;  /* Not the default version */
+static const uint16_t VERSYM_VERSION = 0x7fff; /* Version index mask */
+
+static const uint16_t VER_FLG_BASE = 0x1; /* Version definition of file */
+
+struct Elf64_Verdef {
+  Elf64_Half vd_version; /* Version revision */
+  Elf64_Half vd_flags;   /* Version information */
+  Elf64_Half vd_ndx;     /* Version Index */
+  Elf64_Half vd_cnt;     /* Number of associated aux entries */
+  Elf64_Word vd_hash;    /* Version name hash value */
+  Elf64_Word vd_aux;     /* Offset in bytes to verdaux array */
+  Elf64_Word vd_next;    /* Offset in bytes to next verdef entry */
+};
+
+struct Elf64_Verdaux {
+  Elf64_Word vda_name; /* Version or dependency names */
+  Elf64_Word vda_next; /* Offset in bytes to next verdaux entry */
+};
+
+struct Elf64_Verneed {
+  Elf64_Half vn_version; /* Version of structure */
+  Elf64_Half vn_cnt;     /* Number of associated aux entries */
+  Elf64_Word vn_file;    /* Offset of filename for this dependency */
+  Elf64_Word vn_aux;     /* Offset in bytes to vernaux array */
+  Elf64_Word vn_next;    /* Offset in bytes to next verneed entry */
+};
+
+struct Elf64_Vernaux {
+  Elf64_Word vna_hash;  /* Hash value of dependency name */
+  Elf64_Half vna_flags; /* Dependency specific information */
+  Elf64_Half vna_other; /* Version Index */
+  Elf64_Word vna_name;  /* Dependency name string offset */
+  Elf64_Word vna_next;  /* Offset in bytes to next vernaux entry */
+};
+
+struct Elf64_Nhdr {
+  Elf64_Word n_namesz; /* Length of the note's name */
+  Elf64_Word n_descsz; /* Length of the note's descriptor */
+  Elf64_Word n_type;   /* Type of the note */
+};
+
+// Types of notes owned by "GNU"
+static const uint32_t NT_GNU_BUILD_ID = 3; /* Unique build ID bitstring */
+
+// Types of notes owned by "CORE" in core files
+static const uint32_t NT_PRSTATUS = 1;         /* prstatus of a thread */
+static const uint32_t NT_PRPSINFO = 3;         /* prpsinfo of the process */
+static const uint32_t NT_AUXV = 6;             /* Auxiliary vector */
+static const uint32_t NT_SIGINFO = 0x53494749; /* siginfo of the signal */
+static const uint32_t NT_FILE = 0x46494c45;    /* Mapped files */
+
+// e_phnum of files with more segments, the count is in sh_info of section 0
+static const uint16_t PN_XNUM = 0xffff;
+
+// Entries of the auxiliary vector
+enum class AuxType : uint64_t {
+  AT_NULL = 0,           /* End of vector */
+  AT_IGNORE = 1,         /* Entry should be ignored */
+  AT_EXECFD = 2,         /* File descriptor of program */
+  AT_PHDR = 3,           /* Program headers for program */
+  AT_PHENT = 4,          /* Size of program header entry */
+  AT_PHNUM = 5,          /* Number of program headers */
+  AT_PAGESZ = 6,         /* System page size */
+  AT_BASE = 7,           /* Base address of interpreter */
+  AT_FLAGS = 8,          /* Flags */
+  AT_ENTRY = 9,          /* Entry point of program */
+  AT_NOTELF = 10,        /* Program is not ELF */
+  AT_UID = 11,           /* Real uid */
+  AT_EUID = 12,          /* Effective uid */
+  AT_GID = 13,           /* Real gid */
+  AT_EGID = 14,          /* Effective gid */
+  AT_PLATFORM = 15,      /* String identifying platform */
+  AT_HWCAP = 16,         /* Machine dependent hints about capabilities */
+  AT_CLKTCK = 17,        /* Frequency of times() */
+  AT_SECURE = 23,        /* Boolean, was exec setuid-like? */
+  AT_BASE_PLATFORM = 24, /* String identifying real platforms */
+  AT_RANDOM = 25,        /* Address of 16 random bytes */
+  AT_HWCAP2 = 26,        /* More machine dependent hints */
+  AT_EXECFN = 31,        /* Filename of executable */
+  AT_SYSINFO = 32,       /* Entry point of the vsyscall page */
+  AT_SYSINFO_EHDR = 33,  /* Address of the vDSO */
+  AT_MINSIGSTKSZ = 51,   /* Minimal stack size for signal delivery */
+};
+
 #pragma pack(pop)
 
 }  // namespace xorg
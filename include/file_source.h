@@ -0,0 +1,46 @@
+/**
+ * Copyright 2022 hupeng.
+ * SPDX-License-Identifier: MIT
+ */
+#ifndef XORG_FILE_SOURCE_H_
+#define XORG_FILE_SOURCE_H_
+
+#include <cstdint>
+
+namespace xorg {
+
+// Expected access pattern of a region, a hint for the page cache.
+enum class Access {
+  kNormal,
+  kSequential,
+  kRandom,
+  kWillNeed,
+};
+
+// Bytes of an ELF file addressed by file offset. Decoded structures are typed
+// views into the source, so it must outlive everything decoded from it.
+class FileSource {
+ public:
+  virtual ~FileSource() = default;
+
+  // Returns `length` bytes at `offset`, or nullptr if that range is not
+  // available from this source.
+  virtual const char* Data(std::uint64_t offset,
+                           std::uint64_t length) const = 0;
+
+  virtual void Advise(std::uint64_t offset,
+                      std::uint64_t length,
+                      Access access) const {}
+
+  // Returns `count` objects of type T starting at `offset`, or nullptr.
+  template <class T>
+  const T* View(std::uint64_t offset, std::uint64_t count = 1) const {
+    if (count > UINT64_MAX / sizeof(T))
+      return nullptr;
+    return reinterpret_cast<const T*>(Data(offset, count * sizeof(T)));
+  }
+};
+
+}  // namespace xorg
+
+#endif  // XORG_FILE_SOURCE_H_
@@ -0,0 +1,123 @@
+/**
+ * Copyright 2022 hupeng.
+ * SPDX-License-Identifier: MIT
+ */
+#ifndef XORG_LINE_INDEX_H_
+#define XORG_LINE_INDEX_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "common.h"
+#include "dwarf_spec.h"
+
+namespace xorg {
+
+class Elf;
+
+// Source position of an address, empty `file` when it has none.
+struct LineInfo {
+  std::string file;
+  std::uint32_t line = 0;
+  std::uint32_t column = 0;
+
+  bool Found() const { return !file.empty(); }
+};
+
+// Address to file:line through .debug_line.
+//
+// Build() only reads the compilation unit DIEs of .debug_info, for the
+// address ranges of each unit and the offset of its line program. A line
+// program is decoded the first time an address in its unit is looked up and
+// kept in an LRU cache bounded by the number of rows it holds. Units without
+// address ranges have their program decoded by Build() instead.
+//
+// Lookups change the cache, a LineIndex is used by one thread at a time.
+class LineIndex {
+ public:
+  static const std::size_t kDefaultCacheRows = 1 << 20;
+
+  // `elf` has to outlive the index
+  explicit LineIndex(const Elf& elf,
+                     std::size_t cache_rows = kDefaultCacheRows);
+  ~LineIndex();
+
+  // false when there is no .debug_line to index
+  bool Build();
+
+  LineInfo Lookup(std::uint64_t addr);
+
+  std::size_t Units() const;
+  // line programs decoded so far, evicted ones included
+  std::size_t Decodes() const { return m_decodes_; }
+
+ private:
+  struct Unit;
+  struct Program;
+  struct Range {
+    std::uint64_t begin;
+    std::uint64_t end;
+    std::uint32_t unit;
+
+    bool operator<(const Range& other) const { return begin < other.begin; }
+  };
+
+  // the program of `unit` from the cache, decoded when it is not there
+  const Program* Decoded(std::uint32_t unit);
+  const Program* Store(std::uint32_t unit, std::unique_ptr<Program> program);
+  std::unique_ptr<Program> Decode(const Unit& unit) const;
+
+  // Indexes the unit at `offset` in .debug_info, returns the offset of the
+  // next one or 0 when the section cannot be walked any further.
+  std::uint64_t ReadUnit(std::uint64_t offset);
+  // ranges of the list at `offset` in .debug_ranges or .debug_rnglists,
+  // false when it has none
+  bool AddRanges(const Unit& unit,
+                 std::uint64_t offset,
+                 std::uint64_t base,
+                 std::uint32_t idx);
+  // entry `index` of the unit in .debug_addr
+  std::uint64_t Addrx(const Unit& unit, std::uint64_t index) const;
+  std::string_view FormString(DwForm form,
+                              std::uint64_t value,
+                              std::string_view str) const;
+
+  Span<char> Section(std::string_view name) const;
+
+  const Elf& m_elf_;
+  bool m_swap_ = false;
+  Span<char> m_info_;
+  Span<char> m_abbrev_;
+  Span<char> m_line_;
+  Span<char> m_str_;
+  Span<char> m_line_str_;
+  Span<char> m_addr_;
+  Span<char> m_ranges_;
+  Span<char> m_rnglists_;
+
+  std::vector<Unit> m_units_;
+  // sorted by begin
+  std::vector<Range> m_ranges_index_;
+
+  // most recently used first
+  std::size_t m_cache_rows_;
+  std::size_t m_cached_rows_ = 0;
+  std::list<std::uint32_t> m_lru_;
+  std::unordered_map<std::uint32_t,
+                     std::pair<std::unique_ptr<Program>,
+                               std::list<std::uint32_t>::iterator>>
+      m_programs_;
+  std::size_t m_decodes_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(LineIndex);
+};
+
+}  // namespace xorg
+
+#endif  // XORG_LINE_INDEX_H_
@@ -0,0 +1,48 @@
+/**
+ * Copyright 2022 hupeng.
+ * SPDX-License-Identifier: MIT
+ */
+#ifndef XORG_MAPPED_FILE_H_
+#define XORG_MAPPED_FILE_H_
+
+#include <cstdint>
+#include <string>
+
+#include "common.h"
+#include "file_source.h"
+
+namespace xorg {
+
+// Read-only mapping of a whole file, access hints are forwarded to madvise.
+class MappedFile : public FileSource {
+ public:
+  MappedFile() = default;
+  ~MappedFile() override;
+
+  bool Open(const std::string& filename);
+  void Close();
+
+  bool IsOpen() const { return m_data_ != nullptr; }
+  const char* Data() const { return m_data_; }
+  std::uint64_t Size() const { return m_size_; }
+
+  const char* Data(std::uint64_t offset, std::uint64_t length) const override {
+    if (offset > m_size_ || length > m_size_ - offset)
+      return nullptr;
+    return m_data_ + offset;
+  }
+
+  void Advise(std::uint64_t offset,
+              std::uint64_t length,
+              Access access) const override;
+
+ private:
+  const char* m_data_ = nullptr;
+  std::uint64_t m_size_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(MappedFile);
+};
+
+}  // namespace xorg
+
+#endif  // XORG_MAPPED_FILE_H_
@@ -0,0 +1,80 @@
+/**
+ * Copyright 2022 hupeng.
+ * SPDX-License-Identifier: MIT
+ */
+#ifndef XORG_OUTPUT_H_
+#define XORG_OUTPUT_H_
+
+#include <spdlog/fmt/fmt.h>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "common.h"
+
+namespace xorg {
+
+enum class OutputFormat {
+  kTable,
+  kJsonLines,
+  kCsv,
+};
+
+// Buffered writer for dumps. Everything is formatted into one reusable
+// buffer that goes out with a single write(2) once it is full, so printing a
+// row does not allocate.
+//
+// Table output is laid out by the caller with Print(). Records are written
+// field by field and come out as one JSON object per line, or as CSV rows
+// with a header line whenever the set of fields changes.
+class Output {
+ public:
+  explicit Output(int fd, OutputFormat format = OutputFormat::kTable);
+  ~Output();
+
+  bool IsTable() const { return m_format_ == OutputFormat::kTable; }
+
+  template <class... Args>
+  void Print(fmt::format_string<Args...> format, Args&&... args) {
+    fmt::format_to(fmt::appender(m_buffer_), format,
+                   std::forward<Args>(args)...);
+    FlushIfFull();
+  }
+
+  void BeginRecord();
+  void Field(std::string_view key, std::string_view value);
+  void Field(std::string_view key, std::uint64_t value);
+  void SignedField(std::string_view key, std::int64_t value);
+  void HexField(std::string_view key, std::uint64_t value);
+  void Flag(std::string_view key, bool value);
+  void EndRecord();
+
+  void Flush();
+
+ private:
+  void Key(std::string_view key);
+  void Quoted(std::string_view value);
+  void FlushIfFull() {
+    if (m_buffer_.size() >= kFlushSize)
+      Flush();
+  }
+
+  static const std::size_t kFlushSize = 1 << 16;
+
+  int m_fd_;
+  OutputFormat m_format_;
+  fmt::memory_buffer m_buffer_;
+
+  // fields of the record being written, CSV rows wait in m_row_ until it is
+  // known whether a new header line has to go first
+  fmt::memory_buffer m_row_;
+  std::vector<std::string_view> m_keys_;
+  std::vector<std::string_view> m_header_;
+
+  DISALLOW_COPY_AND_ASSIGN(Output);
+};
+
+}  // namespace xorg
+
+#endif  // XORG_OUTPUT_H_
@@ -0,0 +1,91 @@
+/**
+ * Copyright 2022 hupeng.
+ * SPDX-License-Identifier: MIT
+ */
+#ifndef XORG_PARSE_CACHE_H_
+#define XORG_PARSE_CACHE_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "common.h"
+#include "mapped_file.h"
+#include "section_header.h"
+#include "string_tab.h"
+#include "symbol_columns.h"
+
+namespace xorg {
+
+class Elf;
+
+// Decoded results of one ELF file as stored by a ParseCache: the section
+// list with its names and Elf::Columns() with the symbol names. Everything
+// is a view into the mapped cache file.
+class CachedParse {
+ public:
+  CachedParse() = default;
+  ~CachedParse() = default;
+
+  // Maps `path` and checks that it is a complete cache file.
+  bool Open(const std::string& path);
+
+  Span<SectionHeader> Sections() const { return m_sections_; }
+  std::string_view SectionName(const SectionHeader& sh) const {
+    return m_section_names_.Get(sh.NameValue());
+  }
+
+  const SymbolColumns& Columns() const { return m_columns_; }
+  std::string_view SymbolName(std::uint32_t row) const {
+    return m_symbol_names_.Get(m_columns_.Name()[row]);
+  }
+
+ private:
+  MappedFile m_file_;
+  Span<SectionHeader> m_sections_;
+  StringTab m_section_names_;
+  StringTab m_symbol_names_;
+  SymbolColumns m_columns_;
+
+  DISALLOW_COPY_AND_ASSIGN(CachedParse);
+};
+
+// Directory of CachedParse files. Entries are keyed by the GNU build-id of
+// a file plus the kind of symbol table the columns come from, a stripped copy
+// shares the build-id of its original but not its .symtab. Every entry is
+// also hard linked under the device, inode, size and mtime of the file it was
+// made from, so that a repeat run finds it without reading the file at all.
+//
+// Files are written under a temporary name and renamed into place, so jobs
+// sharing a directory never see half written entries.
+class ParseCache {
+ public:
+  explicit ParseCache(const std::string& dir) : m_dir_(dir) {}
+  ~ParseCache() = default;
+
+  // Entry made from `filename` as it is now, looked up by stat() only.
+  // nullptr when there is none.
+  std::unique_ptr<CachedParse> Find(const std::string& filename) const;
+  // Entry of a parsed `elf` by build-id, e.g. made from another copy of it.
+  // nullptr when `elf` has no entry or the entry does not match it, a hit is
+  // linked for Find(filename) from then on.
+  std::unique_ptr<CachedParse> Find(const Elf& elf) const;
+  bool Store(const Elf& elf) const;
+
+ private:
+  // empty when `elf` has no build-id
+  std::string BuildIdPath(const Elf& elf) const;
+  // empty when `filename` is not a regular file, e.g. stdin
+  std::string StatPath(const std::string& filename) const;
+  // Makes `entry` reachable as `path` as well.
+  void Link(const std::string& entry, const std::string& path) const;
+
+  std::string m_dir_;
+
+  DISALLOW_COPY_AND_ASSIGN(ParseCache);
+};
+
+}  // namespace xorg
+
+#endif  // XORG_PARSE_CACHE_H_
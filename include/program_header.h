@@ -9,20 +9,26 @@
 #include <string>
 
 #include "elf_spec.h"
+#include "output.h"
 
 namespace xorg {
 
+// Typed view of an Elf64_Phdr, like SectionHeader it is used in place.
 class ProgramHeader : private Elf64_Phdr {
  public:
   ProgramHeader() = default;
   ~ProgramHeader() = default;
 
-  static void PrintHeader();
-  void Print() const;
+  static void PrintHeader(Output& out);
+  void Print(Output& out) const;
 
- private:
-  std::string GetHex(std::uint64_t value, bool isAddr = true) const;
-  std::string GetFlags(std::uint32_t flag) const;
+  std::uint32_t Type() const { return p_type; }
+  std::uint32_t Flags() const { return p_flags; }
+  std::uint64_t Offset() const { return p_offset; }
+  std::uint64_t VAddr() const { return p_vaddr; }
+  std::uint64_t FileSize() const { return p_filesz; }
+  std::uint64_t MemSize() const { return p_memsz; }
+  std::uint64_t Align() const { return p_align; }
 };
 
 }  // namespace xorg
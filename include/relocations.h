@@ -0,0 +1,82 @@
+/**
+ * Copyright 2022 hupeng.
+ * SPDX-License-Identifier: MIT
+ */
+#ifndef XORG_RELOCATIONS_H_
+#define XORG_RELOCATIONS_H_
+
+#include <cstdint>
+#include <map>
+#include <string_view>
+#include <vector>
+
+#include "common.h"
+#include "elf_spec.h"
+#include "output.h"
+
+namespace xorg {
+
+// Struct-of-arrays copy of a SHT_REL or SHT_RELA section with r_info split
+// into symbol and type. Symbols are indices into the symbol table named by
+// the section's sh_link, Elf::RelocationSymbol() resolves them on demand.
+class Relocations {
+ public:
+  Relocations() = default;
+  ~Relocations() = default;
+
+  void Build(Span<Elf64_Rel> rel);
+  void Build(Span<Elf64_Rela> rela);
+
+  std::size_t size() const { return m_offset_.size(); }
+  // false for SHT_REL, whose addends are stored at the relocated place
+  bool HasAddends() const { return !m_addend_.empty(); }
+
+  Span<std::uint64_t> Offset() const { return Columns(m_offset_); }
+  Span<std::uint32_t> Symbol() const { return Columns(m_symbol_); }
+  Span<std::uint32_t> Type() const { return Columns(m_type_); }
+  // empty unless HasAddends()
+  Span<std::int64_t> Addend() const { return Columns(m_addend_); }
+
+  // Adds the number of relocations of each type to `counts`.
+  void CountTypes(std::map<std::uint32_t, std::uint64_t>* counts) const;
+
+  static void PrintHeader(Output& out,
+                          std::string_view section,
+                          std::uint64_t offset,
+                          std::size_t size);
+  // `type` is the name of Type()[row] on the file's machine, `symbol` the
+  // value and name of its symbol, if it has one
+  void Print(Output& out,
+             std::string_view section,
+             std::size_t row,
+             std::string_view type,
+             std::uint64_t symbol_value,
+             std::string_view symbol_name) const;
+
+ private:
+  template <class T>
+  static Span<T> Columns(const std::vector<T>& column) {
+    return Span<T>(column.data(), column.size());
+  }
+
+  std::vector<std::uint64_t> m_offset_;
+  std::vector<std::uint32_t> m_symbol_;
+  std::vector<std::uint32_t> m_type_;
+  std::vector<std::int64_t> m_addend_;
+
+  DISALLOW_COPY_AND_ASSIGN(Relocations);
+};
+
+// Relocation counts over all relocation sections of a file.
+struct RelocationStats {
+  std::uint64_t total = 0;
+  // by r_type
+  std::map<std::uint32_t, std::uint64_t> by_type;
+  // by index of the section the relocations apply to, 0 for addresses
+  // outside of every allocated section
+  std::map<std::uint16_t, std::uint64_t> by_section;
+};
+
+}  // namespace xorg
+
+#endif  // XORG_RELOCATIONS_H_
@@ -0,0 +1,60 @@
+/**
+ * Copyright 2022 hupeng.
+ * SPDX-License-Identifier: MIT
+ */
+#ifndef XORG_SCANNER_H_
+#define XORG_SCANNER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace xorg {
+
+class Arena;
+
+// Summary of one ELF file found by the Scanner.
+struct ScanResult {
+  std::string path;
+  bool ok = false;
+  std::string type;
+  std::string machine;
+  std::size_t segments = 0;
+  std::size_t sections = 0;
+  std::size_t symbols = 0;
+  // memory the parse and the decoded tables took, in bytes
+  std::size_t parse_bytes = 0;
+};
+
+// Finds ELF files below a set of inputs and parses them on a ThreadPool.
+// Each worker parses into an Arena of its own, reset between files.
+class Scanner {
+ public:
+  // 0 jobs uses one per core
+  explicit Scanner(std::size_t jobs = 0) : m_jobs_(jobs) {}
+  ~Scanner() = default;
+
+  // Directories are walked recursively, wildcard patterns are expanded with
+  // glob(3) and "@file" reads one input per line from file.
+  void Add(const std::string& input);
+
+  // Files added so far, in path order and without duplicates.
+  std::vector<std::string> Paths() const;
+
+  // Results are in path order whatever the scheduling was.
+  std::vector<ScanResult> Run() const;
+
+  static bool IsElf(const std::string& path);
+
+ private:
+  void AddPath(const std::string& path);
+  static ScanResult ScanOne(const std::string& path, Arena& arena);
+
+  std::size_t m_jobs_;
+  std::vector<std::string> m_paths_;
+};
+
+}  // namespace xorg
+
+#endif  // XORG_SCANNER_H_
@@ -7,37 +7,42 @@
 
 #include <cstdint>
 #include <string>
+#include <string_view>
+
 #include "elf_spec.h"
+#include "output.h"
 
 namespace xorg {
 
+// Typed view of an Elf64_Shdr inside the mapped file, it carries no state of
+// its own so the section header table can be used in place.
 class SectionHeader : private Elf64_Shdr {
  public:
   SectionHeader() = default;
   ~SectionHeader() = default;
 
-  static void PrintHeader();
-  void Print() const;
+  static void PrintHeader(Output& out);
+  void Print(Output& out, std::uint16_t idx, std::string_view name) const;
 
-  void SetIdx(std::uint16_t idx) { m_idx_ = idx; }
-  void SetName(const std::string& name) { m_name_ = name; }
-  void ParseType();
+  const std::string& TypeName() const;
 
-  const std::string& Name() const { return m_name_; }
   std::uint32_t NameValue() const { return sh_name; }
 
   std::uint64_t Size() const { return sh_size; }
   std::uint64_t EntSize() const { return sh_entsize; }
   std::uint64_t Offset() const { return sh_offset; }
   std::uint32_t Type() const { return sh_type; }
+  std::uint64_t Flags() const { return sh_flags; }
+  std::uint64_t Addr() const { return sh_addr; }
   std::uint32_t Link() const { return sh_link; }
+  std::uint32_t Info() const { return sh_info; }
+  std::uint64_t AddrAlign() const { return sh_addralign; }
 
  private:
-  const std::string GetFlags() const;
+  static const std::size_t kFlagCount = 12;
 
-  std::uint16_t m_idx_;
-  std::string m_name_;
-  std::string m_type_str_;
+  // flag letters go to `buf`, which holds at least kFlagCount chars
+  std::string_view GetFlags(char* buf) const;
 };
 
 }  // namespace xorg
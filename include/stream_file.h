@@ -0,0 +1,78 @@
+/**
+ * Copyright 2022 hupeng.
+ * SPDX-License-Identifier: MIT
+ */
+#ifndef XORG_STREAM_FILE_H_
+#define XORG_STREAM_FILE_H_
+
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "common.h"
+#include "file_source.h"
+
+namespace xorg {
+
+// Forward-only reader for pipes, stdin and other non-seekable inputs. Only the
+// regions asked for with Fetch() are kept in memory. While spilling is on,
+// skipped bytes go to an unlinked temporary file so a region behind the read
+// position can still be fetched once it turns out to be needed.
+//
+// The spill costs disk space: finding the section headers at the end of a
+// file spills nearly all of it. It is capped at `limit` bytes, anything
+// skipped past that is dropped and cannot be fetched any more. A single
+// fetched region is capped at the same limit.
+class StreamFile : public FileSource {
+ public:
+  static const std::uint64_t kDefaultSpillLimit = std::uint64_t{256} << 20;
+
+  StreamFile() = default;
+  ~StreamFile() override;
+
+  // "-" reads standard input.
+  bool Open(const std::string& filename);
+  void Close();
+
+  // Makes [offset, offset + length) available through Data().
+  bool Fetch(std::uint64_t offset, std::uint64_t length);
+  // False when Fetch() cannot succeed because the range was skipped without
+  // being kept or is longer than the limit; other ranges ahead of the read
+  // position are always fetchable.
+  bool Fetchable(std::uint64_t offset, std::uint64_t length) const;
+
+  void SetSpill(bool spill, std::uint64_t limit = kDefaultSpillLimit) {
+    m_spill_on_ = spill;
+    m_spill_limit_ = limit;
+  }
+  // Deletes the spill file, once no region behind the read position will be
+  // fetched any more.
+  void DropSpill();
+
+  const char* Data(std::uint64_t offset, std::uint64_t length) const override;
+
+ private:
+  bool Read(char* buf, std::uint64_t length);
+  bool Skip(std::uint64_t length);
+  bool Spill(const char* buf, std::uint64_t length);
+
+  int m_fd_ = -1;
+  bool m_owned_ = false;
+  std::uint64_t m_pos_ = 0;
+
+  bool m_spill_on_ = false;
+  std::uint64_t m_spill_limit_ = kDefaultSpillLimit;
+  std::FILE* m_spill_ = nullptr;
+  std::uint64_t m_spill_begin_ = 0;
+  std::uint64_t m_spill_end_ = 0;
+
+  std::map<std::uint64_t, std::vector<char>> m_regions_;
+
+  DISALLOW_COPY_AND_ASSIGN(StreamFile);
+};
+
+}  // namespace xorg
+
+#endif  // XORG_STREAM_FILE_H_
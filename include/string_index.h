@@ -0,0 +1,131 @@
+/**
+ * Copyright 2022 hupeng.
+ * SPDX-License-Identifier: MIT
+ */
+#ifndef XORG_STRING_INDEX_H_
+#define XORG_STRING_INDEX_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string_view>
+#include <vector>
+
+#include "common.h"
+#include "output.h"
+#include "string_tab.h"
+
+namespace xorg {
+
+class Elf;
+
+// Where a sh_name or st_name offset points into its string table. Linkers
+// merge a name that is the tail of another one, so kSuffix is legitimate.
+enum class NameOffset {
+  kStart,
+  kSuffix,
+  // outside the table or in a string that runs off its end
+  kInvalid,
+};
+
+// Start offset of every string of a StringTab, found in one vectorized pass
+// over the table. Names are 32 bit offsets, a table is indexed up to 4 GiB.
+class StringIndex {
+ public:
+  struct Entry {
+    std::uint32_t offset;
+    // up to the NUL, or the end of the table for an unterminated last one
+    std::string_view str;
+  };
+
+  class Iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Entry;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const Entry*;
+    using reference = Entry;
+
+    Iterator(const StringIndex* index, std::size_t idx)
+        : m_index_(index), m_idx_(idx) {}
+
+    Entry operator*() const { return m_index_->At(m_idx_); }
+    Iterator& operator++() {
+      m_idx_++;
+      return *this;
+    }
+    bool operator==(const Iterator& other) const {
+      return m_idx_ == other.m_idx_;
+    }
+    bool operator!=(const Iterator& other) const {
+      return m_idx_ != other.m_idx_;
+    }
+
+   private:
+    const StringIndex* m_index_;
+    std::size_t m_idx_;
+  };
+
+  StringIndex() = default;
+  ~StringIndex() = default;
+
+  void Build(const StringTab& strtab);
+
+  // strings in the table, in offset order
+  std::size_t size() const { return m_starts_.size(); }
+  Entry At(std::size_t idx) const;
+  Iterator begin() const { return Iterator(this, 0); }
+  Iterator end() const { return Iterator(this, size()); }
+
+  // what a name at `offset` resolves to, a binary search of the starts
+  NameOffset Check(std::uint32_t offset) const;
+  bool IsStart(std::uint32_t offset) const {
+    return Check(offset) == NameOffset::kStart;
+  }
+
+ private:
+  const char* m_data_ = nullptr;
+  std::uint64_t m_size_ = 0;
+  // one past the last NUL, strings starting there are unterminated
+  std::uint64_t m_terminated_ = 0;
+  // ascending
+  std::vector<std::uint32_t> m_starts_;
+
+  DISALLOW_COPY_AND_ASSIGN(StringIndex);
+};
+
+// For the section headers and each symbol table of a file, how many of their
+// names start a string, are the tail of a longer one or point nowhere.
+class NameOffsetReport {
+ public:
+  struct Table {
+    // "<section headers>" or the name of the symbol table
+    std::string_view section;
+    // strings in the string table the names point into
+    std::size_t strings = 0;
+    // indexed by NameOffset
+    std::uint64_t counts[3] = {};
+  };
+
+  NameOffsetReport() = default;
+  ~NameOffsetReport() = default;
+
+  // `elf` outlives the report
+  void Build(const Elf& elf);
+  void Print(Output& out) const;
+
+  const std::vector<Table>& Tables() const { return m_tables_; }
+
+ private:
+  void Add(std::string_view section,
+           const StringTab* strtab,
+           const std::vector<std::uint32_t>& names);
+
+  std::vector<Table> m_tables_;
+
+  DISALLOW_COPY_AND_ASSIGN(NameOffsetReport);
+};
+
+}  // namespace xorg
+
+#endif  // XORG_STRING_INDEX_H_
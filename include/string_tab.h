@@ -6,24 +6,46 @@
 #define XORG_STRING_TAB_H_
 
 #include <cstdint>
-#include <vector>
+#include <cstring>
+#include <string_view>
 
 #include "common.h"
+#include "output.h"
 
 namespace xorg {
 
-class StringTab : public std::vector<char> {
+// View of a SHT_STRTAB section inside the mapped file.
+class StringTab {
  public:
   StringTab() = default;
+  StringTab(const char* data, std::uint64_t size, std::uint16_t idx)
+      : m_data_(data), m_size_(size), m_idx_(idx) {}
   ~StringTab() = default;
 
-  void Print() const;
+  void Print(Output& out) const;
+
+  // Returns the string starting at `offset`. An offset outside the table or
+  // a string that runs off its end resolves to an empty name.
+  std::string_view Get(std::uint32_t offset) const {
+    if (offset >= m_size_)
+      return {};
+
+    const char* str = m_data_ + offset;
+    const void* nul = std::memchr(str, '\0', m_size_ - offset);
+    if (nul == nullptr)
+      return {};
+    return std::string_view(str, static_cast<const char*>(nul) - str);
+  }
+
+  const char* data() const { return m_data_; }
+  std::uint64_t size() const { return m_size_; }
 
-  void SetIdx(std::uint16_t idx) { m_idx_ = idx; }
   const std::uint16_t GetIdx() const { return m_idx_; }
 
  private:
-  std::uint16_t m_idx_;
+  const char* m_data_ = nullptr;
+  std::uint64_t m_size_ = 0;
+  std::uint16_t m_idx_ = 0;
 };
 
 }  // namespace xorg
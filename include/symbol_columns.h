@@ -0,0 +1,90 @@
+/**
+ * Copyright 2022 hupeng.
+ * SPDX-License-Identifier: MIT
+ */
+#ifndef XORG_SYMBOL_COLUMNS_H_
+#define XORG_SYMBOL_COLUMNS_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "common.h"
+#include "elf_spec.h"
+#include "symbol_tab.h"
+
+namespace xorg {
+
+// Conditions on a symbol, all of them have to hold. The default filter
+// matches every symbol.
+struct SymbolFilter {
+  SymbolFilter& Type(STType type);
+  SymbolFilter& Bind(STBind bind);
+  SymbolFilter& Section(std::uint16_t shndx);
+  // inclusive ranges
+  SymbolFilter& SizeRange(std::uint64_t min, std::uint64_t max);
+  SymbolFilter& ValueRange(std::uint64_t min, std::uint64_t max);
+
+  // (st_info & info_mask) == info_value
+  std::uint8_t info_mask = 0;
+  std::uint8_t info_value = 0;
+  bool match_shndx = false;
+  std::uint16_t shndx = 0;
+  std::uint64_t min_size = 0;
+  std::uint64_t max_size = UINT64_MAX;
+  std::uint64_t min_value = 0;
+  std::uint64_t max_value = UINT64_MAX;
+};
+
+// Struct-of-arrays copy of a symbol table. Row i is symbol i of the table it
+// was built from, so names still resolve through Elf::SymbolName().
+class SymbolColumns {
+ public:
+  SymbolColumns() = default;
+  ~SymbolColumns() = default;
+
+  void Build(Span<SymbolTab> symbols);
+  // Uses `count` rows kept elsewhere instead, e.g. in a mapped ParseCache
+  // file. They are not copied and have to outlive the columns.
+  void Attach(std::size_t count,
+              const std::uint64_t* value,
+              const std::uint64_t* size,
+              const std::uint8_t* info,
+              const std::uint16_t* shndx,
+              const std::uint32_t* name);
+
+  std::size_t size() const { return m_value_.size(); }
+
+  Span<std::uint64_t> Value() const { return m_value_; }
+  Span<std::uint64_t> Size() const { return m_size_; }
+  Span<std::uint8_t> Info() const { return m_info_; }
+  Span<std::uint16_t> Shndx() const { return m_shndx_; }
+  Span<std::uint32_t> Name() const { return m_name_; }
+
+  // Indices of the matching symbols in ascending order.
+  std::vector<std::uint32_t> Select(const SymbolFilter& filter) const;
+
+ private:
+  std::size_t SelectScalar(const SymbolFilter& filter,
+                           std::size_t begin,
+                           std::uint32_t* out) const;
+  std::size_t SelectAvx2(const SymbolFilter& filter, std::uint32_t* out) const;
+
+  // rows filled in by Build(), empty after Attach()
+  std::vector<std::uint64_t> m_value_data_;
+  std::vector<std::uint64_t> m_size_data_;
+  std::vector<std::uint8_t> m_info_data_;
+  std::vector<std::uint16_t> m_shndx_data_;
+  std::vector<std::uint32_t> m_name_data_;
+
+  Span<std::uint64_t> m_value_;
+  Span<std::uint64_t> m_size_;
+  Span<std::uint8_t> m_info_;
+  Span<std::uint16_t> m_shndx_;
+  Span<std::uint32_t> m_name_;
+
+  DISALLOW_COPY_AND_ASSIGN(SymbolColumns);
+};
+
+}  // namespace xorg
+
+#endif  // XORG_SYMBOL_COLUMNS_H_
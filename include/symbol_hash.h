@@ -0,0 +1,59 @@
+/**
+ * Copyright 2022 hupeng.
+ * SPDX-License-Identifier: MIT
+ */
+#ifndef XORG_SYMBOL_HASH_H_
+#define XORG_SYMBOL_HASH_H_
+
+#include <cstdint>
+#include <string_view>
+
+#include "common.h"
+#include "elf_spec.h"
+#include "string_tab.h"
+#include "symbol_tab.h"
+
+namespace xorg {
+
+// A .gnu.hash (SHT_GNU_HASH) or .hash (SHT_HASH) section, it indexes the
+// symbol table named by its sh_link.
+class SymbolHash {
+ public:
+  static const std::uint32_t kNoSymbol = UINT32_MAX;
+
+  SymbolHash() = default;
+  ~SymbolHash() = default;
+
+  bool Init(SHType type, Span<char> data);
+
+  // Index of `name` in `symbols`, or kNoSymbol.
+  std::uint32_t Find(std::string_view name,
+                     Span<SymbolTab> symbols,
+                     const StringTab& strtab) const;
+
+  static std::uint32_t GnuHash(std::string_view name);
+  static std::uint32_t SysvHash(std::string_view name);
+
+ private:
+  bool InitGnu(Span<char> data);
+  bool InitSysv(Span<char> data);
+
+  std::uint32_t FindGnu(std::string_view name,
+                        Span<SymbolTab> symbols,
+                        const StringTab& strtab) const;
+  std::uint32_t FindSysv(std::string_view name,
+                         Span<SymbolTab> symbols,
+                         const StringTab& strtab) const;
+
+  SHType m_type_ = SHType::SHT_NULL;
+
+  std::uint32_t m_symoffset_ = 0;
+  std::uint32_t m_bloom_shift_ = 0;
+  Span<std::uint64_t> m_bloom_;
+  Span<std::uint32_t> m_buckets_;
+  Span<std::uint32_t> m_chain_;
+};
+
+}  // namespace xorg
+
+#endif  // XORG_SYMBOL_HASH_H_
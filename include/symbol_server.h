@@ -0,0 +1,174 @@
+/**
+ * Copyright 2022 hupeng.
+ * SPDX-License-Identifier: MIT
+ */
+#ifndef XORG_SYMBOL_SERVER_H_
+#define XORG_SYMBOL_SERVER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "address_index.h"
+#include "common.h"
+#include "elf.h"
+#include "thread_pool.h"
+
+namespace xorg {
+
+// A parsed binary with its AddressIndex. Everything a lookup needs is
+// decoded when it is loaded, after that it is only read and can be shared
+// between threads.
+struct LoadedBinary {
+  std::unique_ptr<Elf> elf;
+  AddressIndex index;
+  // hex of the GNU build-id, empty when there is none
+  std::string build_id;
+  // what the file was when loaded, a rebuilt file is loaded again
+  std::uint64_t dev = 0;
+  std::uint64_t ino = 0;
+  std::uint64_t size = 0;
+  std::uint64_t mtime = 0;
+  // the mapping and the index, what the entry costs the cache
+  std::uint64_t bytes = 0;
+};
+
+// Binaries by path, least recently used first out once their bytes go over
+// the budget. A binary is loaded once by the first thread to ask for it,
+// the others wait for that load; an entry is only evicted from the cache,
+// the threads holding it keep it alive.
+class BinaryCache {
+ public:
+  explicit BinaryCache(std::uint64_t budget) : m_budget_(budget) {}
+  ~BinaryCache() = default;
+
+  // nullptr when `path` is not an ELF file that can be parsed
+  std::shared_ptr<const LoadedBinary> Get(const std::string& path);
+
+  std::size_t size() const;
+  std::uint64_t Bytes() const;
+
+ private:
+  using Future = std::shared_future<std::shared_ptr<const LoadedBinary>>;
+  struct Entry {
+    std::string path;
+    Future binary;
+    // 0 while loading
+    std::uint64_t bytes = 0;
+  };
+
+  // drops the least recently used loaded entries until within the budget,
+  // m_mutex_ is held
+  void Evict();
+
+  std::uint64_t m_budget_;
+
+  mutable std::mutex m_mutex_;
+  // most recently used first
+  std::list<Entry> m_lru_;
+  std::unordered_map<std::string, std::list<Entry>::iterator> m_entries_;
+  std::uint64_t m_bytes_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(BinaryCache);
+};
+
+// Symbolizes batches of addresses for clients on a Unix domain socket, from
+// a BinaryCache. One thread polls the connections and reads their requests
+// without blocking; each complete request is answered by a task on a pool,
+// so idle or slow clients hold no worker.
+//
+// Frames are in host byte order, client and server share the host. A
+// request is
+//   u32 size of the rest of the frame
+//   u8  key kind: 0 for a path, 1 for a GNU build-id
+//   u8  0
+//   u16 key size
+//       key: a path, or the raw build-id bytes
+//   u32 address count
+//   u64 addresses
+// and is answered with
+//   u32 size of the rest of the frame
+//   u8  status, a ServerStatus
+//   u8  0, 0, 0
+//   u32 address count, 0 unless the status is kOk
+//   u32 name count
+//       names: u32 size and the bytes of each
+//       one (u32 name index, u64 offset) per address, in request order, the
+//       index is UINT32_MAX when no symbol holds the address
+// A connection carries any number of requests, answered one after the other
+// in the order they came.
+enum class ServerStatus : std::uint8_t {
+  kOk = 0,
+  kNotFound = 1,
+  kBadRequest = 2,
+};
+
+class SymbolServer {
+ public:
+  // `jobs` threads (0 for one per core), `cache_bytes` for the binaries,
+  // build-ids are looked up as <build_id_dir>/xx/xxxx.debug as well as
+  // among the binaries loaded so far.
+  SymbolServer(std::size_t jobs,
+               std::uint64_t cache_bytes,
+               const std::string& build_id_dir);
+  ~SymbolServer();
+
+  // Listens on `socket_path`, replacing a stale socket there, and serves
+  // until Stop(). False when the socket cannot be set up.
+  bool Run(const std::string& socket_path);
+  // Stops accepting and hangs up on the clients once the requests being
+  // answered are. From any thread or a signal handler.
+  void Stop();
+
+  const BinaryCache& Cache() const { return m_cache_; }
+
+ private:
+  struct Connection {
+    // bytes received and not yet part of a request handed out
+    std::string in;
+    // a request of the connection is being answered, it is not polled
+    bool busy = false;
+  };
+
+  // Reads what `fd` has, false when the client hung up.
+  bool Receive(int fd, Connection* conn);
+  // Hands the next complete request of `conn` to the pool.
+  void Dispatch(int fd, Connection* conn, ThreadPool* pool);
+  // Answers `body` on `fd` on a pool thread, the poll thread takes the
+  // connection back through m_done_.
+  void Respond(int fd, const std::string& body);
+  void Done(int fd, bool ok);
+  // the response frame to the request in `body`
+  std::string Answer(const std::string& body);
+  std::shared_ptr<const LoadedBinary> Resolve(std::uint8_t kind,
+                                              const std::string& key);
+
+  std::size_t m_jobs_;
+  std::string m_build_id_dir_;
+  BinaryCache m_cache_;
+
+  std::mutex m_mutex_;
+  // build-id to path of the binaries loaded so far
+  std::unordered_map<std::string, std::string> m_build_ids_;
+  // connections whose request has been answered, false when the answer
+  // could not be sent
+  std::vector<std::pair<int, bool>> m_done_;
+
+  // written to wake the poll thread up
+  int m_wake_[2] = {-1, -1};
+  std::atomic<bool> m_stop_{false};
+
+  DISALLOW_COPY_AND_ASSIGN(SymbolServer);
+};
+
+}  // namespace xorg
+
+#endif  // XORG_SYMBOL_SERVER_H_
@@ -6,36 +6,50 @@
 #define XORG_SYMBOL_TAB_H_
 
 #include <cstdint>
+#include <string>
+#include <string_view>
+
 #include "common.h"
 #include "elf_spec.h"
+#include "output.h"
+#include "symbol_versions.h"
 
 namespace xorg {
 
+// Typed view of an Elf64_Sym inside the mapped file.
 class SymbolTab : private Elf64_Sym {
  public:
   SymbolTab() = default;
   ~SymbolTab() = default;
 
-  static void PrintHeader(std::uint32_t size);
-  void Print() const;
-
-  void SetNum(std::uint32_t num) { m_num_ = num; }
-  void SetName(const std::string& name) { m_name_ = name; }
-  void Parse();
+  static void PrintHeader(Output& out,
+                          std::string_view section,
+                          std::uint32_t size);
+  // `table` names the symbol table in records, the table layout has it in
+  // the PrintHeader() line instead
+  void Print(Output& out,
+             std::string_view table,
+             std::uint32_t num,
+             std::string_view name,
+             const SymbolVersion& version = {}) const;
 
   std::uint32_t Name() const { return st_name; }
+  std::uint8_t Info() const { return st_info; }
+  std::uint16_t Shndx() const { return st_shndx; }
+  std::uint64_t Value() const { return st_value; }
+  std::uint64_t Size() const { return st_size; }
+
+  STType Type() const { return static_cast<STType>(st_info & 0xf); }
+  STBind Bind() const { return static_cast<STBind>(st_info >> 4); }
+  STVisable Visible() const { return static_cast<STVisable>(st_other & 0x03); }
 
  private:
   const std::string& GetType() const;
   const std::string& GetBind() const;
   const std::string& GetVisible() const;
-  const std::string GetShndx() const;
 
-  std::uint32_t m_num_;
-  std::string m_name_;
-  STType m_type_;
-  STBind m_bind_;
-  STVisable m_visible_;
+  // UND/ABS/CMN or the section index, formatted into `buf`
+  std::string_view GetShndx(char* buf, std::size_t size) const;
 };
 
 }  // namespace xorg
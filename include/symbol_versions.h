@@ -0,0 +1,57 @@
+/**
+ * Copyright 2022 hupeng.
+ * SPDX-License-Identifier: MIT
+ */
+#ifndef XORG_SYMBOL_VERSIONS_H_
+#define XORG_SYMBOL_VERSIONS_H_
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "common.h"
+#include "string_tab.h"
+
+namespace xorg {
+
+// Version of one .dynsym entry, empty for unversioned symbols.
+struct SymbolVersion {
+  std::string_view name;
+  // the default version of a definition, printed as name@@version
+  bool is_default = false;
+
+  std::string_view Separator() const { return is_default ? "@@" : "@"; }
+};
+
+// GNU symbol versioning of a .dynsym: the per-symbol .gnu.version indices and
+// one table of version names decoded from .gnu.version_d and .gnu.version_r.
+// Names are views into the dynamic string table.
+class SymbolVersions {
+ public:
+  SymbolVersions() = default;
+  ~SymbolVersions() = default;
+
+  void SetVersym(Span<std::uint16_t> versym) { m_versym_ = versym; }
+  // `count` is the sh_info of the section, its number of entries
+  void AddDefinitions(Span<char> verdef,
+                      std::uint32_t count,
+                      const StringTab& strtab);
+  void AddNeeds(Span<char> verneed,
+                std::uint32_t count,
+                const StringTab& strtab);
+
+  SymbolVersion Get(std::uint32_t symbol) const;
+
+ private:
+  void SetName(std::uint16_t idx, std::string_view name, bool defined);
+
+  Span<std::uint16_t> m_versym_;
+
+  // by version index
+  std::vector<std::string_view> m_names_;
+  std::vector<bool> m_defined_;
+};
+
+}  // namespace xorg
+
+#endif  // XORG_SYMBOL_VERSIONS_H_
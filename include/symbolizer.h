@@ -0,0 +1,61 @@
+/**
+ * Copyright 2022 hupeng.
+ * SPDX-License-Identifier: MIT
+ */
+#ifndef XORG_SYMBOLIZER_H_
+#define XORG_SYMBOLIZER_H_
+
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "address_index.h"
+#include "common.h"
+#include "output.h"
+
+namespace xorg {
+
+class CachedParse;
+class Elf;
+class LineIndex;
+
+// Parses a decimal, 0x hex or 0 octal number, surrounding blanks allowed.
+// False for anything else, negative numbers and overflows included.
+bool ParseAddress(const std::string& str, std::uint64_t* value);
+
+// Names addresses of one binary by the symbol holding them, and by file and
+// line with a LineIndex. The symbols come from a parsed Elf, or from a
+// CachedParse without reading the file at all.
+class Symbolizer {
+ public:
+  // `elf` and `cached` outlive the Symbolizer
+  explicit Symbolizer(const Elf& elf);
+  explicit Symbolizer(const CachedParse& cached);
+  ~Symbolizer() = default;
+
+  // Adds file and line to what Print() prints, `lines` outlives this.
+  void SetLines(LineIndex* lines) { m_lines_ = lines; }
+
+  // One address a line, blank lines are skipped. Anything else is skipped
+  // with a warning naming the line as `source`:N.
+  static std::vector<std::uint64_t> ReadAddresses(std::istream& in,
+                                                  std::string_view source);
+
+  // One line or record per address, in the order of `addrs`.
+  void Print(Span<std::uint64_t> addrs, Output& out) const;
+
+ private:
+  AddressIndex m_index_;
+  // name of a row of the columns the index was built from
+  std::function<std::string_view(std::uint32_t)> m_name_of_;
+  LineIndex* m_lines_ = nullptr;
+
+  DISALLOW_COPY_AND_ASSIGN(Symbolizer);
+};
+
+}  // namespace xorg
+
+#endif  // XORG_SYMBOLIZER_H_
@@ -0,0 +1,62 @@
+/**
+ * Copyright 2022 hupeng.
+ * SPDX-License-Identifier: MIT
+ */
+#ifndef XORG_THREAD_POOL_H_
+#define XORG_THREAD_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "common.h"
+
+namespace xorg {
+
+// Fixed size pool with one task deque per worker. A worker takes from the
+// front of its own deque and, once that is empty, steals from the back of
+// the others. Tasks submitted from inside a task stay on the submitting
+// worker.
+class ThreadPool {
+ public:
+  explicit ThreadPool(std::size_t threads = 0);
+  ~ThreadPool();
+
+  std::size_t size() const { return m_threads_.size(); }
+
+  void Submit(std::function<void()> task);
+  // Blocks until every submitted task has finished.
+  void Wait();
+
+ private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  void Run(std::size_t id);
+  bool Pop(std::size_t id, std::function<void()>& task);
+
+  std::vector<std::unique_ptr<Queue>> m_queues_;
+  std::vector<std::thread> m_threads_;
+
+  std::mutex m_mutex_;
+  std::condition_variable m_work_cv_;
+  std::condition_variable m_done_cv_;
+  std::atomic<std::size_t> m_queued_{0};
+  std::atomic<std::size_t> m_pending_{0};
+  std::atomic<std::size_t> m_next_{0};
+  bool m_stop_ = false;
+
+  DISALLOW_COPY_AND_ASSIGN(ThreadPool);
+};
+
+}  // namespace xorg
+
+#endif  // XORG_THREAD_POOL_H_
@@ -0,0 +1,146 @@
+/**
+ * Copyright 2022 hupeng.
+ * SPDX-License-Identifier: MIT
+ */
+#include "address_index.h"
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+#include "elf.h"
+#include "elf_spec.h"
+
+namespace xorg {
+
+void AddressIndex::Build(const Elf& elf) {
+  Build(elf.Columns());
+}
+
+void AddressIndex::Build(const SymbolColumns& columns) {
+  auto value = columns.Value();
+  auto size = columns.Size();
+
+  std::vector<std::uint32_t> order;
+  for (auto type : {STType::STT_FUNC, STType::STT_OBJECT}) {
+    auto match = columns.Select(SymbolFilter().Type(type));
+    order.insert(order.end(), match.begin(), match.end());
+  }
+  // absolute symbols are not addresses, e.g. the GLIBC_2.x version names
+  order.erase(std::remove_if(order.begin(), order.end(),
+                             [&](std::uint32_t i) {
+                               auto shndx = columns.Shndx()[i];
+                               return shndx == static_cast<std::uint16_t>(
+                                                   SHNdx::SHN_UNDEF) ||
+                                      shndx == static_cast<std::uint16_t>(
+                                                   SHNdx::SHN_ABS);
+                             }),
+              order.end());
+
+  // among aliases of one address keep the largest
+  std::sort(order.begin(), order.end(), [&](std::uint32_t a, std::uint32_t b) {
+    if (value[a] != value[b])
+      return value[a] < value[b];
+    return size[a] > size[b];
+  });
+
+  m_start_.clear();
+  m_end_.clear();
+  m_symbol_.clear();
+  m_cover_.clear();
+  for (auto i : order) {
+    if (!m_start_.empty() && m_start_.back() == value[i])
+      continue;
+    m_start_.push_back(value[i]);
+    // zero sized symbols only cover their own address
+    m_end_.push_back(value[i] + std::max<std::uint64_t>(size[i], 1));
+    m_symbol_.push_back(i);
+
+    // the rank reaching furthest so far, a symbol nested in it may end first
+    std::uint32_t rank = m_start_.size() - 1;
+    if (rank > 0 && m_end_[m_cover_.back()] > m_end_[rank])
+      rank = m_cover_.back();
+    m_cover_.push_back(rank);
+  }
+
+  m_eytzinger_.assign(m_start_.size() + 1, 0);
+  m_rank_.assign(m_start_.size() + 1, 0);
+  std::size_t src = 0;
+  BuildEytzinger(src, 1);
+}
+
+void AddressIndex::BuildEytzinger(std::size_t& src, std::size_t k) {
+  if (k >= m_eytzinger_.size())
+    return;
+
+  BuildEytzinger(src, 2 * k);
+  m_eytzinger_[k] = m_start_[src];
+  m_rank_[k] = src++;
+  BuildEytzinger(src, 2 * k + 1);
+}
+
+SymbolHit AddressIndex::Hit(std::size_t rank, std::uint64_t addr) const {
+  SymbolHit hit;
+  // past the nearest start, addr may still be inside an enclosing symbol
+  if (addr >= m_end_[rank])
+    rank = m_cover_[rank];
+  if (addr < m_end_[rank]) {
+    hit.symbol = m_symbol_[rank];
+    hit.offset = addr - m_start_[rank];
+  }
+  return hit;
+}
+
+SymbolHit AddressIndex::Lookup(std::uint64_t addr) const {
+  const std::size_t n = m_start_.size();
+
+  // descend to the first start greater than addr, the branch free step keeps
+  // the next levels prefetchable
+  std::size_t k = 1;
+  while (k <= n) {
+    k = 2 * k + (m_eytzinger_[k] <= addr);
+  }
+  k >>= __builtin_ffsll(~k);
+
+  // its predecessor in sorted order is the candidate
+  std::size_t upper = (k == 0) ? n : m_rank_[k];
+  if (upper == 0)
+    return {};
+  return Hit(upper - 1, addr);
+}
+
+std::vector<SymbolHit> AddressIndex::Lookup(
+    Span<std::uint64_t> addrs) const {
+  std::vector<SymbolHit> hits(addrs.size());
+
+  std::vector<std::uint32_t> order(addrs.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&](std::uint32_t a, std::uint32_t b) {
+    return addrs[a] < addrs[b];
+  });
+
+  // both sides are sorted now, walk them together. The symbols are not
+  // stepped through one by one but galloped over, so a small batch costs
+  // O(batch * log(symbols)) and a dense one stays linear.
+  const std::size_t n = m_start_.size();
+  std::size_t rank = 0;
+  for (auto i : order) {
+    auto addr = addrs[i];
+    if (rank < n && m_start_[rank] <= addr) {
+      // the first start greater than addr lies in (rank + step / 2,
+      // rank + step]
+      std::size_t step = 1;
+      while (rank + step < n && m_start_[rank + step] <= addr) {
+        step *= 2;
+      }
+      auto first = m_start_.begin() + rank + step / 2 + 1;
+      auto last = m_start_.begin() + std::min(rank + step, n);
+      rank = std::upper_bound(first, last, addr) - m_start_.begin();
+    }
+    if (rank > 0)
+      hits[i] = Hit(rank - 1, addr);
+  }
+  return hits;
+}
+
+}  // namespace xorg
@@ -0,0 +1,212 @@
+/**
+ * Copyright 2022 hupeng.
+ * SPDX-License-Identifier: MIT
+ */
+#include "address_space.h"
+
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "elf.h"
+#include "elf_spec.h"
+
+namespace xorg {
+
+// what ReadAt() returns for .bss, larger ranges go through the scratch
+static const char kZeros[4096] = {};
+
+void AddressSpace::Build(const Elf& elf) {
+  m_zero_fill_ =
+      elf.Header().GetType() != static_cast<std::uint16_t>(EType::ET_CORE);
+
+  m_segments_.clear();
+  auto segments = elf.Segments();
+  for (std::size_t i = 0; i < segments.size(); i++) {
+    const auto& ph = segments[i];
+    if (ph.Type() != static_cast<std::uint32_t>(PHType::PT_LOAD) ||
+        ph.MemSize() == 0)
+      continue;
+    // a view only, no page of the segment is read here
+    m_segments_.push_back({ph.VAddr(), ph.MemSize(), ph.Offset(),
+                           std::min(ph.FileSize(), ph.MemSize()),
+                           elf.SegmentData(i)});
+  }
+  std::sort(m_segments_.begin(), m_segments_.end(),
+            [](const Segment& a, const Segment& b) {
+              return a.vaddr < b.vaddr;
+            });
+  m_last_.store(0, std::memory_order_relaxed);
+}
+
+const AddressSpace::Segment* AddressSpace::Find(std::uint64_t vaddr) const {
+  auto last = m_last_.load(std::memory_order_relaxed);
+  if (last < m_segments_.size() &&
+      vaddr - m_segments_[last].vaddr < m_segments_[last].memsz)
+    return &m_segments_[last];
+
+  auto it = std::upper_bound(m_segments_.begin(), m_segments_.end(), vaddr,
+                             [](std::uint64_t a, const Segment& segment) {
+                               return a < segment.vaddr;
+                             });
+  if (it == m_segments_.begin())
+    return nullptr;
+  --it;
+  if (vaddr - it->vaddr >= it->memsz)
+    return nullptr;
+
+  m_last_.store(it - m_segments_.begin(), std::memory_order_relaxed);
+  return &*it;
+}
+
+bool AddressSpace::ToOffset(std::uint64_t vaddr, std::uint64_t* offset) const {
+  const auto* segment = Find(vaddr);
+  if (segment == nullptr || vaddr - segment->vaddr >= segment->filesz)
+    return false;
+  *offset = segment->offset + (vaddr - segment->vaddr);
+  return true;
+}
+
+Span<char> AddressSpace::ReadAt(std::uint64_t vaddr,
+                                std::size_t size,
+                                std::vector<char>* scratch) const {
+  const auto* segment = Find(vaddr);
+  if (segment == nullptr)
+    return {};
+  auto offset = vaddr - segment->vaddr;
+  if (size > segment->memsz - offset)
+    return {};
+
+  // all in the file
+  if (size <= segment->filesz && offset <= segment->filesz - size) {
+    if (segment->data.empty())
+      return {};
+    return Span<char>(segment->data.data() + offset, size);
+  }
+
+  if (!m_zero_fill_)
+    return {};
+  // all in .bss
+  if (offset >= segment->filesz && size <= sizeof(kZeros))
+    return Span<char>(kZeros, size);
+
+  if (scratch == nullptr || (offset < segment->filesz && segment->data.empty()))
+    return {};
+  scratch->assign(size, 0);
+  if (offset < segment->filesz)
+    std::memcpy(scratch->data(), segment->data.data() + offset,
+                segment->filesz - offset);
+  return Span<char>(scratch->data(), size);
+}
+
+std::size_t AddressSpace::Read(std::uint64_t vaddr,
+                               char* dst,
+                               std::size_t size) const {
+  std::size_t done = 0;
+  while (done < size) {
+    const auto* segment = Find(vaddr + done);
+    if (segment == nullptr)
+      break;
+
+    auto offset = vaddr + done - segment->vaddr;
+    auto n = std::min<std::uint64_t>(size - done, segment->memsz - offset);
+    if (offset < segment->filesz) {
+      if (segment->data.empty())
+        break;
+      n = std::min(n, segment->filesz - offset);
+      std::memcpy(dst + done, segment->data.data() + offset, n);
+    } else {
+      if (!m_zero_fill_)
+        break;
+      std::memset(dst + done, 0, n);
+    }
+    done += n;
+  }
+  return done;
+}
+
+std::string_view AddressSpace::StringAt(std::uint64_t vaddr,
+                                        std::size_t max) const {
+  const auto* segment = Find(vaddr);
+  if (segment == nullptr || segment->data.empty())
+    return {};
+  auto offset = vaddr - segment->vaddr;
+  if (offset >= segment->filesz)
+    return {};
+
+  const char* str = segment->data.data() + offset;
+  auto len = std::min<std::uint64_t>(max, segment->filesz - offset);
+  const void* nul = std::memchr(str, '\0', len);
+  if (nul != nullptr)
+    len = static_cast<const char*>(nul) - str;
+  return std::string_view(str, len);
+}
+
+std::uint64_t AddressSpace::Dump(std::uint64_t vaddr,
+                                 std::uint64_t size,
+                                 Output& out) const {
+  static const char kHex[] = "0123456789abcdef";
+  if (size > kMaxDump) {
+    spdlog::warn("{:#x}: dumping {} of {} bytes", vaddr, kMaxDump, size);
+    size = kMaxDump;
+  }
+  // no wrapping past the top of the address space
+  if (vaddr + size < vaddr)
+    size = -vaddr;
+
+  // read a chunk at a time, up to the first byte that is not mapped
+  char chunk[4096];
+  std::uint64_t done = 0;
+  std::string hex;
+  while (done < size) {
+    auto want = std::min<std::uint64_t>(sizeof(chunk), size - done);
+    auto got = Read(vaddr + done, chunk, want);
+
+    if (!out.IsTable()) {
+      for (std::size_t i = 0; i < got; i++) {
+        unsigned char byte = chunk[i];
+        hex += kHex[byte >> 4];
+        hex += kHex[byte & 0xf];
+      }
+    } else {
+      // 16 bytes a line, like xxd; chunks are whole lines
+      for (std::size_t line = 0; line < got; line += 16) {
+        std::string line_hex;
+        std::string text;
+        for (auto i = line; i < line + 16; i++) {
+          if (i < got) {
+            unsigned char byte = chunk[i];
+            line_hex += kHex[byte >> 4];
+            line_hex += kHex[byte & 0xf];
+            text += byte >= 0x20 && byte < 0x7f ? byte : '.';
+          } else {
+            line_hex += "  ";
+          }
+          if (i % 2 == 1)
+            line_hex += ' ';
+        }
+        out.Print("{:016x}: {} {}\n", vaddr + done + line, line_hex, text);
+      }
+    }
+
+    done += got;
+    if (got < want)
+      break;
+  }
+  if (done < size)
+    spdlog::warn("{:#x}: {} of {} bytes mapped", vaddr, done, size);
+
+  if (!out.IsTable()) {
+    out.BeginRecord();
+    out.HexField("address", vaddr);
+    out.Field("size", done);
+    out.Field("bytes", hex);
+    out.EndRecord();
+  }
+  return done;
+}
+
+}  // namespace xorg
@@ -0,0 +1,39 @@
+/**
+ * Copyright 2022 hupeng.
+ * SPDX-License-Identifier: MIT
+ */
+#include "arena.h"
+
+#include <spdlog/spdlog.h>
+
+namespace xorg {
+
+// alignment padding and chunk headers of the upstream allocations
+static const std::size_t kSlack = 1 << 10;
+
+Arena::Arena(std::size_t initial)
+    : m_block_(new char[initial]), m_capacity_(initial) {
+  m_resource_.emplace(m_block_.get(), m_capacity_);
+}
+
+void Arena::Reset() {
+  auto used = m_used_;
+  m_peak_ = Peak();
+  m_used_ = 0;
+
+  // destroying the resource hands its chunks back to the heap
+  m_resource_.reset();
+  if (used > m_capacity_) {
+    m_capacity_ = used + used / 4 + kSlack;
+    m_block_.reset(new char[m_capacity_]);
+    spdlog::debug("arena grown to {} bytes", m_capacity_);
+  }
+  m_resource_.emplace(m_block_.get(), m_capacity_);
+}
+
+void* Arena::do_allocate(std::size_t bytes, std::size_t alignment) {
+  m_used_ += bytes;
+  return m_resource_->allocate(bytes, alignment);
+}
+
+}  // namespace xorg
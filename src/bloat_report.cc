@@ -0,0 +1,102 @@
+/**
+ * Copyright 2022 hupeng.
+ * SPDX-License-Identifier: MIT
+ */
+#include "bloat_report.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "demangler.h"
+#include "output.h"
+
+namespace xorg {
+
+BloatReport::BloatReport() : m_nodes_(1) {}
+
+void BloatReport::Add(std::string_view scope, std::uint64_t size) {
+  m_nodes_[0].size += size;
+  m_nodes_[0].symbols++;
+
+  std::uint32_t parent = 0;
+  for (auto part : Demangler::Split(scope)) {
+    // parts are views into `scope`, a prefix of it names a node
+    std::string_view path(scope.data(),
+                          part.data() + part.size() - scope.data());
+    auto it = m_index_.find(path);
+    std::uint32_t idx;
+    if (it != m_index_.end()) {
+      idx = it->second;
+    } else {
+      idx = m_nodes_.size();
+      m_index_.emplace(path, idx);
+      m_nodes_[parent].children.push_back(idx);
+      m_nodes_.emplace_back();
+      m_nodes_.back().name = part;
+      m_nodes_.back().path = path;
+    }
+    m_nodes_[idx].size += size;
+    m_nodes_[idx].symbols++;
+    parent = idx;
+  }
+}
+
+void BloatReport::Print(Output& out, std::size_t top, std::size_t depth) const {
+  if (out.IsTable()) {
+    out.Print("{} bytes in {} symbols\n", TotalSize(), TotalSymbols());
+    out.Print("{:>12} {:>6} {:>8}  {}\n", "size", "%", "symbols", "scope");
+  }
+  PrintNode(out, 0, 0, top, depth);
+}
+
+void BloatReport::PrintNode(Output& out,
+                            std::uint32_t idx,
+                            std::size_t level,
+                            std::size_t top,
+                            std::size_t depth) const {
+  if (level == depth)
+    return;
+
+  // only the first `top` are put in order
+  auto children = m_nodes_[idx].children;
+  auto shown = std::min(top, children.size());
+  std::partial_sort(children.begin(), children.begin() + shown,
+                    children.end(), [&](std::uint32_t a, std::uint32_t b) {
+                      return m_nodes_[a].size > m_nodes_[b].size;
+                    });
+
+  auto total = std::max<std::uint64_t>(TotalSize(), 1);
+  for (std::size_t i = 0; i < shown; i++) {
+    const auto& node = m_nodes_[children[i]];
+    if (out.IsTable()) {
+      out.Print("{:>12} {:>5.1f}% {:>8}  {:>{}}{}\n", node.size,
+                100.0 * node.size / total, node.symbols, "", level * 2,
+                node.name);
+    } else {
+      out.BeginRecord();
+      out.Field("scope", node.path);
+      out.Field("depth", level);
+      out.Field("size", node.size);
+      out.Field("symbols", node.symbols);
+      out.EndRecord();
+    }
+    PrintNode(out, children[i], level + 1, top, depth);
+  }
+
+  // what the cut left out, in the table only
+  if (shown < children.size() && out.IsTable()) {
+    std::uint64_t size = 0;
+    std::uint64_t symbols = 0;
+    for (auto i = shown; i < children.size(); i++) {
+      size += m_nodes_[children[i]].size;
+      symbols += m_nodes_[children[i]].symbols;
+    }
+    out.Print("{:>12} {:>5.1f}% {:>8}  {:>{}}({} more)\n", size,
+              100.0 * size / total, symbols, "", level * 2,
+              children.size() - shown);
+  }
+}
+
+}  // namespace xorg
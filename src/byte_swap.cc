@@ -0,0 +1,110 @@
+/**
+ * Copyright 2022 hupeng.
+ * SPDX-License-Identifier: MIT
+ */
+#include "byte_swap.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <vector>
+
+namespace xorg {
+
+static const std::size_t kChunk = 16;
+
+SwapLayout::SwapLayout(std::initializer_list<std::uint8_t> widths)
+    : m_widths_(widths) {
+  for (auto width : m_widths_) {
+    m_record_ += width;
+  }
+
+  // lcm(record, 16) bytes are the first to end on a record boundary
+  std::size_t group = std::lcm(m_record_, kChunk);
+  std::vector<std::uint8_t> shuffle(group);
+  std::size_t pos = 0;
+  while (pos < group) {
+    for (auto width : m_widths_) {
+      std::size_t chunk = pos / kChunk;
+      // no shuffle can move a byte across chunks
+      if ((pos + width - 1) / kChunk != chunk)
+        return;
+      for (std::size_t i = 0; i < width; i++) {
+        shuffle[pos + i] = pos + width - 1 - i - chunk * kChunk;
+      }
+      pos += width;
+    }
+  }
+
+  m_group_records_ = group / m_record_;
+  m_shuffle_ = std::move(shuffle);
+}
+
+void SwapLayout::Swap(const void* src, void* dst, std::size_t count) const {
+  const auto* in = static_cast<const char*>(src);
+  auto* out = static_cast<char*>(dst);
+
+  std::size_t done = 0;
+#if defined(__x86_64__)
+  static const bool has_ssse3 = __builtin_cpu_supports("ssse3");
+  if (has_ssse3 && m_group_records_ != 0)
+    done = SwapSsse3(in, out, count);
+#endif
+
+  SwapScalar(in + done * m_record_, out + done * m_record_, count - done);
+}
+
+void SwapLayout::SwapScalar(const char* src,
+                            char* dst,
+                            std::size_t count) const {
+  for (std::size_t r = 0; r < count; r++) {
+    for (auto width : m_widths_) {
+      // src and dst may alias
+      char field[8];
+      std::memcpy(field, src, width);
+      for (std::size_t i = 0; i < width; i++) {
+        dst[i] = field[width - 1 - i];
+      }
+      src += width;
+      dst += width;
+    }
+  }
+}
+
+#if defined(__x86_64__)
+
+// Leaves the records after the last whole group to SwapScalar().
+__attribute__((target("ssse3"))) std::size_t SwapLayout::SwapSsse3(
+    const char* src,
+    char* dst,
+    std::size_t count) const {
+  const std::size_t groups = count / m_group_records_;
+  const std::size_t chunks = m_shuffle_.size() / kChunk;
+  const auto* masks = reinterpret_cast<const __m128i*>(m_shuffle_.data());
+
+  for (std::size_t g = 0; g < groups; g++) {
+    const auto* in = reinterpret_cast<const __m128i*>(src) + g * chunks;
+    auto* out = reinterpret_cast<__m128i*>(dst) + g * chunks;
+    for (std::size_t c = 0; c < chunks; c++) {
+      __m128i x = _mm_loadu_si128(in + c);
+      _mm_storeu_si128(out + c,
+                       _mm_shuffle_epi8(x, _mm_loadu_si128(masks + c)));
+    }
+  }
+  return groups * m_group_records_;
+}
+
+#else
+
+std::size_t SwapLayout::SwapSsse3(const char* src,
+                                  char* dst,
+                                  std::size_t count) const {
+  return 0;
+}
+
+#endif
+
+}  // namespace xorg
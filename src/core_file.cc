@@ -0,0 +1,328 @@
+/**
+ * Copyright 2022 hupeng.
+ * SPDX-License-Identifier: MIT
+ */
+#include "core_file.h"
+
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "elf.h"
+#include "elf_spec.h"
+#include "output.h"
+
+namespace xorg {
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+static const bool kHostLittle = true;
+#else
+static const bool kHostLittle = false;
+#endif
+
+// Where prstatus keeps pr_cursig, pr_pid and pr_reg, by size of a long.
+static const std::uint64_t kSignalOffset = 12;
+static const std::uint64_t kTidOffset64 = 32;
+static const std::uint64_t kTidOffset32 = 24;
+static const std::uint64_t kRegistersOffset64 = 112;
+static const std::uint64_t kRegistersOffset32 = 72;
+
+// pr_reg of a machine: its size in longs, and where pc and sp are in it
+struct RegisterLayout {
+  EMachine machine;
+  std::size_t count;
+  std::size_t pc;
+  std::size_t sp;
+};
+
+static const RegisterLayout kRegisterLayouts[] = {
+    {EMachine::EM_X86_64, 27, 16, 19}, {EMachine::EM_386, 17, 12, 15},
+    {EMachine::EM_AARCH64, 34, 32, 31}, {EMachine::EM_ARM, 18, 15, 13},
+    {EMachine::EM_RISCV, 32, 0, 2},
+};
+
+bool CoreFile::Parse() {
+  const auto& header = m_elf_.Header();
+  if (header.GetType() != static_cast<std::uint16_t>(EType::ET_CORE)) {
+    spdlog::error("{}: not a core file", m_elf_.Filename());
+    return false;
+  }
+  bool little =
+      header.GetData() == static_cast<std::uint8_t>(EIdata::ELFDATA2LSB);
+  m_swap_ = little != kHostLittle;
+  m_word_ =
+      header.GetClass() == static_cast<std::uint8_t>(EIClass::ELFCLASS32) ? 4
+                                                                          : 8;
+
+  auto segments = m_elf_.Segments();
+  for (std::size_t i = 0; i < segments.size(); i++) {
+    const auto& ph = segments[i];
+    if (ph.Type() == static_cast<std::uint32_t>(PHType::PT_NOTE))
+      ParseNotes(m_elf_.SegmentData(i), ph.Align());
+  }
+  m_memory_.Build(m_elf_);
+
+  std::sort(m_mappings_.begin(), m_mappings_.end(),
+            [](const CoreMapping& a, const CoreMapping& b) {
+              return a.start < b.start;
+            });
+  return true;
+}
+
+std::uint64_t CoreFile::Read(Span<char> data,
+                             std::uint64_t offset,
+                             std::size_t size) const {
+  if (offset > data.size() || size > data.size() - offset)
+    return 0;
+
+  switch (size) {
+    case 2: {
+      std::uint16_t value;
+      std::memcpy(&value, data.data() + offset, size);
+      return m_swap_ ? __builtin_bswap16(value) : value;
+    }
+    case 4: {
+      std::uint32_t value;
+      std::memcpy(&value, data.data() + offset, size);
+      return m_swap_ ? __builtin_bswap32(value) : value;
+    }
+    case 8: {
+      std::uint64_t value;
+      std::memcpy(&value, data.data() + offset, size);
+      return m_swap_ ? __builtin_bswap64(value) : value;
+    }
+    default:
+      return 0;
+  }
+}
+
+// Notes of a core are padded to 4 bytes, unless the segment is aligned to 8.
+void CoreFile::ParseNotes(Span<char> data, std::uint64_t align) {
+  align = align == 8 ? 8 : 4;
+  auto padded = [&](std::uint64_t size) {
+    return (size + align - 1) & ~(align - 1);
+  };
+
+  std::uint64_t offset = 0;
+  while (data.size() - offset >= sizeof(Elf64_Nhdr)) {
+    auto namesz = Read(data, offset, 4);
+    auto descsz = Read(data, offset + 4, 4);
+    auto type = Read(data, offset + 8, 4);
+    std::uint64_t name = offset + sizeof(Elf64_Nhdr);
+    std::uint64_t desc = name + padded(namesz);
+    if (desc > data.size() || descsz > data.size() - desc)
+      break;
+
+    // "CORE\0", the other owners ("LINUX") hold register sets we skip
+    std::string_view owner(data.data() + name, namesz);
+    Span<char> descriptor(data.data() + desc, descsz);
+    if (owner == std::string_view("CORE", 5)) {
+      switch (type) {
+        case NT_PRSTATUS:
+          ParseStatus(descriptor);
+          break;
+        case NT_FILE:
+          ParseFiles(descriptor);
+          break;
+        case NT_AUXV:
+          ParseAuxv(descriptor);
+          break;
+        default:
+          break;
+      }
+    }
+
+    offset = desc + padded(descsz);
+    if (offset > data.size())
+      break;
+  }
+}
+
+void CoreFile::ParseStatus(Span<char> desc) {
+  bool is64 = m_word_ == 8;
+  CoreThread thread;
+  thread.signal = Read(desc, kSignalOffset, 2);
+  thread.tid = Read(desc, is64 ? kTidOffset64 : kTidOffset32, 4);
+
+  auto regs = is64 ? kRegistersOffset64 : kRegistersOffset32;
+  for (const auto& layout : kRegisterLayouts) {
+    if (static_cast<std::uint16_t>(layout.machine) !=
+        m_elf_.Header().GetMachine())
+      continue;
+    if (regs + layout.count * m_word_ <= desc.size()) {
+      thread.registers =
+          Span<char>(desc.data() + regs, layout.count * m_word_);
+      thread.pc = Read(desc, regs + layout.pc * m_word_, m_word_);
+      thread.sp = Read(desc, regs + layout.sp * m_word_, m_word_);
+    }
+    break;
+  }
+  m_threads_.push_back(thread);
+}
+
+// A count and a page size, a (start, end, page offset) triple per file and
+// then their paths, all of them NUL terminated.
+void CoreFile::ParseFiles(Span<char> desc) {
+  auto count = Read(desc, 0, m_word_);
+  auto page_size = Read(desc, m_word_, m_word_);
+  std::uint64_t path = (2 + 3 * count) * m_word_;
+  if (count > desc.size() / (3 * m_word_) || path > desc.size())
+    return;
+
+  m_mappings_.reserve(m_mappings_.size() + count);
+  for (std::uint64_t i = 0; i < count && path < desc.size(); i++) {
+    auto entry = (2 + 3 * i) * m_word_;
+    CoreMapping mapping;
+    mapping.start = Read(desc, entry, m_word_);
+    mapping.end = Read(desc, entry + m_word_, m_word_);
+    mapping.offset = Read(desc, entry + 2 * m_word_, m_word_) * page_size;
+
+    const char* str = desc.data() + path;
+    const void* nul = std::memchr(str, '\0', desc.size() - path);
+    auto len = nul != nullptr ? static_cast<const char*>(nul) - str
+                              : desc.size() - path;
+    mapping.path = std::string_view(str, len);
+    path += len + 1;
+    m_mappings_.push_back(mapping);
+  }
+}
+
+void CoreFile::ParseAuxv(Span<char> desc) {
+  for (std::uint64_t offset = 0; offset + 2 * m_word_ <= desc.size();
+       offset += 2 * m_word_) {
+    AuxEntry entry{Read(desc, offset, m_word_),
+                   Read(desc, offset + m_word_, m_word_)};
+    if (entry.type == static_cast<std::uint64_t>(AuxType::AT_NULL))
+      break;
+    m_auxv_.push_back(entry);
+  }
+}
+
+std::uint64_t CoreFile::Aux(AuxType type) const {
+  for (const auto& entry : m_auxv_) {
+    if (entry.type == static_cast<std::uint64_t>(type))
+      return entry.value;
+  }
+  return 0;
+}
+
+const CoreMapping* CoreFile::FindMapping(std::uint64_t addr) const {
+  auto it = std::upper_bound(
+      m_mappings_.begin(), m_mappings_.end(), addr,
+      [](std::uint64_t a, const CoreMapping& m) { return a < m.start; });
+  if (it == m_mappings_.begin())
+    return nullptr;
+  --it;
+  return addr < it->end ? &*it : nullptr;
+}
+
+static const std::string& AuxTypeName(std::uint64_t type) {
+  static const std::map<AuxType, std::string> typeMap{
+      {AuxType::AT_IGNORE, "AT_IGNORE"},
+      {AuxType::AT_EXECFD, "AT_EXECFD"},
+      {AuxType::AT_PHDR, "AT_PHDR"},
+      {AuxType::AT_PHENT, "AT_PHENT"},
+      {AuxType::AT_PHNUM, "AT_PHNUM"},
+      {AuxType::AT_PAGESZ, "AT_PAGESZ"},
+      {AuxType::AT_BASE, "AT_BASE"},
+      {AuxType::AT_FLAGS, "AT_FLAGS"},
+      {AuxType::AT_ENTRY, "AT_ENTRY"},
+      {AuxType::AT_NOTELF, "AT_NOTELF"},
+      {AuxType::AT_UID, "AT_UID"},
+      {AuxType::AT_EUID, "AT_EUID"},
+      {AuxType::AT_GID, "AT_GID"},
+      {AuxType::AT_EGID, "AT_EGID"},
+      {AuxType::AT_PLATFORM, "AT_PLATFORM"},
+      {AuxType::AT_HWCAP, "AT_HWCAP"},
+      {AuxType::AT_CLKTCK, "AT_CLKTCK"},
+      {AuxType::AT_SECURE, "AT_SECURE"},
+      {AuxType::AT_BASE_PLATFORM, "AT_BASE_PLATFORM"},
+      {AuxType::AT_RANDOM, "AT_RANDOM"},
+      {AuxType::AT_HWCAP2, "AT_HWCAP2"},
+      {AuxType::AT_EXECFN, "AT_EXECFN"},
+      {AuxType::AT_SYSINFO, "AT_SYSINFO"},
+      {AuxType::AT_SYSINFO_EHDR, "AT_SYSINFO_EHDR"},
+      {AuxType::AT_MINSIGSTKSZ, "AT_MINSIGSTKSZ"},
+  };
+  static const std::string unknown("Unknown");
+
+  return GetMapValWithDef(typeMap, static_cast<AuxType>(type), unknown);
+}
+
+void CoreFile::Print(Output& out) const {
+  // the one read from memory, a string on the stack of the process
+  auto execfn = m_memory_.StringAt(Aux(AuxType::AT_EXECFN));
+  std::uint64_t memory = 0;
+  std::uint64_t dumped = 0;
+  for (const auto& segment : m_memory_.Segments()) {
+    memory += segment.memsz;
+    dumped += segment.filesz;
+  }
+
+  if (!out.IsTable()) {
+    out.BeginRecord();
+    out.Field("kind", "process");
+    out.Field("execfn", execfn);
+    out.Field("threads", m_threads_.size());
+    out.Field("segments", m_memory_.Segments().size());
+    out.Field("memory", memory);
+    out.Field("dumped", dumped);
+    out.EndRecord();
+    for (const auto& thread : m_threads_) {
+      out.BeginRecord();
+      out.Field("kind", "thread");
+      out.Field("tid", thread.tid);
+      out.Field("signal", thread.signal);
+      out.HexField("pc", thread.pc);
+      out.HexField("sp", thread.sp);
+      out.EndRecord();
+    }
+    for (const auto& mapping : m_mappings_) {
+      out.BeginRecord();
+      out.Field("kind", "mapping");
+      out.HexField("start", mapping.start);
+      out.HexField("end", mapping.end);
+      out.HexField("offset", mapping.offset);
+      out.Field("path", mapping.path);
+      out.EndRecord();
+    }
+    for (const auto& entry : m_auxv_) {
+      out.BeginRecord();
+      out.Field("kind", "auxv");
+      out.Field("type", AuxTypeName(entry.type));
+      out.HexField("value", entry.value);
+      out.EndRecord();
+    }
+    return;
+  }
+
+  out.Print("Core of {}: {} threads, {} segments of {} bytes, {} of them "
+            "dumped\n",
+            execfn.empty() ? "?" : execfn, m_threads_.size(),
+            m_memory_.Segments().size(), memory, dumped);
+
+  out.Print("\nThreads:\n");
+  out.Print("  {:<10}{:<8}{:<20}{}\n", "TID", "Signal", "PC", "SP");
+  for (const auto& thread : m_threads_) {
+    out.Print("  {:<10}{:<8}0x{:016x}  0x{:016x}\n", thread.tid,
+              thread.signal, thread.pc, thread.sp);
+  }
+
+  out.Print("\nMapped files:\n");
+  out.Print("  {:<20}{:<20}{:<12}{}\n", "Start", "End", "Offset", "Path");
+  for (const auto& mapping : m_mappings_) {
+    out.Print("  0x{:016x}  0x{:016x}  0x{:<10x}{}\n", mapping.start,
+              mapping.end, mapping.offset, mapping.path);
+  }
+
+  out.Print("\nAuxiliary vector:\n");
+  for (const auto& entry : m_auxv_) {
+    out.Print("  {:<18}0x{:x}\n", AuxTypeName(entry.type), entry.value);
+  }
+}
+
+}  // namespace xorg
@@ -0,0 +1,133 @@
+/**
+ * Copyright 2022 hupeng.
+ * SPDX-License-Identifier: MIT
+ */
+#include "decompress.h"
+
+#include <zlib.h>
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#ifdef XORG_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace xorg {
+
+BufferPool& BufferPool::Default() {
+  static BufferPool pool;
+  return pool;
+}
+
+BufferPool::Buffer BufferPool::Acquire(std::size_t size) {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex_);
+    auto it = m_free_.lower_bound(size);
+    // a much larger buffer is left for a section that needs it
+    if (it != m_free_.end() && it->first / 2 <= size) {
+      Buffer buffer{std::move(it->second), it->first};
+      m_pooled_bytes_ -= it->first;
+      m_free_.erase(it);
+      return buffer;
+    }
+  }
+  // not value-initialized, decompression writes every byte
+  return Buffer{std::unique_ptr<char[]>(new char[size]), size};
+}
+
+void BufferPool::Release(Buffer buffer) {
+  if (buffer.data == nullptr)
+    return;
+
+  std::lock_guard<std::mutex> lock(m_mutex_);
+  if (m_pooled_bytes_ + buffer.capacity > m_max_bytes_)
+    return;
+  m_pooled_bytes_ += buffer.capacity;
+  m_free_.emplace(buffer.capacity, std::move(buffer.data));
+}
+
+std::size_t BufferPool::PooledBytes() const {
+  std::lock_guard<std::mutex> lock(m_mutex_);
+  return m_pooled_bytes_;
+}
+
+// zlib counts in uInt, sections past 4 GiB are fed to it in pieces. Running
+// out of input or of room before the end of the stream is a Z_BUF_ERROR.
+static bool Inflate(Span<char> src, char* dst, std::uint64_t size) {
+  z_stream stream{};
+  if (inflateInit(&stream) != Z_OK)
+    return false;
+
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(src.data()));
+  stream.next_out = reinterpret_cast<Bytef*>(dst);
+  std::uint64_t in_left = src.size();
+  std::uint64_t out_left = size;
+  int ret = Z_OK;
+  while (ret == Z_OK) {
+    auto in = static_cast<uInt>(std::min<std::uint64_t>(in_left, UINT_MAX));
+    auto out = static_cast<uInt>(std::min<std::uint64_t>(out_left, UINT_MAX));
+    stream.avail_in = in;
+    stream.avail_out = out;
+    ret = inflate(&stream, Z_NO_FLUSH);
+    in_left -= in - stream.avail_in;
+    out_left -= out - stream.avail_out;
+  }
+  inflateEnd(&stream);
+  return ret == Z_STREAM_END && out_left == 0;
+}
+
+bool CanDecompress(ChType type) {
+  switch (type) {
+    case ChType::ELFCOMPRESS_ZLIB:
+      return true;
+    case ChType::ELFCOMPRESS_ZSTD:
+#ifdef XORG_HAVE_ZSTD
+      return true;
+#else
+      return false;
+#endif
+  }
+  return false;
+}
+
+bool PlausibleSize(ChType type, Span<char> src, std::uint64_t size) {
+  switch (type) {
+    case ChType::ELFCOMPRESS_ZLIB:
+      // deflate expands at most about 1032:1
+      return size / 1032 <= src.size();
+    case ChType::ELFCOMPRESS_ZSTD: {
+#ifdef XORG_HAVE_ZSTD
+      auto frame = ZSTD_getFrameContentSize(src.data(), src.size());
+      if (frame == ZSTD_CONTENTSIZE_ERROR)
+        return false;
+      if (frame != ZSTD_CONTENTSIZE_UNKNOWN)
+        return frame == size;
+#endif
+      // an RLE block of 128 KiB takes 4 bytes
+      return size / 32768 <= src.size();
+    }
+  }
+  return false;
+}
+
+bool Decompress(ChType type, Span<char> src, char* dst, std::uint64_t size) {
+  switch (type) {
+    case ChType::ELFCOMPRESS_ZLIB:
+      return Inflate(src, dst, size);
+    case ChType::ELFCOMPRESS_ZSTD: {
+#ifdef XORG_HAVE_ZSTD
+      auto ret = ZSTD_decompress(dst, size, src.data(), src.size());
+      return !ZSTD_isError(ret) && ret == size;
+#else
+      return false;
+#endif
+    }
+  }
+  return false;
+}
+
+}  // namespace xorg
@@ -0,0 +1,270 @@
+/**
+ * Copyright 2022 hupeng.
+ * SPDX-License-Identifier: MIT
+ */
+#include "demangler.h"
+
+#include <llvm/Demangle/Demangle.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "thread_pool.h"
+
+namespace xorg {
+
+// names demangled by one task
+static const std::size_t kChunk = 1024;
+
+// Operators whose spelling holds brackets, longest first.
+static const char* const kBracketOperators[] = {
+    "<<=", ">>=", "<=>", "->*", "<<", ">>", "<=", ">=",
+    "->",  "()",  "[]",  "<",   ">",
+};
+
+static bool IsIdentifier(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+         (c >= '0' && c <= '9') || c == '_';
+}
+
+// Length of "vtable for ", "non-virtual thunk to " ... in front of `name`,
+// 0 if there is none.
+static std::size_t SpecialPrefix(std::string_view name) {
+  for (std::string_view word : {" for ", " to "}) {
+    auto special = name.find(word);
+    if (special != std::string_view::npos &&
+        name.substr(0, special).find_first_of(":<({") ==
+            std::string_view::npos)
+      return special + word.size();
+  }
+  return 0;
+}
+
+// End of the parameter list opening at `open`, past cv and ref qualifiers,
+// when the name ends there or a "::" follows: the list of the function
+// itself or of one enclosing a local entity. npos otherwise.
+static std::size_t ParamsEnd(std::string_view name, std::size_t open) {
+  std::size_t depth = 0;
+  for (auto i = open; i < name.size(); i++) {
+    if (name[i] == '(') {
+      depth++;
+    } else if (name[i] == ')' && --depth == 0) {
+      auto end = std::min(name.find("::", i + 1), name.size());
+      if (name.substr(i + 1, end - i - 1).find_first_not_of(
+              " &abcdefghijklmnopqrstuvwxyz") != std::string_view::npos)
+        return std::string_view::npos;
+      return end;
+    }
+  }
+  return std::string_view::npos;
+}
+
+// Scope of a demangled name: the contents of every template argument list
+// are dropped, and so are parameters and return types of functions, "int
+// foo<int>(int)::bar" is "foo<>::bar".
+static std::string ScopeOf(std::string_view name) {
+  auto special = SpecialPrefix(name);
+  std::string scope(name.substr(0, special));
+  scope.reserve(name.size());
+  auto begin = scope.size();
+  // after the last space outside brackets, where a return type ends
+  auto name_begin = begin;
+  // the return type goes with the first parameter list
+  bool return_cut = false;
+  bool in_operator = false;
+  std::size_t angles = 0;
+  std::size_t brackets = 0;
+  for (auto i = special; i < name.size(); i++) {
+    char c = name[i];
+    if (c == 'o' && name.compare(i, 8, "operator") == 0 &&
+        (i == 0 || !IsIdentifier(name[i - 1]))) {
+      // the brackets of operator< or operator() open no list
+      std::string_view op = "operator";
+      for (const auto* bracket : kBracketOperators) {
+        if (name.compare(i + 8, std::strlen(bracket), bracket) == 0) {
+          op = name.substr(i, 8 + std::strlen(bracket));
+          break;
+        }
+      }
+      if (angles == 0) {
+        scope.append(op);
+        // "operator new", "operator unsigned long" end no return type
+        in_operator = true;
+      }
+      i += op.size() - 1;
+      continue;
+    }
+
+    if (angles > 0) {
+      if (c == '<') {
+        angles++;
+      } else if (c == '>' && --angles == 0) {
+        scope += c;
+      }
+      continue;
+    }
+
+    switch (c) {
+      case '<':
+        angles++;
+        break;
+      case '(':
+        // "(anonymous namespace)" is a name, not a parameter list
+        if (brackets == 0 && scope.size() > begin && scope.back() != ':') {
+          auto end = ParamsEnd(name, i);
+          if (end != std::string_view::npos) {
+            if (!return_cut)
+              scope.erase(begin, name_begin - begin);
+            return_cut = true;
+            in_operator = false;
+            i = end - 1;
+            continue;
+          }
+        }
+        brackets++;
+        break;
+      case '[':
+      case '{':
+        brackets++;
+        break;
+      case ')':
+      case ']':
+      case '}':
+        if (brackets > 0)
+          brackets--;
+        break;
+      case ' ':
+        if (brackets == 0 && !in_operator && !return_cut)
+          name_begin = scope.size() + 1;
+        break;
+      case ':':
+        in_operator = false;
+        break;
+      default:
+        break;
+    }
+    scope += c;
+  }
+  return scope;
+}
+
+// Scope of `mangled`. `buf` is the malloc()ed output buffer of the
+// demangler, of `size` bytes, reused from one name to the next.
+static std::string Scope(llvm::ItaniumPartialDemangler& demangler,
+                         const std::string& mangled,
+                         char** buf,
+                         std::size_t* size) {
+  if (mangled.compare(0, 2, "_Z") != 0)
+    return mangled;
+
+  // GCC clones (".part.0", ".cold", ".isra.0") count to the function they
+  // were split from, mangled names hold no dots otherwise
+  auto dot = mangled.find('.');
+  std::string base;
+  if (dot != std::string::npos)
+    base = mangled.substr(0, dot);
+  if (demangler.partialDemangle(dot != std::string::npos ? base.c_str()
+                                                        : mangled.c_str()))
+    return mangled;
+
+  // functions without parameters and return type, anything else whole
+  std::size_t n = *size;
+  char* out = demangler.isFunction() ? demangler.getFunctionName(*buf, &n)
+                                     : demangler.finishDemangle(*buf, &n);
+  if (out == nullptr)
+    return mangled;
+  *buf = out;
+  // n counts the NUL
+  *size = n;
+  return ScopeOf(std::string_view(out, n > 0 ? n - 1 : 0));
+}
+
+std::vector<std::string_view> Demangler::Scopes(
+    const std::vector<std::string_view>& names) {
+  // names seen for the first time, their scopes are filled in below; the
+  // nodes do not move when the map grows
+  std::vector<std::pair<const std::string, std::string>*> todo;
+  std::vector<const std::string*> memo(names.size());
+  for (std::size_t i = 0; i < names.size(); i++) {
+    auto it = m_memo_.try_emplace(std::string(names[i]));
+    if (it.second)
+      todo.push_back(&*it.first);
+    memo[i] = &it.first->second;
+  }
+
+  auto demangle = [&todo](std::size_t begin, std::size_t end) {
+    llvm::ItaniumPartialDemangler demangler;
+    char* buf = nullptr;
+    std::size_t size = 0;
+    for (auto i = begin; i < end; i++) {
+      todo[i]->second = Scope(demangler, todo[i]->first, &buf, &size);
+    }
+    std::free(buf);
+  };
+  if (todo.size() <= kChunk) {
+    demangle(0, todo.size());
+  } else {
+    // each task writes the scopes of its own names only
+    ThreadPool pool(m_jobs_);
+    for (std::size_t begin = 0; begin < todo.size(); begin += kChunk) {
+      pool.Submit([&, begin] {
+        demangle(begin, std::min(begin + kChunk, todo.size()));
+      });
+    }
+    pool.Wait();
+  }
+
+  std::vector<std::string_view> scopes;
+  scopes.reserve(names.size());
+  for (const auto* scope : memo) {
+    scopes.emplace_back(*scope);
+  }
+  return scopes;
+}
+
+std::vector<std::string_view> Demangler::Split(std::string_view scope) {
+  std::vector<std::string_view> parts;
+
+  // "vtable for", "guard variable for", "virtual thunk to" ... head the
+  // scope of the entity they are for
+  auto special = SpecialPrefix(scope);
+  if (special > 0) {
+    parts.push_back(scope.substr(0, special - 1));
+    scope.remove_prefix(special);
+  }
+
+  std::size_t depth = 0;
+  std::size_t begin = 0;
+  for (std::size_t i = 0; i < scope.size(); i++) {
+    switch (scope[i]) {
+      case '(':
+      case '[':
+      case '{':
+        depth++;
+        break;
+      case ')':
+      case ']':
+      case '}':
+        if (depth > 0)
+          depth--;
+        break;
+      case ':':
+        if (depth == 0 && i + 1 < scope.size() && scope[i + 1] == ':') {
+          parts.push_back(scope.substr(begin, i - begin));
+          begin = i + 2;
+          i++;
+        }
+        break;
+      default:
+        break;
+    }
+  }
+  parts.push_back(scope.substr(begin));
+  return parts;
+}
+
+}  // namespace xorg
@@ -0,0 +1,368 @@
+/**
+ * Copyright 2022 hupeng.
+ * SPDX-License-Identifier: MIT
+ */
+#include "dependency_resolver.h"
+
+#include <glob.h>
+#include <limits.h>
+#include <spdlog/spdlog.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "elf.h"
+#include "elf_spec.h"
+#include "scanner.h"
+#include "thread_pool.h"
+
+namespace xorg {
+
+// same limits as the kernel and ld.so
+static const std::size_t kMaxSymlinks = 40;
+static const std::size_t kMaxConfDepth = 16;
+
+static std::vector<std::string_view> Split(std::string_view str, char sep) {
+  std::vector<std::string_view> parts;
+  std::size_t begin = 0;
+  while (begin <= str.size()) {
+    auto end = str.find(sep, begin);
+    if (end == std::string_view::npos)
+      end = str.size();
+    parts.push_back(str.substr(begin, end - begin));
+    begin = end + 1;
+  }
+  return parts;
+}
+
+// Appends the components of `path` to `pending` last one first, so that they
+// are popped in order.
+static void PushComponents(std::string_view path,
+                           std::vector<std::string>* pending) {
+  auto parts = Split(path, '/');
+  for (auto it = parts.rbegin(); it != parts.rend(); ++it) {
+    pending->emplace_back(*it);
+  }
+}
+
+// `root` without trailing slashes, "" for "/"
+static std::string NormalizeRoot(const std::string& root) {
+  auto end = root.find_last_not_of('/');
+  if (end == std::string::npos)
+    return "";
+  return root.substr(0, end + 1);
+}
+
+static bool Is64(const SharedObject& object) {
+  return object.elf_class == static_cast<std::uint8_t>(EIClass::ELFCLASS64);
+}
+
+static std::string Dirname(const std::string& path) {
+  auto slash = path.rfind('/');
+  if (slash == std::string::npos || slash == 0)
+    return "/";
+  return path.substr(0, slash);
+}
+
+// Reads what the resolver needs from `host`, which is `path` inside the
+// root.
+static std::shared_ptr<const SharedObject> ParseObject(
+    const std::string& host,
+    const std::string& path) {
+  if (!Scanner::IsElf(host))
+    return nullptr;
+
+  Elf elf(host);
+  if (!elf.Parse())
+    return nullptr;
+
+  auto object = std::make_shared<SharedObject>();
+  object->path = path;
+  object->elf_class = elf.Header().GetClass();
+  object->machine = elf.Header().GetMachine();
+
+  const auto& dynamic = elf.Dynamic();
+  object->soname = dynamic.soname;
+  for (auto name : dynamic.needed) {
+    object->needed.emplace_back(name);
+  }
+  object->rpath = dynamic.rpath;
+  object->runpath = dynamic.runpath;
+  return object;
+}
+
+std::shared_ptr<const SharedObject> SharedObjectCache::Get(
+    const std::string& path) {
+  std::promise<std::shared_ptr<const SharedObject>> parsed;
+  {
+    std::unique_lock<std::mutex> lock(m_mutex_);
+    const auto& it = m_objects_.find(path);
+    if (it != m_objects_.end()) {
+      auto future = it->second;
+      lock.unlock();
+      return future.get();
+    }
+    m_objects_.emplace(path, parsed.get_future().share());
+  }
+
+  // parsed outside the lock, other paths go on meanwhile
+  auto object = ParseObject(m_root_ + path, path);
+  parsed.set_value(object);
+  return object;
+}
+
+std::size_t SharedObjectCache::size() const {
+  std::lock_guard<std::mutex> lock(m_mutex_);
+  return m_objects_.size();
+}
+
+struct DependencyResolver::Loaded {
+  std::shared_ptr<const SharedObject> object;
+  // index of the object whose DT_NEEDED loaded this one, the executable is
+  // its own loader
+  std::size_t loader = 0;
+  std::size_t depth = 0;
+};
+
+DependencyResolver::DependencyResolver(const std::string& root,
+                                       const std::string& library_path)
+    : m_root_(NormalizeRoot(root)),
+      m_library_path_(library_path),
+      m_cache_(m_root_) {
+  ReadLdSoConf("/etc/ld.so.conf", 0);
+}
+
+void DependencyResolver::ReadLdSoConf(const std::string& path,
+                                      std::size_t depth) {
+  if (depth > kMaxConfDepth)
+    return;
+
+  std::ifstream conf(m_root_ + path);
+  std::string line;
+  while (std::getline(conf, line)) {
+    line.erase(std::min(line.find('#'), line.size()));
+    auto begin = line.find_first_not_of(" \t");
+    if (begin == std::string::npos)
+      continue;
+    line = line.substr(begin, line.find_last_not_of(" \t\r") + 1 - begin);
+
+    static const std::string_view kInclude("include");
+    if (line.compare(0, kInclude.size(), kInclude) != 0 ||
+        line.size() == kInclude.size() ||
+        (line[kInclude.size()] != ' ' && line[kInclude.size()] != '\t')) {
+      // "hwcap" lines are obsolete, everything else names a directory
+      if (line.compare(0, 6, "hwcap ") != 0)
+        m_conf_dirs_.push_back(line);
+      continue;
+    }
+
+    auto pattern = line.substr(line.find_first_not_of(" \t", kInclude.size()));
+    if (pattern[0] != '/')
+      pattern = Dirname(path) + "/" + pattern;
+
+    glob_t matches;
+    if (glob((m_root_ + pattern).c_str(), 0, nullptr, &matches) == 0) {
+      for (std::size_t i = 0; i < matches.gl_pathc; i++) {
+        ReadLdSoConf(matches.gl_pathv[i] + m_root_.size(), depth + 1);
+      }
+    }
+    globfree(&matches);
+  }
+}
+
+std::string DependencyResolver::RealPath(const std::string& path) const {
+  // components still to walk, the next one last
+  std::vector<std::string> pending;
+  PushComponents(path, &pending);
+
+  std::string resolved;
+  std::size_t links = 0;
+  while (!pending.empty()) {
+    auto part = std::move(pending.back());
+    pending.pop_back();
+    if (part.empty() || part == ".")
+      continue;
+    if (part == "..") {
+      // ".." of the root is the root, it cannot be left through a symlink
+      resolved.erase(std::min(resolved.rfind('/'), resolved.size()));
+      continue;
+    }
+
+    auto next = resolved + "/" + part;
+    auto host = m_root_ + next;
+    struct stat st;
+    if (lstat(host.c_str(), &st) != 0)
+      return {};
+    if (!S_ISLNK(st.st_mode)) {
+      resolved = std::move(next);
+      continue;
+    }
+
+    char target[PATH_MAX];
+    auto size = readlink(host.c_str(), target, sizeof(target));
+    if (size <= 0 || ++links > kMaxSymlinks)
+      return {};
+    if (target[0] == '/')
+      resolved.clear();
+    PushComponents(std::string_view(target, size), &pending);
+  }
+  return resolved.empty() ? "/" : resolved;
+}
+
+std::string DependencyResolver::Search(const std::string& dirs,
+                                       const std::string& name,
+                                       const SharedObject& requester) {
+  for (auto dir : Split(dirs, ':')) {
+    // an empty entry is the working directory of the process, which has no
+    // meaning below a root
+    if (dir.empty())
+      continue;
+
+    // $ORIGIN and $LIB, $PLATFORM is left alone and never matches
+    std::string expanded;
+    for (std::size_t i = 0; i < dir.size(); i++) {
+      auto rest = dir.substr(i);
+      if (rest.rfind("$ORIGIN", 0) == 0 || rest.rfind("${ORIGIN}", 0) == 0) {
+        expanded += Dirname(requester.path);
+        i += rest[1] == '{' ? 8 : 6;
+      } else if (rest.rfind("$LIB", 0) == 0 || rest.rfind("${LIB}", 0) == 0) {
+        expanded += Is64(requester) ? "lib64" : "lib";
+        i += rest[1] == '{' ? 5 : 3;
+      } else {
+        expanded += dir[i];
+      }
+    }
+
+    auto path = RealPath(expanded + "/" + name);
+    struct stat st;
+    if (path.empty() || stat((m_root_ + path).c_str(), &st) != 0 ||
+        !S_ISREG(st.st_mode))
+      continue;
+
+    auto object = m_cache_.Get(path);
+    if (object != nullptr && object->elf_class == requester.elf_class &&
+        object->machine == requester.machine)
+      return path;
+  }
+  return {};
+}
+
+std::string DependencyResolver::Find(const std::string& name,
+                                     const std::vector<Loaded>& loaded,
+                                     std::size_t requester) {
+  const auto& object = *loaded[requester].object;
+
+  // a name with a slash is a path, there is no working directory below the
+  // root so relative ones are taken from its top
+  if (name.find('/') != std::string::npos) {
+    auto path = RealPath(name[0] == '/' ? name : "/" + name);
+    return path.empty() || m_cache_.Get(path) == nullptr ? "" : path;
+  }
+
+  // DT_RPATH of the requester and of every loader up to the executable,
+  // skipped altogether when the requester has a DT_RUNPATH
+  if (object.runpath.empty()) {
+    for (auto i = requester;; i = loaded[i].loader) {
+      const auto& loader = *loaded[i].object;
+      if (loader.runpath.empty() && !loader.rpath.empty()) {
+        auto path = Search(loader.rpath, name, loader);
+        if (!path.empty())
+          return path;
+      }
+      if (loaded[i].loader == i)
+        break;
+    }
+  }
+
+  auto path = Search(m_library_path_, name, object);
+  if (path.empty())
+    path = Search(object.runpath, name, object);
+  // ld.so.cache is built from ld.so.conf, it finds what these find
+  for (std::size_t i = 0; path.empty() && i < m_conf_dirs_.size(); i++) {
+    path = Search(m_conf_dirs_[i], name, object);
+  }
+  if (path.empty())
+    path = Search(Is64(object) ? "/lib64:/usr/lib64:/lib:/usr/lib"
+                               : "/lib:/usr/lib",
+                  name, object);
+  return path;
+}
+
+Closure DependencyResolver::Resolve(const std::string& path) {
+  Closure closure;
+  closure.path = path;
+
+  // $ORIGIN of an executable inside the root is relative to the root
+  std::string rooted = path;
+  if (!m_root_.empty() && path.compare(0, m_root_.size(), m_root_) == 0 &&
+      path.size() > m_root_.size() && path[m_root_.size()] == '/')
+    rooted = path.substr(m_root_.size());
+
+  auto executable = ParseObject(path, rooted);
+  if (executable == nullptr)
+    return closure;
+  closure.ok = true;
+
+  std::vector<Loaded> loaded{{executable, 0, 0}};
+  // DT_NEEDED names and sonames already handled, to their index in `loaded`
+  // or SIZE_MAX when they were not found
+  std::unordered_map<std::string, std::size_t> names;
+  std::unordered_map<std::string, std::size_t> paths{{rooted, 0}};
+
+  // breadth first, in the order ld.so maps the libraries
+  for (std::size_t i = 0; i < loaded.size(); i++) {
+    auto object = loaded[i].object;
+    for (const auto& name : object->needed) {
+      if (names.count(name) > 0)
+        continue;
+
+      Dependency dependency;
+      dependency.name = name;
+      dependency.needed_by = i == 0 ? path : object->path;
+      dependency.depth = loaded[i].depth + 1;
+      dependency.path = Find(name, loaded, i);
+      if (dependency.path.empty()) {
+        names[name] = SIZE_MAX;
+        closure.dependencies.push_back(std::move(dependency));
+        continue;
+      }
+
+      // another name of a library that is loaded already
+      const auto& it = paths.find(dependency.path);
+      if (it != paths.end()) {
+        names[name] = it->second;
+        continue;
+      }
+
+      auto library = m_cache_.Get(dependency.path);
+      names[name] = loaded.size();
+      if (!library->soname.empty())
+        names.emplace(library->soname, loaded.size());
+      paths.emplace(dependency.path, loaded.size());
+      loaded.push_back({library, i, dependency.depth});
+      closure.dependencies.push_back(std::move(dependency));
+    }
+  }
+  return closure;
+}
+
+std::vector<Closure> DependencyResolver::ResolveAll(
+    const std::vector<std::string>& paths,
+    std::size_t jobs) {
+  // every task owns one slot, only the cache is shared
+  std::vector<Closure> closures(paths.size());
+  ThreadPool pool(jobs);
+  for (std::size_t i = 0; i < paths.size(); i++) {
+    pool.Submit([&, i] { closures[i] = Resolve(paths[i]); });
+  }
+  pool.Wait();
+  return closures;
+}
+
+}  // namespace xorg
@@ -3,123 +3,924 @@
  * SPDX-License-Identifier: MIT
  */
 #include "elf.h"
+#include <llvm/Object/ELF.h>
 #include <spdlog/spdlog.h>
+#include <sys/stat.h>
 #include <algorithm>
-#include <ios>
+#include <cstring>
+#include <new>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
 
+#include "elf_decoder.h"
 #include "elf_spec.h"
+#include "mapped_file.h"
+#include "relocations.h"
 #include "section_header.h"
 #include "string_tab.h"
 #include "symbol_tab.h"
+#include "thread_pool.h"
 
 namespace xorg {
 
-Elf::Elf(const std::string& filename)
-    : m_ifs_(filename, std::ios::in | std::ios::binary) {
-  m_sht_parse_map_ = {
-      {SHType::SHT_STRTAB, [&](std::uint16_t idx) { ParseStrTab(idx); }},
-      {SHType::SHT_SYMTAB, [&](std::uint16_t idx) { ParseSymbolTab(idx); }},
+Elf::Elf(const std::string& filename, std::pmr::memory_resource* memory)
+    : m_filename_(filename),
+      m_memory_(memory),
+      m_native_(memory),
+      m_decoded_(memory),
+      m_str_sections_(memory),
+      m_symbol_tabs_(memory),
+      m_hash_sections_(memory),
+      m_relocations_(memory),
+      m_decompressed_(memory),
+      m_first_section_(memory) {}
+
+Elf::~Elf() {
+  for (auto& buffer : m_buffers_) {
+    BufferPool::Default().Release(std::move(buffer));
+  }
+  for (auto native : m_native_) {
+    m_memory_->deallocate(const_cast<char*>(native.data()), native.size(),
+                          alignof(std::uint64_t));
+  }
+}
+
+Elf::Parser Elf::ParserOf(std::uint32_t type) {
+  switch (static_cast<SHType>(type)) {
+    case SHType::SHT_STRTAB:
+      return &Elf::ParseStrTab;
+    case SHType::SHT_SYMTAB:
+    case SHType::SHT_DYNSYM:
+      return &Elf::ParseSymbolTab;
+    case SHType::SHT_GNU_HASH:
+    case SHType::SHT_HASH:
+      return &Elf::ParseHashTab;
+    case SHType::SHT_GNU_VERSYM:
+    case SHType::SHT_GNU_VERDEF:
+    case SHType::SHT_GNU_VERNEED:
+      return &Elf::ParseVersions;
+    case SHType::SHT_NOTE:
+      return &Elf::ParseNotes;
+    case SHType::SHT_REL:
+    case SHType::SHT_RELA:
+      return &Elf::ParseRelocations;
+    case SHType::SHT_DYNAMIC:
+      return &Elf::ParseDynamic;
+    default:
+      return nullptr;
+  }
+}
+
+bool Elf::OpenSource() {
+  struct stat st;
+  if (m_filename_ != "-" && stat(m_filename_.c_str(), &st) == 0 &&
+      S_ISREG(st.st_mode)) {
+    auto file = std::make_unique<MappedFile>();
+    if (!file->Open(m_filename_))
+      return false;
+
+    // headers are visited once in no particular order, the tables we walk
+    // announce themselves while parsing
+    file->Advise(0, file->Size(), Access::kRandom);
+    m_file_ = std::move(file);
+    return true;
+  }
+
+  auto file = std::make_unique<StreamFile>();
+  if (!file->Open(m_filename_) || !PlanStream(file.get()))
+    return false;
+
+  m_file_ = std::move(file);
+  return true;
+}
+
+bool Elf::PlanStream(StreamFile* file) const {
+  using Region = std::pair<std::uint64_t, std::uint64_t>;
+
+  if (!file->Fetch(0, sizeof(Elf64_Ehdr))) {
+    spdlog::error("{}: too small for an ELF header", m_filename_);
+    return false;
+  }
+  const auto* header = file->View<ElfHeader>(0);
+  if (!header->IsValid()) {
+    spdlog::error("{}: unknown ELF class or byte order", m_filename_);
+    return false;
+  }
+
+  // tables are planned from their native form, Parse() converts them again
+  auto decoder = ElfDecoder::Create(header->GetClass(), header->GetData());
+  Elf64_Ehdr native_header;
+  if (decoder != nullptr) {
+    decoder->Convert(ElfRecord::kHeader, reinterpret_cast<const char*>(header),
+                     1, &native_header);
+    header = reinterpret_cast<const ElfHeader*>(&native_header);
+  }
+  auto phdr_size = RecordSize(decoder.get(), ElfRecord::kProgramHeader);
+  auto shdr_size = RecordSize(decoder.get(), ElfRecord::kSectionHeader);
+
+  // Sections are only known once the section header table has been read,
+  // and it usually sits at the end of the file. Until then keep what we skip
+  // in the spill file, one of the sections we need may be in there: that is
+  // most of the file on disk, up to the StreamFile spill limit.
+  std::vector<Region> tables{
+      {header->GetPhOff(), header->GetPhNum() * phdr_size},
+      {header->GetShOff(), header->GetShNum() * shdr_size},
   };
+  std::sort(tables.begin(), tables.end());
+
+  file->SetSpill(true);
+  for (const auto& r : tables) {
+    if (r.second > 0 && !file->Fetch(r.first, r.second))
+      return false;
+  }
+  file->SetSpill(false);
+
+  // keep exactly the sections Parse() will decode, in file order
+  const auto* sh =
+      file->View<SectionHeader>(header->GetShOff(), header->GetShNum());
+  std::vector<Elf64_Shdr> native_sections;
+  if (decoder != nullptr) {
+    native_sections.resize(header->GetShNum());
+    decoder->Convert(ElfRecord::kSectionHeader,
+                     file->Data(header->GetShOff(),
+                                header->GetShNum() * shdr_size),
+                     header->GetShNum(), native_sections.data());
+    sh = reinterpret_cast<const SectionHeader*>(native_sections.data());
+  }
+  std::vector<Region> sections;
+  for (std::uint16_t i = 0; i < header->GetShNum(); i++) {
+    if (ParserOf(sh[i].Type()) != nullptr)
+      sections.emplace_back(sh[i].Offset(), sh[i].Size());
+  }
+
+  // and the notes of core files, which have no sections for them
+  if (header->GetType() == static_cast<std::uint16_t>(EType::ET_CORE)) {
+    const auto* ph =
+        file->View<ProgramHeader>(header->GetPhOff(), header->GetPhNum());
+    std::vector<Elf64_Phdr> native_segments;
+    if (decoder != nullptr) {
+      native_segments.resize(header->GetPhNum());
+      decoder->Convert(ElfRecord::kProgramHeader,
+                       file->Data(header->GetPhOff(),
+                                  header->GetPhNum() * phdr_size),
+                       header->GetPhNum(), native_segments.data());
+      ph = reinterpret_cast<const ProgramHeader*>(native_segments.data());
+    }
+    for (std::uint16_t i = 0; i < header->GetPhNum(); i++) {
+      if (ph[i].Type() == static_cast<std::uint32_t>(PHType::PT_NOTE))
+        sections.emplace_back(ph[i].Offset(), ph[i].FileSize());
+    }
+  }
+  std::sort(sections.begin(), sections.end());
+
+  for (const auto& r : sections) {
+    // past the spill limit or larger than it, the section reads as out of
+    // range later on
+    if (!file->Fetchable(r.first, r.second)) {
+      spdlog::warn("{}: [{:#x}, {:#x}) was not kept from the stream",
+                   m_filename_, r.first, r.first + r.second);
+      continue;
+    }
+    if (!file->Fetch(r.first, r.second))
+      return false;
+  }
+  // everything needed is in memory now
+  file->DropSpill();
+  return true;
 }
 
-Elf::~Elf() {
-  m_ifs_.close();
+bool Elf::Parse() {
+  if (!OpenSource())
+    return false;
+
+  m_header_ = m_file_->View<ElfHeader>(0);
+  if (m_header_ == nullptr) {
+    spdlog::error("{}: too small for an ELF header", m_filename_);
+    return false;
+  }
+  if (!m_header_->IsValid()) {
+    spdlog::error("{}: unknown ELF class or byte order", m_filename_);
+    return false;
+  }
+
+  // ELF32 and foreign byte order files are converted from here on
+  m_decoder_ = ElfDecoder::Create(m_header_->GetClass(), m_header_->GetData());
+  m_header_ = Table<ElfHeader>(ElfRecord::kHeader, 0, 1);
+
+  // parse section headers, their contents are decoded on first use
+  const auto* sh = Table<SectionHeader>(ElfRecord::kSectionHeader,
+                                        m_header_->GetShOff(),
+                                        m_header_->GetShNum());
+  if (sh == nullptr) {
+    spdlog::error("{}: section headers out of range", m_filename_);
+    return false;
+  }
+  m_section_headers_ = Span<SectionHeader>(sh, m_header_->GetShNum());
+  m_file_->Advise(
+      m_header_->GetShOff(),
+      m_header_->GetShNum() *
+          RecordSize(m_decoder_.get(), ElfRecord::kSectionHeader),
+      Access::kWillNeed);
+  m_decoded_.assign(m_section_headers_.size(), false);
+
+  // parse program headers, cores with PN_XNUM or more of them keep the count
+  // in section 0
+  std::uint64_t phnum = m_header_->GetPhNum();
+  if (phnum == PN_XNUM && !m_section_headers_.empty())
+    phnum = m_section_headers_[0].Info();
+  if (phnum > 0) {
+    const auto* ph = Table<ProgramHeader>(ElfRecord::kProgramHeader,
+                                          m_header_->GetPhOff(), phnum);
+    if (ph == nullptr) {
+      spdlog::error("{}: program headers out of range", m_filename_);
+      return false;
+    }
+    m_program_headers_ = Span<ProgramHeader>(ph, phnum);
+  }
+
+  // index 0 is the reserved null section
+  for (std::uint16_t i = m_section_headers_.size(); i-- > 1;) {
+    m_first_section_[static_cast<SHType>(m_section_headers_[i].Type())] = i;
+  }
+
+  return true;
+}
+
+template <class T>
+const T* Elf::Table(ElfRecord record,
+                    std::uint64_t offset,
+                    std::uint64_t count) const {
+  if (m_decoder_ == nullptr)
+    return m_file_->View<T>(offset, count);
+
+  auto size = m_decoder_->Size(record);
+  if (count > UINT64_MAX / size)
+    return nullptr;
+  const char* src = m_file_->Data(offset, count * size);
+  if (src == nullptr)
+    return nullptr;
+
+  auto* dst = NativeBuffer(count * sizeof(T));
+  m_decoder_->Convert(record, src, count, dst);
+  return reinterpret_cast<const T*>(dst);
+}
+
+char* Elf::NativeBuffer(std::uint64_t size) const {
+  auto* buffer = static_cast<char*>(
+      m_memory_->allocate(size, alignof(std::uint64_t)));
+  m_native_.emplace_back(buffer, size);
+  return buffer;
+}
+
+Span<char> Elf::NativeSectionData(std::uint16_t idx) const {
+  auto data = SectionData(idx);
+  if (m_decoder_ == nullptr || data.empty())
+    return data;
+
+  auto* copy = NativeBuffer(data.size());
+  std::memcpy(copy, data.data(), data.size());
+  if (!m_decoder_->ConvertSection(m_section_headers_[idx], copy, data.size()))
+    return {};
+  return Span<char>(copy, data.size());
+}
+
+void Elf::Decode(std::uint16_t idx) const {
+  if (idx >= m_decoded_.size() || m_decoded_[idx])
+    return;
+  m_decoded_[idx] = true;
+
+  auto parser = ParserOf(m_section_headers_[idx].Type());
+  if (parser != nullptr)
+    (this->*parser)(idx);
+}
+
+static bool IsCompressed(const SectionHeader& sh) {
+  return sh.Flags() & static_cast<std::uint64_t>(SHFlags::SHF_COMPRESSED);
+}
+
+Span<char> Elf::SegmentData(std::size_t idx) const {
+  if (idx >= m_program_headers_.size())
+    return {};
+  const auto& ph = m_program_headers_[idx];
+  const char* data = m_file_->Data(ph.Offset(), ph.FileSize());
+  if (data == nullptr)
+    return {};
+  return Span<char>(data, ph.FileSize());
+}
+
+Span<char> Elf::SectionData(std::uint16_t idx) const {
+  if (idx >= m_section_headers_.size())
+    return {};
+  if (!IsCompressed(m_section_headers_[idx]))
+    return RawSectionData(idx);
+
+  const auto& it = m_decompressed_.find(idx);
+  if (it != m_decompressed_.end())
+    return it->second;
+
+  BufferPool::Buffer buffer;
+  auto data = Inflate(idx, &buffer);
+  if (buffer.data != nullptr)
+    m_buffers_.push_back(std::move(buffer));
+  m_decompressed_[idx] = data;
+  return data;
+}
+
+void Elf::Decompress(const std::vector<std::uint16_t>& idxs,
+                     std::size_t jobs) const {
+  std::vector<std::uint16_t> pending;
+  for (auto idx : idxs) {
+    if (idx < m_section_headers_.size() &&
+        IsCompressed(m_section_headers_[idx]) &&
+        m_decompressed_.count(idx) == 0)
+      pending.push_back(idx);
+  }
+  if (pending.size() < 2) {
+    for (auto idx : pending) {
+      SectionData(idx);
+    }
+    return;
+  }
+
+  // every task owns one slot, the results are stored once all are done
+  std::vector<BufferPool::Buffer> buffers(pending.size());
+  std::vector<Span<char>> data(pending.size());
+  ThreadPool pool(std::min(jobs == 0 ? std::thread::hardware_concurrency()
+                                     : jobs,
+                           pending.size()));
+  for (std::size_t i = 0; i < pending.size(); i++) {
+    pool.Submit([&, i] { data[i] = Inflate(pending[i], &buffers[i]); });
+  }
+  pool.Wait();
+
+  for (std::size_t i = 0; i < pending.size(); i++) {
+    if (buffers[i].data != nullptr)
+      m_buffers_.push_back(std::move(buffers[i]));
+    m_decompressed_[pending[i]] = data[i];
+  }
+}
+
+Span<char> Elf::Inflate(std::uint16_t idx, BufferPool::Buffer* buffer) const {
+  auto raw = RawSectionData(idx);
+  auto header_size =
+      RecordSize(m_decoder_.get(), ElfRecord::kCompressionHeader);
+  if (raw.size() < header_size) {
+    spdlog::warn("{}: compressed section [{}] has no header", m_filename_, idx);
+    return {};
+  }
+
+  Elf64_Chdr chdr;
+  if (m_decoder_ != nullptr)
+    m_decoder_->Convert(ElfRecord::kCompressionHeader, raw.data(), 1, &chdr);
+  else
+    std::memcpy(&chdr, raw.data(), sizeof(chdr));
+
+  auto type = static_cast<ChType>(chdr.ch_type);
+  if (!CanDecompress(type)) {
+    spdlog::warn("{}: section [{}] uses unsupported compression {}",
+                 m_filename_, idx, chdr.ch_type);
+    return {};
+  }
+  if (chdr.ch_size == 0)
+    return {};
+
+  Span<char> payload(raw.data() + header_size, raw.size() - header_size);
+  if (!PlausibleSize(type, payload, chdr.ch_size)) {
+    spdlog::warn("{}: section [{}] claims {} bytes uncompressed from {}",
+                 m_filename_, idx, chdr.ch_size, payload.size());
+    return {};
+  }
+  try {
+    *buffer = BufferPool::Default().Acquire(chdr.ch_size);
+  } catch (const std::bad_alloc&) {
+    spdlog::warn("{}: no memory to decompress section [{}], {} bytes",
+                 m_filename_, idx, chdr.ch_size);
+    return {};
+  }
+  if (!xorg::Decompress(type, payload, buffer->data.get(), chdr.ch_size)) {
+    spdlog::warn("{}: section [{}] does not decompress", m_filename_, idx);
+    BufferPool::Default().Release(std::move(*buffer));
+    *buffer = {};
+    return {};
+  }
+  return Span<char>(buffer->data.get(), chdr.ch_size);
+}
+
+Span<char> Elf::RawSectionData(std::uint16_t idx) const {
+  const auto& sh = m_section_headers_[idx];
+  if (sh.Type() == static_cast<std::uint32_t>(SHType::SHT_NOBITS))
+    return {};
+
+  const auto* data = m_file_->View<char>(sh.Offset(), sh.Size());
+  if (data == nullptr) {
+    spdlog::warn("{}: section [{}] out of range", m_filename_, idx);
+    return {};
+  }
+  return Span<char>(data, sh.Size());
+}
+
+const SectionHeader* Elf::FindSection(std::string_view name) const {
+  for (const auto& sh : m_section_headers_) {
+    if (name == SectionName(sh))
+      return &sh;
+  }
+  return nullptr;
+}
+
+const StringTab* Elf::StrTab(std::uint16_t idx) const {
+  Decode(idx);
+
+  const auto& it = m_str_sections_.find(idx);
+  if (it == m_str_sections_.end())
+    return nullptr;
+  return &it->second;
+}
+
+std::uint16_t Elf::FirstSection(SHType type) const {
+  const auto& it = m_first_section_.find(type);
+  if (it == m_first_section_.end())
+    return 0;
+  return it->second;
+}
+
+Span<SymbolTab> Elf::SymbolTable(std::uint16_t idx) const {
+  Decode(idx);
+
+  const auto& it = m_symbol_tabs_.find(idx);
+  if (it == m_symbol_tabs_.end())
+    return {};
+  return it->second;
+}
+
+Span<SymbolTab> Elf::Symbols() const {
+  return SymbolTable(SymbolsSection());
+}
+
+std::uint16_t Elf::SymbolsSection() const {
+  auto idx = FirstSection(SHType::SHT_SYMTAB);
+  if (idx == 0)
+    idx = FirstSection(SHType::SHT_DYNSYM);
+  return idx;
+}
+
+Span<SymbolTab> Elf::DynSymbols() const {
+  return SymbolTable(FirstSection(SHType::SHT_DYNSYM));
+}
+
+const SymbolColumns& Elf::Columns() const {
+  if (m_columns_ == nullptr) {
+    m_columns_ = std::make_unique<SymbolColumns>();
+    m_columns_->Build(Symbols());
+  }
+  return *m_columns_;
+}
+
+void Elf::ParseStrTab(std::uint16_t idx) const {
+  auto data = SectionData(idx);
+  if (data.empty())
+    return;
+
+  // names are looked up at random
+  m_file_->Advise(m_section_headers_[idx].Offset(),
+                  m_section_headers_[idx].Size(), Access::kWillNeed);
+  m_str_sections_[idx] = StringTab(data.data(), data.size(), idx);
 }
 
-void Elf::Parse() {
-  m_ifs_.seekg(0, m_ifs_.beg);
-  m_ifs_.read((char*)((Elf64_Ehdr*)&m_header_), sizeof(Elf64_Ehdr));
+void Elf::ParseSymbolTab(std::uint16_t idx) const {
+  const auto& sh = m_section_headers_[idx];
+  if (sh.EntSize() != RecordSize(m_decoder_.get(), ElfRecord::kSymbol)) {
+    spdlog::warn("{}: unexpected symbol size {}", m_filename_, sh.EntSize());
+    return;
+  }
+
+  auto count = sh.Size() / sh.EntSize();
+  const auto* symbols =
+      Table<SymbolTab>(ElfRecord::kSymbol, sh.Offset(), count);
+  if (symbols == nullptr) {
+    spdlog::warn("{}: symbol table [{}] out of range", m_filename_, idx);
+    return;
+  }
+
+  // symbol tables are always walked front to back
+  m_file_->Advise(sh.Offset(), sh.Size(), Access::kSequential);
+  m_symbol_tabs_[idx] = Span<SymbolTab>(symbols, count);
+}
 
-  // parse program headers
-  if (m_header_.GetPhNum() > 0) {
-    m_program_headers_.resize(m_header_.GetPhNum());
-    m_ifs_.seekg(m_header_.GetPhOff(), m_ifs_.beg);
-    for (auto i = 0; i < m_program_headers_.size(); i++) {
-      m_ifs_.read((char*)((Elf64_Phdr*)&m_program_headers_[i]),
-                  sizeof(Elf64_Phdr));
+void Elf::ParseHashTab(std::uint16_t idx) const {
+  auto data = NativeSectionData(idx);
+  // some foreign hash tables have no native form, names are still found
+  // through the index in FindSymbol()
+  if (data.empty())
+    return;
+
+  SymbolHash hash;
+  auto type = static_cast<SHType>(m_section_headers_[idx].Type());
+  if (!hash.Init(type, data)) {
+    spdlog::warn("{}: malformed hash section [{}]", m_filename_, idx);
+    return;
+  }
+  m_hash_sections_[idx] = hash;
+}
+
+// The version sections are decoded one by one into the shared table, each of
+// them only refers to .dynsym and .dynstr.
+void Elf::ParseVersions(std::uint16_t idx) const {
+  const auto& sh = m_section_headers_[idx];
+  auto data = NativeSectionData(idx);
+
+  switch (static_cast<SHType>(sh.Type())) {
+    case SHType::SHT_GNU_VERSYM:
+      m_versions_.SetVersym(Span<std::uint16_t>(
+          reinterpret_cast<const std::uint16_t*>(data.data()),
+          data.size() / sizeof(std::uint16_t)));
+      break;
+    case SHType::SHT_GNU_VERDEF:
+      if (const auto* strtab = StrTab(sh.Link()))
+        m_versions_.AddDefinitions(data, sh.Info(), *strtab);
+      break;
+    case SHType::SHT_GNU_VERNEED:
+      if (const auto* strtab = StrTab(sh.Link()))
+        m_versions_.AddNeeds(data, sh.Info(), *strtab);
+      break;
+    default:
+      break;
+  }
+}
+
+// Only the build-id is picked from the notes, other notes are skipped.
+void Elf::ParseNotes(std::uint16_t idx) const {
+  auto data = NativeSectionData(idx);
+  // notes are padded to 4 bytes, or to 8 in sections aligned to 8
+  std::uint64_t align = m_section_headers_[idx].AddrAlign() == 8 ? 8 : 4;
+  auto padded = [&](std::uint64_t size) {
+    return (size + align - 1) & ~(align - 1);
+  };
+
+  std::uint64_t offset = 0;
+  while (data.size() - offset >= sizeof(Elf64_Nhdr)) {
+    const auto* note =
+        reinterpret_cast<const Elf64_Nhdr*>(data.data() + offset);
+    std::uint64_t name = offset + sizeof(Elf64_Nhdr);
+    std::uint64_t desc = name + padded(note->n_namesz);
+    if (desc > data.size() || note->n_descsz > data.size() - desc)
+      break;
+
+    if (note->n_type == NT_GNU_BUILD_ID &&
+        std::string_view(data.data() + name, note->n_namesz) ==
+            std::string_view("GNU", 4)) {
+      m_build_id_ = Span<std::uint8_t>(
+          reinterpret_cast<const std::uint8_t*>(data.data() + desc),
+          note->n_descsz);
+      return;
     }
+    offset = desc + padded(note->n_descsz);
+    if (offset > data.size())
+      break;
   }
+}
 
-  // parse section headers
-  m_section_headers_.resize(m_header_.GetShNum());
-  m_ifs_.seekg(m_header_.GetShOff(), m_ifs_.beg);
-  for (auto i = 0; i < m_section_headers_.size(); i++) {
-    m_ifs_.read((char*)((Elf64_Shdr*)&m_section_headers_[i]),
-                sizeof(Elf64_Shdr));
-    m_section_headers_[i].SetIdx(i);
-    m_section_headers_[i].ParseType();
+Span<std::uint8_t> Elf::BuildId() const {
+  for (std::uint16_t i = 1; i < m_section_headers_.size(); i++) {
+    if (!m_build_id_.empty())
+      break;
+    if (m_section_headers_[i].Type() ==
+        static_cast<std::uint32_t>(SHType::SHT_NOTE))
+      Decode(i);
+  }
+  return m_build_id_;
+}
 
-    auto length = m_ifs_.tellg();
+void Elf::ParseRelocations(std::uint16_t idx) const {
+  const auto& sh = m_section_headers_[idx];
+  bool rela = sh.Type() == static_cast<std::uint32_t>(SHType::SHT_RELA);
+  auto record = rela ? ElfRecord::kRela : ElfRecord::kRel;
+  if (sh.EntSize() != RecordSize(m_decoder_.get(), record)) {
+    spdlog::warn("{}: unexpected relocation size {}", m_filename_,
+                 sh.EntSize());
+    return;
+  }
 
-    const auto& it = m_sht_parse_map_.find(
-        static_cast<SHType>(m_section_headers_[i].Type()));
-    if (it != m_sht_parse_map_.end()) {
-      it->second(i);
+  // one pass over the mapped table, front to back
+  auto count = sh.Size() / sh.EntSize();
+  m_file_->Advise(sh.Offset(), sh.Size(), Access::kSequential);
+  auto relocs = std::make_unique<Relocations>();
+  if (rela) {
+    const auto* table = Table<Elf64_Rela>(record, sh.Offset(), count);
+    if (table != nullptr)
+      relocs->Build(Span<Elf64_Rela>(table, count));
+  } else {
+    const auto* table = Table<Elf64_Rel>(record, sh.Offset(), count);
+    if (table != nullptr)
+      relocs->Build(Span<Elf64_Rel>(table, count));
+  }
+  if (relocs->size() != count) {
+    spdlog::warn("{}: relocation section [{}] out of range", m_filename_,
+                 idx);
+    return;
+  }
+  m_relocations_[idx] = std::move(relocs);
+}
+
+void Elf::ParseDynamic(std::uint16_t idx) const {
+  const auto& sh = m_section_headers_[idx];
+  auto count = sh.Size() / RecordSize(m_decoder_.get(), ElfRecord::kDynamic);
+  const auto* dyn = Table<Elf64_Dyn>(ElfRecord::kDynamic, sh.Offset(), count);
+  const auto* strtab = StrTab(sh.Link());
+  if (dyn == nullptr || strtab == nullptr) {
+    spdlog::warn("{}: malformed dynamic section [{}]", m_filename_, idx);
+    return;
+  }
+
+  for (std::uint64_t i = 0; i < count; i++) {
+    auto value = static_cast<std::uint32_t>(dyn[i].d_val);
+    switch (static_cast<DTag>(dyn[i].d_tag)) {
+      case DTag::DT_NULL:
+        return;
+      case DTag::DT_NEEDED:
+        m_dynamic_.needed.push_back(strtab->Get(value));
+        break;
+      case DTag::DT_SONAME:
+        m_dynamic_.soname = strtab->Get(value);
+        break;
+      case DTag::DT_RPATH:
+        m_dynamic_.rpath = strtab->Get(value);
+        break;
+      case DTag::DT_RUNPATH:
+        m_dynamic_.runpath = strtab->Get(value);
+        break;
+      default:
+        break;
     }
-    m_ifs_.seekg(length, m_ifs_.beg);
   }
+}
 
-  // parse section header name
-  const auto& st = m_str_sections_[m_header_.GetShStrndx()];
-  for (auto& sh : m_section_headers_) {
-    sh.SetName(&st[sh.NameValue()]);
+const DynamicInfo& Elf::Dynamic() const {
+  Decode(FirstSection(SHType::SHT_DYNAMIC));
+  return m_dynamic_;
+}
+
+const Relocations* Elf::RelocationTable(std::uint16_t idx) const {
+  Decode(idx);
+
+  const auto& it = m_relocations_.find(idx);
+  if (it == m_relocations_.end())
+    return nullptr;
+  return it->second.get();
+}
+
+const SymbolTab* Elf::RelocationSymbol(std::uint16_t idx,
+                                       std::size_t row) const {
+  const auto* relocs = RelocationTable(idx);
+  if (relocs == nullptr || row >= relocs->size())
+    return nullptr;
+
+  auto symbol = relocs->Symbol()[row];
+  auto symbols = SymbolTable(m_section_headers_[idx].Link());
+  if (symbol == 0 || symbol >= symbols.size())
+    return nullptr;
+  return &symbols[symbol];
+}
+
+std::string_view Elf::RelocationTypeName(std::uint32_t type) const {
+  auto name =
+      llvm::object::getELFRelocationTypeName(m_header_->GetMachine(), type);
+  return std::string_view(name.data(), name.size());
+}
+
+// Index of the allocated section holding `addr` in `sections`, which are
+// sorted by address, 0 when there is none.
+static std::uint16_t SectionAt(
+    const std::vector<std::pair<std::uint64_t, std::uint16_t>>& sections,
+    Span<SectionHeader> headers,
+    std::uint64_t addr) {
+  auto it = std::upper_bound(
+      sections.begin(), sections.end(), addr,
+      [](std::uint64_t a, const auto& section) { return a < section.first; });
+  if (it == sections.begin())
+    return 0;
+
+  auto idx = std::prev(it)->second;
+  const auto& sh = headers[idx];
+  return addr - sh.Addr() < sh.Size() ? idx : 0;
+}
+
+RelocationStats Elf::CountRelocations() const {
+  RelocationStats stats;
+
+  // dynamic relocations apply to the whole image, they are attributed by
+  // address instead
+  std::vector<std::pair<std::uint64_t, std::uint16_t>> by_addr;
+  for (std::uint16_t i = 1; i < m_section_headers_.size(); i++) {
+    const auto& sh = m_section_headers_[i];
+    if ((sh.Flags() & static_cast<std::uint64_t>(SHFlags::SHF_ALLOC)) &&
+        sh.Size() > 0)
+      by_addr.emplace_back(sh.Addr(), i);
   }
+  std::sort(by_addr.begin(), by_addr.end());
+
+  for (std::uint16_t i = 1; i < m_section_headers_.size(); i++) {
+    const auto* relocs = RelocationTable(i);
+    if (relocs == nullptr)
+      continue;
+
+    stats.total += relocs->size();
+    relocs->CountTypes(&stats.by_type);
 
-  // parse symbol table name
-  ParseSymbolTabName();
+    auto target = m_section_headers_[i].Info();
+    if (target != 0 && target < m_section_headers_.size()) {
+      stats.by_section[target] += relocs->size();
+      continue;
+    }
+    for (auto offset : relocs->Offset()) {
+      stats.by_section[SectionAt(by_addr, m_section_headers_, offset)]++;
+    }
+  }
+  return stats;
+}
+
+void Elf::PrintRelocations(Output& out) const {
+  for (std::uint16_t i = 1; i < m_section_headers_.size(); i++) {
+    const auto* relocs = RelocationTable(i);
+    if (relocs == nullptr)
+      continue;
+
+    const auto& sh = m_section_headers_[i];
+    std::string_view section = SectionName(sh);
+    Relocations::PrintHeader(out, section, sh.Offset(), relocs->size());
+    for (std::size_t row = 0; row < relocs->size(); row++) {
+      const auto* symbol = RelocationSymbol(i, row);
+      std::uint64_t value = 0;
+      std::string_view name;
+      if (symbol != nullptr) {
+        value = symbol->Value();
+        name = SymbolName(*symbol);
+        // section symbols are nameless, show the section they stand for
+        if (name.empty() && symbol->Type() == STType::STT_SECTION &&
+            symbol->Shndx() < m_section_headers_.size())
+          name = SectionName(m_section_headers_[symbol->Shndx()]);
+      }
+      relocs->Print(out, section, row,
+                    RelocationTypeName(relocs->Type()[row]), value, name);
+    }
+  }
 }
 
-void Elf::ParseStrTab(std::uint16_t idx) {
-  StringTab st;
-  st.resize(m_section_headers_[idx].Size());
-  m_ifs_.seekg(m_section_headers_[idx].Offset());
-  m_ifs_.read(&st[0], st.size());
-  st.SetIdx(idx);
+void Elf::PrintRelocationStats(Output& out) const {
+  auto stats = CountRelocations();
 
-  m_str_sections_[idx] = std::move(st);
+  if (out.IsTable()) {
+    out.Print("{} relocations by type:\n", stats.total);
+    for (const auto& it : stats.by_type) {
+      out.Print("{:>12} {}\n", it.second, RelocationTypeName(it.first));
+    }
+    out.Print("{} relocations by target section:\n", stats.total);
+    for (const auto& it : stats.by_section) {
+      out.Print("{:>12} [{:>2}] {}\n", it.second, it.first,
+                it.first != 0 ? SectionName(m_section_headers_[it.first])
+                              : "<none>");
+    }
+    return;
+  }
+
+  for (const auto& it : stats.by_type) {
+    out.BeginRecord();
+    out.Field("histogram", "type");
+    out.Field("key", RelocationTypeName(it.first));
+    out.Field("count", it.second);
+    out.EndRecord();
+  }
+  for (const auto& it : stats.by_section) {
+    out.BeginRecord();
+    out.Field("histogram", "section");
+    out.Field("key", it.first != 0
+                         ? SectionName(m_section_headers_[it.first])
+                         : std::string_view());
+    out.Field("count", it.second);
+    out.EndRecord();
+  }
 }
 
-void Elf::ParseSymbolTab(std::uint16_t idx) {
-  auto& sh = m_section_headers_[idx];
-  m_symbols_.resize(sh.Size() / sh.EntSize());
-  m_ifs_.seekg(sh.Offset());
-  for (auto i = 0; i < m_symbols_.size(); i++) {
-    m_ifs_.read((char*)((Elf64_Sym*)&m_symbols_[i]), sh.EntSize());
-    m_symbols_[i].SetNum(i);
-    m_symbols_[i].Parse();
+const SymbolTab* Elf::FindSymbol(std::string_view name) const {
+  // .gnu.hash is faster, prefer it when both are present
+  auto hash_idx = FirstSection(SHType::SHT_GNU_HASH);
+  if (hash_idx == 0)
+    hash_idx = FirstSection(SHType::SHT_HASH);
+
+  // exported symbols through the hash section of their table
+  if (hash_idx != 0) {
+    Decode(hash_idx);
+
+    const auto& it = m_hash_sections_.find(hash_idx);
+    auto link = m_section_headers_[hash_idx].Link();
+    auto symbols = SymbolTable(link);
+    const auto* strtab =
+        link < m_section_headers_.size()
+            ? StrTab(m_section_headers_[link].Link())
+            : nullptr;
+    if (it != m_hash_sections_.end() && strtab != nullptr) {
+      auto i = it->second.Find(name, symbols, *strtab);
+      if (i != SymbolHash::kNoSymbol)
+        return &symbols[i];
+      // the hash covers Symbols() already, a miss is final
+      if (link == SymbolsSection())
+        return nullptr;
+    }
   }
-  m_symbol_idx_ = idx;
+
+  // no usable hash, or Symbols() is .symtab with entries the hash lacks
+  auto symbols = Symbols();
+  if (m_symbol_names_ == nullptr) {
+    m_symbol_names_ =
+        std::make_unique<std::unordered_map<std::string_view, std::uint32_t>>(
+            symbols.size());
+    for (std::uint32_t i = 0; i < symbols.size(); i++) {
+      auto symbol_name = SymbolName(symbols[i]);
+      if (symbol_name.empty())
+        continue;
+
+      // a definition wins over an undefined reference of the same name
+      auto res = m_symbol_names_->emplace(symbol_name, i);
+      if (!res.second &&
+          symbols[res.first->second].Shndx() ==
+              static_cast<std::uint16_t>(SHNdx::SHN_UNDEF))
+        res.first->second = i;
+    }
+  }
+
+  const auto& it = m_symbol_names_->find(name);
+  if (it == m_symbol_names_->end())
+    return nullptr;
+  return &symbols[it->second];
+}
+
+std::string_view Elf::SectionName(const SectionHeader& sh) const {
+  const auto* st = StrTab(m_header_->GetShStrndx());
+  if (st == nullptr)
+    return {};
+
+  return st->Get(sh.NameValue());
 }
 
-void Elf::ParseSymbolTabName() {
-  const auto& sts = m_str_sections_[m_section_headers_[m_symbol_idx_].Link()];
-  for (auto& symbol : m_symbols_) {
-    symbol.SetName(&sts[symbol.Name()]);
+std::string_view Elf::SymbolName(const SymbolTab& symbol) const {
+  // a symbol can only come from a table that has been decoded already
+  for (const auto& tab : m_symbol_tabs_) {
+    if (&symbol < tab.second.begin() || &symbol >= tab.second.end())
+      continue;
+
+    const auto* st = StrTab(m_section_headers_[tab.first].Link());
+    if (st == nullptr)
+      return {};
+    return st->Get(symbol.Name());
   }
+  return {};
 }
 
-void Elf::Print() const {
-  // m_header_.Print();
+SymbolVersion Elf::Version(const SymbolTab& symbol) const {
+  auto dynsym = DynSymbols();
+  if (&symbol < dynsym.begin() || &symbol >= dynsym.end())
+    return {};
 
-  // ProgramHeader::PrintHeader();
+  Decode(FirstSection(SHType::SHT_GNU_VERSYM));
+  Decode(FirstSection(SHType::SHT_GNU_VERDEF));
+  Decode(FirstSection(SHType::SHT_GNU_VERNEED));
+  return m_versions_.Get(&symbol - dynsym.begin());
+}
+
+void Elf::Print(Output& out) const {
+  // m_header_->Print(out);
+
+  // ProgramHeader::PrintHeader(out);
   // for (const auto& ph : m_program_headers_) {
-  //   ph.Print();
+  //   ph.Print(out);
   // }
 
-  // SectionHeader::PrintHeader();
-  // for (const auto& sh : m_section_headers_) {
-  //   sh.Print();
+  // SectionHeader::PrintHeader(out);
+  // for (std::uint16_t i = 0; i < m_section_headers_.size(); i++) {
+  //   m_section_headers_[i].Print(out, i, SectionName(m_section_headers_[i]));
   // }
 
   // print string table
-  // for (const auto& st : m_str_sections_) {
-  //   st.second.Print();
+  // for (std::uint16_t i = 0; i < m_section_headers_.size(); i++) {
+  //   if (const auto* st = StrTab(i))
+  //     st->Print(out);
   // }
 
-  SymbolTab::PrintHeader(m_symbols_.size());
-  for (const auto& st : m_symbols_) {
-    st.Print();
+  for (std::uint16_t i = 0; i < m_section_headers_.size(); i++) {
+    const auto& sh = m_section_headers_[i];
+    if (sh.Type() != static_cast<std::uint32_t>(SHType::SHT_SYMTAB) &&
+        sh.Type() != static_cast<std::uint32_t>(SHType::SHT_DYNSYM))
+      continue;
+
+    auto symbols = SymbolTable(i);
+    std::string_view table = SectionName(sh);
+    SymbolTab::PrintHeader(out, table, symbols.size());
+    for (std::uint32_t j = 0; j < symbols.size(); j++) {
+      symbols[j].Print(out, table, j, SymbolName(symbols[j]),
+                       Version(symbols[j]));
+    }
   }
 }
 
@@ -0,0 +1,511 @@
+/**
+ * Copyright 2022 hupeng.
+ * SPDX-License-Identifier: MIT
+ */
+#include "elf_decoder.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
+#include "byte_swap.h"
+#include "elf_spec.h"
+
+namespace xorg {
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+static const auto kHostData = EIdata::ELFDATA2LSB;
+#else
+static const auto kHostData = EIdata::ELFDATA2MSB;
+#endif
+
+static const SwapLayout kSym64Swap({4, 1, 1, 2, 8, 8});
+static const SwapLayout kSym32Swap({4, 4, 4, 1, 1, 2});
+static const SwapLayout kRel64Swap({8, 8});
+static const SwapLayout kRela64Swap({8, 8, 8});
+static const SwapLayout kRel32Swap({4, 4});
+static const SwapLayout kRela32Swap({4, 4, 4});
+static const SwapLayout kDyn32Swap({4, 4});
+static const SwapLayout kHalfSwap({2});
+static const SwapLayout kWordSwap({4});
+static const SwapLayout kXwordSwap({8});
+static const SwapLayout kNoteSwap({4, 4, 4});
+static const SwapLayout kVerdefSwap({2, 2, 2, 2, 4, 4, 4});
+static const SwapLayout kVerdauxSwap({4, 4});
+static const SwapLayout kVerneedSwap({2, 2, 4, 4, 4});
+static const SwapLayout kVernauxSwap({4, 2, 2, 4, 4});
+
+struct Elf32Types {
+  using Ehdr = Elf32_Ehdr;
+  using Phdr = Elf32_Phdr;
+  using Shdr = Elf32_Shdr;
+  using Sym = Elf32_Sym;
+  using Rel = Elf32_Rel;
+  using Rela = Elf32_Rela;
+  using Dyn = Elf32_Dyn;
+  using Chdr = Elf32_Chdr;
+};
+
+struct Elf64Types {
+  using Ehdr = Elf64_Ehdr;
+  using Phdr = Elf64_Phdr;
+  using Shdr = Elf64_Shdr;
+  using Sym = Elf64_Sym;
+  using Rel = Elf64_Rel;
+  using Rela = Elf64_Rela;
+  using Dyn = Elf64_Dyn;
+  using Chdr = Elf64_Chdr;
+};
+
+template <class Types, bool kSwap>
+class ElfDecoderImpl final : public ElfDecoder {
+ public:
+  static constexpr bool kIs64 = std::is_same_v<Types, Elf64Types>;
+  static_assert(kSwap || !kIs64, "native files need no decoder");
+
+  std::size_t Size(ElfRecord record) const override {
+    switch (record) {
+      case ElfRecord::kHeader:
+        return sizeof(typename Types::Ehdr);
+      case ElfRecord::kProgramHeader:
+        return sizeof(typename Types::Phdr);
+      case ElfRecord::kSectionHeader:
+        return sizeof(typename Types::Shdr);
+      case ElfRecord::kSymbol:
+        return sizeof(typename Types::Sym);
+      case ElfRecord::kRel:
+        return sizeof(typename Types::Rel);
+      case ElfRecord::kRela:
+        return sizeof(typename Types::Rela);
+      case ElfRecord::kDynamic:
+        return sizeof(typename Types::Dyn);
+      case ElfRecord::kCompressionHeader:
+        return sizeof(typename Types::Chdr);
+    }
+    return 0;
+  }
+
+  void Convert(ElfRecord record,
+               const char* src,
+               std::size_t count,
+               void* dst) const override {
+    switch (record) {
+      case ElfRecord::kHeader:
+        Header(src, static_cast<Elf64_Ehdr*>(dst));
+        break;
+      case ElfRecord::kProgramHeader:
+        ProgramHeaders(src, count, static_cast<Elf64_Phdr*>(dst));
+        break;
+      case ElfRecord::kSectionHeader:
+        SectionHeaders(src, count, static_cast<Elf64_Shdr*>(dst));
+        break;
+      case ElfRecord::kSymbol:
+        Symbols(src, count, static_cast<Elf64_Sym*>(dst));
+        break;
+      case ElfRecord::kRel:
+        Relocations<Elf32_Rel>(src, count, static_cast<Elf64_Rel*>(dst));
+        break;
+      case ElfRecord::kRela:
+        Relocations<Elf32_Rela>(src, count, static_cast<Elf64_Rela*>(dst));
+        break;
+      case ElfRecord::kDynamic:
+        Dynamic(src, count, static_cast<Elf64_Dyn*>(dst));
+        break;
+      case ElfRecord::kCompressionHeader:
+        CompressionHeader(src, static_cast<Elf64_Chdr*>(dst));
+        break;
+    }
+  }
+
+  bool ConvertSection(const SectionHeader& sh,
+                      char* data,
+                      std::uint64_t size) const override;
+
+ private:
+  template <class T>
+  static T Get(T value) {
+    if constexpr (!kSwap || sizeof(T) == 1) {
+      return value;
+    } else if constexpr (sizeof(T) == 2) {
+      return __builtin_bswap16(value);
+    } else if constexpr (sizeof(T) == 4) {
+      return __builtin_bswap32(value);
+    } else {
+      return __builtin_bswap64(value);
+    }
+  }
+
+  // headers are small and converted field by field
+  void Header(const char* src, Elf64_Ehdr* dst) const;
+  void CompressionHeader(const char* src, Elf64_Chdr* dst) const;
+  void ProgramHeaders(const char* src, std::size_t count, Elf64_Phdr* dst)
+      const;
+  void SectionHeaders(const char* src, std::size_t count, Elf64_Shdr* dst)
+      const;
+  void Symbols(const char* src, std::size_t count, Elf64_Sym* dst) const;
+  // `Rel32` is Elf32_Rel or Elf32_Rela, the ELF64 record is picked to match
+  template <class Rel32, class Rel64>
+  void Relocations(const char* src, std::size_t count, Rel64* dst) const;
+
+  void Dynamic(const char* src, std::size_t count, Elf64_Dyn* dst) const;
+
+  void Notes(const SectionHeader& sh, char* data, std::uint64_t size) const;
+  void VersionDefinitions(std::uint32_t count,
+                          char* data,
+                          std::uint64_t size) const;
+  void VersionNeeds(std::uint32_t count, char* data, std::uint64_t size)
+      const;
+  bool GnuHash(char* data, std::uint64_t size) const;
+};
+
+template <class Types, bool kSwap>
+void ElfDecoderImpl<Types, kSwap>::Header(const char* src,
+                                          Elf64_Ehdr* dst) const {
+  typename Types::Ehdr in;
+  std::memcpy(&in, src, sizeof(in));
+
+  // e_ident is kept, it still tells the class and byte order of the file
+  std::memcpy(dst->e_ident, in.e_ident, EI_NIDENT);
+  dst->e_type = Get(in.e_type);
+  dst->e_machine = Get(in.e_machine);
+  dst->e_version = Get(in.e_version);
+  dst->e_entry = Get(in.e_entry);
+  dst->e_phoff = Get(in.e_phoff);
+  dst->e_shoff = Get(in.e_shoff);
+  dst->e_flags = Get(in.e_flags);
+  dst->e_ehsize = Get(in.e_ehsize);
+  dst->e_phentsize = Get(in.e_phentsize);
+  dst->e_phnum = Get(in.e_phnum);
+  dst->e_shentsize = Get(in.e_shentsize);
+  dst->e_shnum = Get(in.e_shnum);
+  dst->e_shstrndx = Get(in.e_shstrndx);
+}
+
+template <class Types, bool kSwap>
+void ElfDecoderImpl<Types, kSwap>::CompressionHeader(const char* src,
+                                                     Elf64_Chdr* dst) const {
+  typename Types::Chdr in;
+  std::memcpy(&in, src, sizeof(in));
+
+  dst->ch_type = Get(in.ch_type);
+  dst->ch_reserved = 0;
+  dst->ch_size = Get(in.ch_size);
+  dst->ch_addralign = Get(in.ch_addralign);
+}
+
+template <class Types, bool kSwap>
+void ElfDecoderImpl<Types, kSwap>::ProgramHeaders(const char* src,
+                                                  std::size_t count,
+                                                  Elf64_Phdr* dst) const {
+  for (std::size_t i = 0; i < count; i++) {
+    typename Types::Phdr in;
+    std::memcpy(&in, src + i * sizeof(in), sizeof(in));
+
+    dst[i].p_type = Get(in.p_type);
+    dst[i].p_flags = Get(in.p_flags);
+    dst[i].p_offset = Get(in.p_offset);
+    dst[i].p_vaddr = Get(in.p_vaddr);
+    dst[i].p_paddr = Get(in.p_paddr);
+    dst[i].p_filesz = Get(in.p_filesz);
+    dst[i].p_memsz = Get(in.p_memsz);
+    dst[i].p_align = Get(in.p_align);
+  }
+}
+
+template <class Types, bool kSwap>
+void ElfDecoderImpl<Types, kSwap>::SectionHeaders(const char* src,
+                                                  std::size_t count,
+                                                  Elf64_Shdr* dst) const {
+  for (std::size_t i = 0; i < count; i++) {
+    typename Types::Shdr in;
+    std::memcpy(&in, src + i * sizeof(in), sizeof(in));
+
+    dst[i].sh_name = Get(in.sh_name);
+    dst[i].sh_type = Get(in.sh_type);
+    dst[i].sh_flags = Get(in.sh_flags);
+    dst[i].sh_addr = Get(in.sh_addr);
+    dst[i].sh_offset = Get(in.sh_offset);
+    dst[i].sh_size = Get(in.sh_size);
+    dst[i].sh_link = Get(in.sh_link);
+    dst[i].sh_info = Get(in.sh_info);
+    dst[i].sh_addralign = Get(in.sh_addralign);
+    dst[i].sh_entsize = Get(in.sh_entsize);
+  }
+}
+
+template <class Types, bool kSwap>
+void ElfDecoderImpl<Types, kSwap>::Symbols(const char* src,
+                                           std::size_t count,
+                                           Elf64_Sym* dst) const {
+  if constexpr (kIs64) {
+    // same layout, only the byte order differs
+    kSym64Swap.Swap(src, dst, count);
+  } else {
+    // swapped in bulk a block at a time, then widened
+    Elf32_Sym block[256];
+    for (std::size_t done = 0; done < count;) {
+      std::size_t n = std::min(count - done, std::size(block));
+      if constexpr (kSwap) {
+        kSym32Swap.Swap(src + done * sizeof(Elf32_Sym), block, n);
+      } else {
+        std::memcpy(block, src + done * sizeof(Elf32_Sym),
+                    n * sizeof(Elf32_Sym));
+      }
+      for (std::size_t i = 0; i < n; i++) {
+        auto& out = dst[done + i];
+        out.st_name = block[i].st_name;
+        out.st_info = block[i].st_info;
+        out.st_other = block[i].st_other;
+        out.st_shndx = block[i].st_shndx;
+        out.st_value = block[i].st_value;
+        out.st_size = block[i].st_size;
+      }
+      done += n;
+    }
+  }
+}
+
+template <class Types, bool kSwap>
+template <class Rel32, class Rel64>
+void ElfDecoderImpl<Types, kSwap>::Relocations(const char* src,
+                                               std::size_t count,
+                                               Rel64* dst) const {
+  constexpr bool kRela = std::is_same_v<Rel32, Elf32_Rela>;
+
+  if constexpr (kIs64) {
+    // same layout, only the byte order differs
+    (kRela ? kRela64Swap : kRel64Swap).Swap(src, dst, count);
+  } else {
+    // swapped in bulk a block at a time, then widened; the symbol moves from
+    // bits 8-31 to 32-63 of r_info
+    Rel32 block[256];
+    for (std::size_t done = 0; done < count;) {
+      std::size_t n = std::min(count - done, std::size(block));
+      if constexpr (kSwap) {
+        (kRela ? kRela32Swap : kRel32Swap)
+            .Swap(src + done * sizeof(Rel32), block, n);
+      } else {
+        std::memcpy(block, src + done * sizeof(Rel32), n * sizeof(Rel32));
+      }
+      for (std::size_t i = 0; i < n; i++) {
+        auto& out = dst[done + i];
+        out.r_offset = block[i].r_offset;
+        out.r_info = (static_cast<std::uint64_t>(block[i].r_info >> 8) << 32) |
+                     (block[i].r_info & 0xff);
+        if constexpr (kRela)
+          out.r_addend = block[i].r_addend;
+      }
+      done += n;
+    }
+  }
+}
+
+template <class Types, bool kSwap>
+void ElfDecoderImpl<Types, kSwap>::Dynamic(const char* src,
+                                           std::size_t count,
+                                           Elf64_Dyn* dst) const {
+  if constexpr (kIs64) {
+    kXwordSwap.Swap(src, dst, count * 2);
+  } else {
+    Elf32_Dyn block[256];
+    for (std::size_t done = 0; done < count;) {
+      std::size_t n = std::min(count - done, std::size(block));
+      if constexpr (kSwap) {
+        kDyn32Swap.Swap(src + done * sizeof(Elf32_Dyn), block, n);
+      } else {
+        std::memcpy(block, src + done * sizeof(Elf32_Dyn),
+                    n * sizeof(Elf32_Dyn));
+      }
+      for (std::size_t i = 0; i < n; i++) {
+        dst[done + i].d_tag = block[i].d_tag;
+        dst[done + i].d_val = block[i].d_val;
+      }
+      done += n;
+    }
+  }
+}
+
+template <class Types, bool kSwap>
+bool ElfDecoderImpl<Types, kSwap>::ConvertSection(const SectionHeader& sh,
+                                                  char* data,
+                                                  std::uint64_t size) const {
+  switch (static_cast<SHType>(sh.Type())) {
+    case SHType::SHT_GNU_HASH:
+      return GnuHash(data, size);
+    default:
+      break;
+  }
+  // the remaining sections are laid out alike in ELF32 and ELF64
+  if constexpr (!kSwap)
+    return true;
+
+  switch (static_cast<SHType>(sh.Type())) {
+    case SHType::SHT_HASH:
+      kWordSwap.Swap(data, data, size / sizeof(std::uint32_t));
+      break;
+    case SHType::SHT_GNU_VERSYM:
+      kHalfSwap.Swap(data, data, size / sizeof(std::uint16_t));
+      break;
+    case SHType::SHT_GNU_VERDEF:
+      VersionDefinitions(sh.Info(), data, size);
+      break;
+    case SHType::SHT_GNU_VERNEED:
+      VersionNeeds(sh.Info(), data, size);
+      break;
+    case SHType::SHT_NOTE:
+      Notes(sh, data, size);
+      break;
+    default:
+      break;
+  }
+  return true;
+}
+
+// Only the note headers are swapped, names and descriptors are bytes.
+template <class Types, bool kSwap>
+void ElfDecoderImpl<Types, kSwap>::Notes(const SectionHeader& sh,
+                                         char* data,
+                                         std::uint64_t size) const {
+  std::uint64_t align = sh.AddrAlign() == 8 ? 8 : 4;
+  auto padded = [&](std::uint64_t n) { return (n + align - 1) & ~(align - 1); };
+
+  std::uint64_t offset = 0;
+  while (size - offset >= sizeof(Elf64_Nhdr)) {
+    auto* note = reinterpret_cast<Elf64_Nhdr*>(data + offset);
+    kNoteSwap.Swap(note, note, 1);
+    std::uint64_t next = offset + sizeof(Elf64_Nhdr) + padded(note->n_namesz) +
+                         padded(note->n_descsz);
+    if (next > size)
+      break;
+    offset = next;
+  }
+}
+
+// Entries are swapped in place while following the chain, each of them is
+// read only after it has been swapped.
+template <class Types, bool kSwap>
+void ElfDecoderImpl<Types, kSwap>::VersionDefinitions(
+    std::uint32_t count,
+    char* data,
+    std::uint64_t size) const {
+  std::uint64_t offset = 0;
+  for (std::uint32_t i = 0;
+       i < count && size - offset >= sizeof(Elf64_Verdef); i++) {
+    auto* def = reinterpret_cast<Elf64_Verdef*>(data + offset);
+    kVerdefSwap.Swap(def, def, 1);
+
+    std::uint64_t aux = offset + def->vd_aux;
+    for (std::uint16_t j = 0;
+         j < def->vd_cnt && aux < size && size - aux >= sizeof(Elf64_Verdaux);
+         j++) {
+      auto* verdaux = reinterpret_cast<Elf64_Verdaux*>(data + aux);
+      kVerdauxSwap.Swap(verdaux, verdaux, 1);
+      if (verdaux->vda_next == 0)
+        break;
+      aux += verdaux->vda_next;
+    }
+
+    if (def->vd_next == 0 || def->vd_next > size - offset)
+      break;
+    offset += def->vd_next;
+  }
+}
+
+template <class Types, bool kSwap>
+void ElfDecoderImpl<Types, kSwap>::VersionNeeds(std::uint32_t count,
+                                                char* data,
+                                                std::uint64_t size) const {
+  std::uint64_t offset = 0;
+  for (std::uint32_t i = 0;
+       i < count && size - offset >= sizeof(Elf64_Verneed); i++) {
+    auto* need = reinterpret_cast<Elf64_Verneed*>(data + offset);
+    kVerneedSwap.Swap(need, need, 1);
+
+    std::uint64_t aux = offset + need->vn_aux;
+    for (std::uint16_t j = 0;
+         j < need->vn_cnt && aux < size && size - aux >= sizeof(Elf64_Vernaux);
+         j++) {
+      auto* vernaux = reinterpret_cast<Elf64_Vernaux*>(data + aux);
+      kVernauxSwap.Swap(vernaux, vernaux, 1);
+      if (vernaux->vna_next == 0)
+        break;
+      aux += vernaux->vna_next;
+    }
+
+    if (need->vn_next == 0 || need->vn_next > size - offset)
+      break;
+    offset += need->vn_next;
+  }
+}
+
+// nbuckets, symoffset, bloom_size, bloom_shift, bloom[bloom_size],
+// buckets[nbuckets], chain[]
+template <class Types, bool kSwap>
+bool ElfDecoderImpl<Types, kSwap>::GnuHash(char* data,
+                                           std::uint64_t size) const {
+  // SymbolHash only knows 64 bit bloom words
+  if constexpr (!kIs64) {
+    return false;
+  } else {
+    const std::uint64_t kHeader = 4 * sizeof(std::uint32_t);
+    if (size < kHeader)
+      return false;
+
+    kWordSwap.Swap(data, data, 4);
+    std::uint64_t bloom_size = reinterpret_cast<std::uint32_t*>(data)[2];
+    if (bloom_size > (size - kHeader) / sizeof(std::uint64_t))
+      return false;
+
+    kXwordSwap.Swap(data + kHeader, data + kHeader, bloom_size);
+    std::uint64_t rest = kHeader + bloom_size * sizeof(std::uint64_t);
+    kWordSwap.Swap(data + rest, data + rest,
+                   (size - rest) / sizeof(std::uint32_t));
+    return true;
+  }
+}
+
+std::unique_ptr<ElfDecoder> ElfDecoder::Create(std::uint8_t elf_class,
+                                               std::uint8_t data) {
+  bool swap = data != static_cast<std::uint8_t>(kHostData);
+  switch (static_cast<EIClass>(elf_class)) {
+    case EIClass::ELFCLASS64:
+      if (swap)
+        return std::make_unique<ElfDecoderImpl<Elf64Types, true>>();
+      return nullptr;
+    case EIClass::ELFCLASS32:
+      if (swap)
+        return std::make_unique<ElfDecoderImpl<Elf32Types, true>>();
+      return std::make_unique<ElfDecoderImpl<Elf32Types, false>>();
+    default:
+      return nullptr;
+  }
+}
+
+std::size_t RecordSize(const ElfDecoder* decoder, ElfRecord record) {
+  if (decoder != nullptr)
+    return decoder->Size(record);
+
+  switch (record) {
+    case ElfRecord::kHeader:
+      return sizeof(Elf64_Ehdr);
+    case ElfRecord::kProgramHeader:
+      return sizeof(Elf64_Phdr);
+    case ElfRecord::kSectionHeader:
+      return sizeof(Elf64_Shdr);
+    case ElfRecord::kSymbol:
+      return sizeof(Elf64_Sym);
+    case ElfRecord::kRel:
+      return sizeof(Elf64_Rel);
+    case ElfRecord::kRela:
+      return sizeof(Elf64_Rela);
+    case ElfRecord::kDynamic:
+      return sizeof(Elf64_Dyn);
+    case ElfRecord::kCompressionHeader:
+      return sizeof(Elf64_Chdr);
+  }
+  return 0;
+}
+
+}  // namespace xorg
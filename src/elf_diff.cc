@@ -0,0 +1,251 @@
+/**
+ * Copyright 2022 hupeng.
+ * SPDX-License-Identifier: MIT
+ */
+#include "elf_diff.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include <vector>
+
+#include "elf.h"
+#include "elf_spec.h"
+#include "output.h"
+
+namespace xorg {
+
+// a section or symbol of one side
+struct NamedSize {
+  std::uint64_t hash;
+  std::string_view name;
+  std::uint64_t size;
+};
+
+// Stable LSD radix sort by hash, 16 bits a pass. Entries with the same name
+// keep their order of appearance, which is what pairs repeated names.
+static void SortByHash(std::vector<NamedSize>* items) {
+  const std::size_t kRadix = 1 << 16;
+  std::vector<NamedSize> tmp(items->size());
+  std::vector<std::size_t> counts(kRadix);
+  for (int shift = 0; shift < 64; shift += 16) {
+    std::fill(counts.begin(), counts.end(), 0);
+    for (const auto& item : *items) {
+      counts[(item.hash >> shift) & (kRadix - 1)]++;
+    }
+    std::size_t sum = 0;
+    for (auto& count : counts) {
+      auto n = count;
+      count = sum;
+      sum += n;
+    }
+    for (const auto& item : *items) {
+      tmp[counts[(item.hash >> shift) & (kRadix - 1)]++] = item;
+    }
+    items->swap(tmp);
+  }
+}
+
+static void Add(DiffList* list,
+                DiffChange change,
+                std::string_view name,
+                std::uint64_t old_size,
+                std::uint64_t new_size) {
+  list->entries.push_back({change, name, old_size, new_size});
+}
+
+// Entries with the same name are paired in order, the extra ones on either
+// side were added or removed.
+static void MatchSameName(const NamedSize* old_begin,
+                          const NamedSize* old_end,
+                          const NamedSize* new_begin,
+                          const NamedSize* new_end,
+                          DiffList* list) {
+  for (; old_begin != old_end && new_begin != new_end;
+       ++old_begin, ++new_begin) {
+    if (old_begin->size != new_begin->size)
+      Add(list, DiffChange::kResized, old_begin->name, old_begin->size,
+          new_begin->size);
+  }
+  for (; old_begin != old_end; ++old_begin) {
+    Add(list, DiffChange::kRemoved, old_begin->name, old_begin->size, 0);
+  }
+  for (; new_begin != new_end; ++new_begin) {
+    Add(list, DiffChange::kAdded, new_begin->name, 0, new_begin->size);
+  }
+}
+
+// Hashes, sorts and merges both sides. Runs of one hash almost always hold
+// a single name, collisions are sorted by name first.
+static DiffList Match(std::vector<NamedSize> old_items,
+                      std::vector<NamedSize> new_items) {
+  DiffList list;
+  for (const auto& item : old_items) {
+    list.old_total += item.size;
+  }
+  for (const auto& item : new_items) {
+    list.new_total += item.size;
+  }
+
+  SortByHash(&old_items);
+  SortByHash(&new_items);
+
+  auto by_name = [](const NamedSize& a, const NamedSize& b) {
+    return a.name < b.name;
+  };
+  std::size_t i = 0;
+  std::size_t j = 0;
+  while (i < old_items.size() || j < new_items.size()) {
+    // the smaller hash at the head of either side
+    auto hash = i < old_items.size() ? old_items[i].hash : UINT64_MAX;
+    if (j < new_items.size() &&
+        (i == old_items.size() || new_items[j].hash < hash))
+      hash = new_items[j].hash;
+
+    auto i_end = i;
+    while (i_end < old_items.size() && old_items[i_end].hash == hash) {
+      i_end++;
+    }
+    auto j_end = j;
+    while (j_end < new_items.size() && new_items[j_end].hash == hash) {
+      j_end++;
+    }
+
+    auto* old_run = old_items.data();
+    auto* new_run = new_items.data();
+    auto name = i < i_end ? old_run[i].name : new_run[j].name;
+    bool one_name = true;
+    for (auto k = i; k < i_end && one_name; k++) {
+      one_name = old_run[k].name == name;
+    }
+    for (auto k = j; k < j_end && one_name; k++) {
+      one_name = new_run[k].name == name;
+    }
+
+    if (one_name) {
+      MatchSameName(old_run + i, old_run + i_end, new_run + j, new_run + j_end,
+                    &list);
+    } else {
+      std::stable_sort(old_run + i, old_run + i_end, by_name);
+      std::stable_sort(new_run + j, new_run + j_end, by_name);
+      while (i < i_end || j < j_end) {
+        name = i < i_end ? old_run[i].name : new_run[j].name;
+        if (j < j_end && (i == i_end || new_run[j].name < name))
+          name = new_run[j].name;
+        auto i_name = i;
+        while (i_name < i_end && old_run[i_name].name == name) {
+          i_name++;
+        }
+        auto j_name = j;
+        while (j_name < j_end && new_run[j_name].name == name) {
+          j_name++;
+        }
+        MatchSameName(old_run + i, old_run + i_name, new_run + j,
+                      new_run + j_name, &list);
+        i = i_name;
+        j = j_name;
+      }
+    }
+    i = i_end;
+    j = j_end;
+  }
+
+  std::sort(list.entries.begin(), list.entries.end(),
+            [](const DiffEntry& a, const DiffEntry& b) {
+              if (a.Delta() != b.Delta())
+                return a.Delta() > b.Delta();
+              return a.name < b.name;
+            });
+  return list;
+}
+
+static std::vector<NamedSize> SectionsOf(const Elf& elf) {
+  std::hash<std::string_view> hasher;
+  std::vector<NamedSize> items;
+  // section 0 is the null entry
+  for (std::size_t idx = 1; idx < elf.Sections().size(); idx++) {
+    const auto& sh = elf.Sections()[idx];
+    auto name = elf.SectionName(sh);
+    items.push_back({hasher(name), name, sh.Size()});
+  }
+  return items;
+}
+
+// Defined symbols that name something, section and file symbols are left
+// out.
+static std::vector<NamedSize> SymbolsOf(const Elf& elf) {
+  std::hash<std::string_view> hasher;
+  std::vector<NamedSize> items;
+  auto symbols = elf.Symbols();
+  items.reserve(symbols.size());
+  for (const auto& symbol : symbols) {
+    if (symbol.Shndx() == static_cast<std::uint16_t>(SHNdx::SHN_UNDEF) ||
+        symbol.Type() == STType::STT_SECTION ||
+        symbol.Type() == STType::STT_FILE)
+      continue;
+    auto name = elf.SymbolName(symbol);
+    if (name.empty())
+      continue;
+    items.push_back({hasher(name), name, symbol.Size()});
+  }
+  return items;
+}
+
+void ElfDiff::Build(const Elf& old_elf, const Elf& new_elf) {
+  m_sections_ = Match(SectionsOf(old_elf), SectionsOf(new_elf));
+  m_symbols_ = Match(SymbolsOf(old_elf), SymbolsOf(new_elf));
+}
+
+static std::string_view ChangeName(DiffChange change) {
+  switch (change) {
+    case DiffChange::kAdded:
+      return "added";
+    case DiffChange::kRemoved:
+      return "removed";
+    case DiffChange::kResized:
+      return "resized";
+  }
+  return "";
+}
+
+static void PrintList(Output& out,
+                      std::string_view kind,
+                      const DiffList& list) {
+  auto growth = static_cast<std::int64_t>(list.new_total - list.old_total);
+  if (out.IsTable()) {
+    out.Print("{}: {} -> {} bytes ({:+}), {} changed\n", kind, list.old_total,
+              list.new_total, growth, list.entries.size());
+    for (const auto& entry : list.entries) {
+      out.Print("  {:<8} {:>+10} {:>10} -> {:<10} {}\n",
+                ChangeName(entry.change), entry.Delta(), entry.old_size,
+                entry.new_size, entry.name);
+    }
+    return;
+  }
+
+  // the totals are a record of their own, with an empty change
+  auto record = [&](std::string_view change, std::string_view name,
+                    std::uint64_t old_size, std::uint64_t new_size) {
+    out.BeginRecord();
+    out.Field("kind", kind);
+    out.Field("change", change);
+    out.Field("name", name);
+    out.Field("old_size", old_size);
+    out.Field("new_size", new_size);
+    out.SignedField("delta", static_cast<std::int64_t>(new_size - old_size));
+    out.EndRecord();
+  };
+  record("", "", list.old_total, list.new_total);
+  for (const auto& entry : list.entries) {
+    record(ChangeName(entry.change), entry.name, entry.old_size,
+           entry.new_size);
+  }
+}
+
+void ElfDiff::Print(Output& out) const {
+  PrintList(out, "sections", m_sections_);
+  PrintList(out, "symbols", m_symbols_);
+}
+
+}  // namespace xorg
@@ -2,45 +2,83 @@
  * Copyright 2022 hupeng.
  * SPDX-License-Identifier: MIT
  */
-#include <spdlog/spdlog.h>
-#include <fstream>
-#include <iomanip>
 #include <map>
-#include <sstream>
 #include <string>
+#include <string_view>
 
 #include "common.h"
 #include "elf_header.h"
 #include "elf_spec.h"
+#include "output.h"
 
 namespace xorg {
 
-void ElfHeader::Print() const {
-  spdlog::info("ELF Header:");
+// values start in column 37, after the "key:" label
+static std::size_t KeyPadding(std::string_view key) {
+  return key.size() < 35 ? 35 - key.size() - 1 : 0;
+}
+
+void ElfHeader::Print(Output& out) const {
+  if (out.IsTable()) {
+    out.Print("ELF Header:\n");
+  } else {
+    out.BeginRecord();
+  }
 
-  PrintMagic();
-  PrintType();
-  PrintMachine();
+  PrintMagic(out);
+  PrintType(out);
+  PrintMachine(out);
 
   // print file version
-  PrintHex("Version", e_version);
+  PrintHex(out, "Version", "version", e_version);
 
   // print entry point address
-  PrintHex("Entry point address", e_entry);
+  PrintHex(out, "Entry point address", "entry", e_entry);
 
-  PrintDec("Start of program headers", e_phoff, " (bytes into file)");
-  PrintDec("Start of section headers", e_shoff, " (bytes into file)");
+  PrintDec(out, "Start of program headers", "phoff", e_phoff,
+           " (bytes into file)");
+  PrintDec(out, "Start of section headers", "shoff", e_shoff,
+           " (bytes into file)");
   // print flags
-  PrintHex("Flags", e_flags);
-  PrintDec("Size of this header", e_ehsize, " (bytes)");
-  PrintDec("Size of program headers", e_phentsize, " (bytes)");
-  PrintDec("Number of program headers", e_phnum);
-  PrintDec("Size of section headers", e_shentsize, " (bytes)");
-  PrintDec("Number of section headers", e_shnum);
-  PrintDec("Section header string table index", e_shstrndx);
+  PrintHex(out, "Flags", "flags", e_flags);
+  PrintDec(out, "Size of this header", "ehsize", e_ehsize, " (bytes)");
+  PrintDec(out, "Size of program headers", "phentsize", e_phentsize,
+           " (bytes)");
+  PrintDec(out, "Number of program headers", "phnum", e_phnum);
+  PrintDec(out, "Size of section headers", "shentsize", e_shentsize,
+           " (bytes)");
+  PrintDec(out, "Number of section headers", "shnum", e_shnum);
+  PrintDec(out, "Section header string table index", "shstrndx", e_shstrndx);
+
+  if (!out.IsTable())
+    out.EndRecord();
+}
+
+bool ElfHeader::IsValid() const {
+  auto elf_class = static_cast<EIClass>(GetClass());
+  auto data = static_cast<EIdata>(GetData());
+  return e_ident[static_cast<int>(EIdent::EI_MAG0)] == 0x7f &&
+         e_ident[static_cast<int>(EIdent::EI_MAG1)] == 'E' &&
+         e_ident[static_cast<int>(EIdent::EI_MAG2)] == 'L' &&
+         e_ident[static_cast<int>(EIdent::EI_MAG3)] == 'F' &&
+         (elf_class == EIClass::ELFCLASS32 ||
+          elf_class == EIClass::ELFCLASS64) &&
+         (data == EIdata::ELFDATA2LSB || data == EIdata::ELFDATA2MSB);
+}
+
+std::uint8_t ElfHeader::GetClass() const {
+  return e_ident[static_cast<int>(EIdent::EI_CLASS)];
+}
+
+std::uint8_t ElfHeader::GetData() const {
+  return e_ident[static_cast<int>(EIdent::EI_DATA)];
+}
+
+void ElfHeader::PrintMachine(Output& out) const {
+  PrintCommon(out, "Machine", "machine", MachineName());
 }
 
-void ElfHeader::PrintMachine() const {
+const std::string& ElfHeader::MachineName() const {
   static const std::map<EMachine, std::string> machineMap{
       {EMachine::EM_NONE, "No machine"},
       {EMachine::EM_ARM, "ARM"},
@@ -50,12 +88,16 @@ void ElfHeader::PrintMachine() const {
       {EMachine::EM_LOONGARCH, "LoongArch"},
   };
 
-  PrintCommon("Machine",
-              GetMapValWithDef(machineMap, static_cast<EMachine>(e_machine),
-                               std::string("Unknown Machine")));
+  static const std::string unknown("Unknown Machine");
+  return GetMapValWithDef(machineMap, static_cast<EMachine>(e_machine),
+                          unknown);
 }
 
-void ElfHeader::PrintType() const {
+void ElfHeader::PrintType(Output& out) const {
+  PrintCommon(out, "Type", "type", TypeName());
+}
+
+const std::string& ElfHeader::TypeName() const {
   static const std::map<EType, std::string> typeMap{
       {EType::ET_NONE, "No file type"},
       {EType::ET_REL, "REL (Relocatable file)"},
@@ -64,30 +106,35 @@ void ElfHeader::PrintType() const {
       {EType::ET_CORE, "Core (Core file)"},
   };
 
-  PrintCommon("Type", GetMapValWithDef(typeMap, static_cast<EType>(e_type),
-                                       std::string("Unknown file type")));
+  static const std::string unknown("Unknown file type");
+  return GetMapValWithDef(typeMap, static_cast<EType>(e_type), unknown);
 }
 
-void ElfHeader::PrintMagic() const {
-  std::stringstream ss;
+void ElfHeader::PrintMagic(Output& out) const {
+  // small enough for the inline storage of the buffer
+  fmt::memory_buffer magic;
+  for (auto i = 0; i < EI_NIDENT; i++) {
+    fmt::format_to(fmt::appender(magic), "{:02x} ", e_ident[i]);
+  }
 
   // print magic
-  ss << "  " << std::left << std::setw(9) << std::setfill(' ') << "Magic:";
-  for (auto i = 0; i < EI_NIDENT; i++) {
-    ss << std::right << std::setw(2) << std::setfill('0') << std::hex
-       << (int)(e_ident[i]) << " ";
+  std::string_view bytes(magic.data(), magic.size());
+  if (out.IsTable()) {
+    out.Print("  {:<9}{}\n", "Magic:", bytes);
+  } else {
+    out.Field("magic", bytes.substr(0, bytes.size() - 1));
   }
-  spdlog::info("{}", ss.str());
 
-  PrintClass();
-  PrintData();
-  PrintVersion();
-  PrintOsABI();
+  PrintClass(out);
+  PrintData(out);
+  PrintVersion(out);
+  PrintOsABI(out);
 
-  PrintDec("ABI Version", e_ident[static_cast<int>(EIdent::EI_ABIVERSION)]);
+  PrintDec(out, "ABI Version", "abi_version",
+           e_ident[static_cast<int>(EIdent::EI_ABIVERSION)]);
 }
 
-void ElfHeader::PrintClass() const {
+void ElfHeader::PrintClass(Output& out) const {
   static const std::map<EIClass, std::string> classMap{
       {EIClass::ELFCLASSNONE, "Invalid Class"},
       {EIClass::ELFCLASS32, "ELF32"},
@@ -95,12 +142,12 @@ void ElfHeader::PrintClass() const {
   };
 
   auto classIdx = e_ident[static_cast<int>(EIdent::EI_CLASS)];
-  PrintCommon("Class",
+  PrintCommon(out, "Class", "class",
               GetMapValWithDef(classMap, static_cast<EIClass>(classIdx),
                                std::string("Unknown Class")));
 }
 
-void ElfHeader::PrintData() const {
+void ElfHeader::PrintData(Output& out) const {
   static const std::map<EIdata, std::string> dataMap{
       {EIdata::ELFDATANONE, "Invalid data encoding"},
       {EIdata::ELFDATA2LSB, "2's complement, little endian"},
@@ -108,58 +155,67 @@ void ElfHeader::PrintData() const {
   };
 
   auto dataIdx = e_ident[static_cast<int>(EIdent::EI_DATA)];
-  PrintCommon("Data", GetMapValWithDef(dataMap, static_cast<EIdata>(dataIdx),
-                                       std::string("Unknown data encoding")));
+  PrintCommon(out, "Data", "data",
+              GetMapValWithDef(dataMap, static_cast<EIdata>(dataIdx),
+                               std::string("Unknown data encoding")));
 }
 
-void ElfHeader::PrintVersion() const {
+void ElfHeader::PrintVersion(Output& out) const {
   static const std::map<EVersion, std::string> versionMap{
       {EVersion::EV_NONE, "Invalid ELF version"},
       {EVersion::EV_CURRENT, "1 (current)"},
   };
 
   auto versionIdx = e_ident[static_cast<int>(EIdent::EI_VERSION)];
-  PrintCommon("Version",
+  PrintCommon(out, "Version", "ident_version",
               GetMapValWithDef(versionMap, static_cast<EVersion>(versionIdx),
                                std::string("Unknown ELF Version")));
 }
 
-void ElfHeader::PrintOsABI() const {
+void ElfHeader::PrintOsABI(Output& out) const {
   static const std::map<EIOsabi, std::string> osabiMap{
       {EIOsabi::ELFOSABI_SYSV, "UNIX - System V"},
       {EIOsabi::ELFOSABI_ARM, "ARM"},
   };
 
   auto osabiIdx = e_ident[static_cast<int>(EIdent::EI_OSABI)];
-  PrintCommon("OS/ABI",
+  PrintCommon(out, "OS/ABI", "osabi",
               GetMapValWithDef(osabiMap, static_cast<EIOsabi>(osabiIdx),
                                std::string("Unknown OS ABI")));
 }
 
-void ElfHeader::PrintDec(const std::string& key,
-                         const std::uint64_t& value,
-                         const std::string& suffix) const {
-  std::stringstream ss;
-
-  ss << value << suffix;
-  PrintCommon(key, ss.str());
+void ElfHeader::PrintDec(Output& out,
+                         std::string_view key,
+                         std::string_view name,
+                         std::uint64_t value,
+                         std::string_view suffix) const {
+  if (out.IsTable()) {
+    out.Print("  {}:{:<{}}{}{}\n", key, "", KeyPadding(key), value, suffix);
+  } else {
+    out.Field(name, value);
+  }
 }
 
-void ElfHeader::PrintHex(const std::string& key,
-                         const std::uint64_t& value) const {
-  std::stringstream ss;
-
-  ss << "0x" << std::hex << value;
-  PrintCommon(key, ss.str());
+void ElfHeader::PrintHex(Output& out,
+                         std::string_view key,
+                         std::string_view name,
+                         std::uint64_t value) const {
+  if (out.IsTable()) {
+    out.Print("  {}:{:<{}}0x{:x}\n", key, "", KeyPadding(key), value);
+  } else {
+    out.HexField(name, value);
+  }
 }
 
-void ElfHeader::PrintCommon(const std::string& key,
-                            const std::string& value) const {
-  std::stringstream ss;
-
-  ss << "  " << std::left << std::setw(35) << std::setfill(' ') << (key + ":")
-     << value;
-  spdlog::info("{}", ss.str());
+void ElfHeader::PrintCommon(Output& out,
+                            std::string_view key,
+                            std::string_view name,
+                            std::string_view value) const {
+  if (out.IsTable()) {
+    out.Print("  {}:{:<{}}{}\n", key, "", KeyPadding(key), value);
+  } else {
+    out.Field(name, value);
+  }
 }
 
 }  // namespace xorg
@@ -0,0 +1,900 @@
+/**
+ * Copyright 2022 hupeng.
+ * SPDX-License-Identifier: MIT
+ */
+#include "line_index.h"
+
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "dwarf_spec.h"
+#include "elf.h"
+#include "elf_spec.h"
+
+namespace xorg {
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+static const bool kHostLittle = true;
+#else
+static const bool kHostLittle = false;
+#endif
+
+// Bounds checked reads from a DWARF section in the byte order of the file.
+// A read past the end returns 0 and marks the cursor failed, callers check
+// Ok() once per unit rather than after every read.
+class DwarfCursor {
+ public:
+  DwarfCursor(Span<char> data, bool swap, std::uint64_t offset = 0)
+      : m_data_(data), m_swap_(swap) {
+    Seek(offset);
+  }
+
+  bool Ok() const { return m_ok_; }
+  std::uint64_t Offset() const { return m_offset_; }
+  std::uint64_t Remaining() const { return m_data_.size() - m_offset_; }
+
+  void Seek(std::uint64_t offset) {
+    if (offset > m_data_.size())
+      Fail();
+    else
+      m_offset_ = offset;
+  }
+  void Skip(std::uint64_t size) {
+    if (size > Remaining())
+      Fail();
+    else
+      m_offset_ += size;
+  }
+
+  template <class T>
+  T Read() {
+    T value = 0;
+    if (sizeof(T) > Remaining()) {
+      Fail();
+      return 0;
+    }
+    std::memcpy(&value, m_data_.data() + m_offset_, sizeof(T));
+    m_offset_ += sizeof(T);
+    if constexpr (sizeof(T) == 2) {
+      return m_swap_ ? __builtin_bswap16(value) : value;
+    } else if constexpr (sizeof(T) == 4) {
+      return m_swap_ ? __builtin_bswap32(value) : value;
+    } else if constexpr (sizeof(T) == 8) {
+      return m_swap_ ? __builtin_bswap64(value) : value;
+    }
+    return value;
+  }
+
+  // an unsigned of `size` bytes, 3 for the strx3 and addrx3 forms; sizes
+  // over 8 fail the cursor
+  std::uint64_t ReadUnsigned(std::size_t size) {
+    switch (size) {
+      case 1:
+        return Read<std::uint8_t>();
+      case 2:
+        return Read<std::uint16_t>();
+      case 4:
+        return Read<std::uint32_t>();
+      case 8:
+        return Read<std::uint64_t>();
+      default:
+        break;
+    }
+    if (size > sizeof(std::uint64_t)) {
+      Fail();
+      return 0;
+    }
+
+    std::uint64_t value = 0;
+    bool little = kHostLittle != m_swap_;
+    for (std::size_t i = 0; i < size; i++) {
+      std::uint64_t byte = Read<std::uint8_t>();
+      value |= little ? byte << (8 * i) : byte << (8 * (size - 1 - i));
+    }
+    return value;
+  }
+
+  std::uint64_t ReadUleb() {
+    std::uint64_t value = 0;
+    for (unsigned shift = 0;; shift += 7) {
+      auto byte = Read<std::uint8_t>();
+      if (shift < 64)
+        value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+      if (!(byte & 0x80) || !m_ok_)
+        return value;
+    }
+  }
+
+  std::int64_t ReadSleb() {
+    std::uint64_t value = 0;
+    unsigned shift = 0;
+    std::uint8_t byte;
+    do {
+      byte = Read<std::uint8_t>();
+      if (shift < 64)
+        value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+      shift += 7;
+    } while ((byte & 0x80) && m_ok_);
+    if (shift < 64 && (byte & 0x40))
+      value |= ~static_cast<std::uint64_t>(0) << shift;
+    return static_cast<std::int64_t>(value);
+  }
+
+  std::uint64_t ReadOffset(bool dwarf64) {
+    return dwarf64 ? Read<std::uint64_t>() : Read<std::uint32_t>();
+  }
+
+  std::string_view ReadString() {
+    const char* str = m_data_.data() + m_offset_;
+    const void* nul = std::memchr(str, '\0', Remaining());
+    if (nul == nullptr) {
+      Fail();
+      return {};
+    }
+    std::string_view value(str, static_cast<const char*>(nul) - str);
+    m_offset_ += value.size() + 1;
+    return value;
+  }
+
+  // Reads an initial length, returns where the unit ends. Units running off
+  // the section are cut at its end.
+  std::uint64_t ReadLength(bool* dwarf64) {
+    std::uint64_t length = Read<std::uint32_t>();
+    *dwarf64 = length == 0xffffffff;
+    if (*dwarf64)
+      length = Read<std::uint64_t>();
+    return m_offset_ + std::min(length, Remaining());
+  }
+
+ private:
+  void Fail() {
+    m_ok_ = false;
+    m_offset_ = m_data_.size();
+  }
+
+  Span<char> m_data_;
+  bool m_swap_;
+  std::uint64_t m_offset_ = 0;
+  bool m_ok_ = true;
+};
+
+// Address sizes the readers and the range limits handle.
+static bool ValidAddressSize(std::uint8_t size) {
+  return size == 4 || size == 8;
+}
+
+// What ReadForm() needs to know about the unit a value is in.
+struct FormContext {
+  std::uint16_t version = 0;
+  std::uint8_t address_size = 0;
+  bool dwarf64 = false;
+};
+
+// Reads one attribute value: constants, addresses, offsets and indices go
+// to `value`, inline strings to `str`, blocks are skipped. False for a form
+// this reader does not know, the rest of the entry cannot be found then.
+static bool ReadForm(DwarfCursor* cur,
+                     DwForm form,
+                     const FormContext& ctx,
+                     std::int64_t implicit,
+                     std::uint64_t* value,
+                     std::string_view* str) {
+  *value = 0;
+  switch (form) {
+    case DwForm::DW_FORM_addr:
+      *value = cur->ReadUnsigned(ctx.address_size);
+      break;
+    case DwForm::DW_FORM_block1:
+      cur->Skip(cur->Read<std::uint8_t>());
+      break;
+    case DwForm::DW_FORM_block2:
+      cur->Skip(cur->Read<std::uint16_t>());
+      break;
+    case DwForm::DW_FORM_block4:
+      cur->Skip(cur->Read<std::uint32_t>());
+      break;
+    case DwForm::DW_FORM_block:
+    case DwForm::DW_FORM_exprloc:
+      cur->Skip(cur->ReadUleb());
+      break;
+    case DwForm::DW_FORM_data1:
+    case DwForm::DW_FORM_ref1:
+    case DwForm::DW_FORM_flag:
+    case DwForm::DW_FORM_strx1:
+    case DwForm::DW_FORM_addrx1:
+      *value = cur->ReadUnsigned(1);
+      break;
+    case DwForm::DW_FORM_data2:
+    case DwForm::DW_FORM_ref2:
+    case DwForm::DW_FORM_strx2:
+    case DwForm::DW_FORM_addrx2:
+      *value = cur->ReadUnsigned(2);
+      break;
+    case DwForm::DW_FORM_strx3:
+    case DwForm::DW_FORM_addrx3:
+      *value = cur->ReadUnsigned(3);
+      break;
+    case DwForm::DW_FORM_data4:
+    case DwForm::DW_FORM_ref4:
+    case DwForm::DW_FORM_ref_sup4:
+    case DwForm::DW_FORM_strx4:
+    case DwForm::DW_FORM_addrx4:
+      *value = cur->ReadUnsigned(4);
+      break;
+    case DwForm::DW_FORM_data8:
+    case DwForm::DW_FORM_ref8:
+    case DwForm::DW_FORM_ref_sig8:
+    case DwForm::DW_FORM_ref_sup8:
+      *value = cur->ReadUnsigned(8);
+      break;
+    case DwForm::DW_FORM_data16:
+      cur->Skip(16);
+      break;
+    case DwForm::DW_FORM_string:
+      *str = cur->ReadString();
+      break;
+    case DwForm::DW_FORM_sdata:
+      *value = cur->ReadSleb();
+      break;
+    case DwForm::DW_FORM_udata:
+    case DwForm::DW_FORM_ref_udata:
+    case DwForm::DW_FORM_strx:
+    case DwForm::DW_FORM_addrx:
+    case DwForm::DW_FORM_loclistx:
+    case DwForm::DW_FORM_rnglistx:
+    case DwForm::DW_FORM_GNU_addr_index:
+    case DwForm::DW_FORM_GNU_str_index:
+      *value = cur->ReadUleb();
+      break;
+    case DwForm::DW_FORM_strp:
+    case DwForm::DW_FORM_line_strp:
+    case DwForm::DW_FORM_sec_offset:
+    case DwForm::DW_FORM_strp_sup:
+    case DwForm::DW_FORM_GNU_ref_alt:
+    case DwForm::DW_FORM_GNU_strp_alt:
+      *value = cur->ReadOffset(ctx.dwarf64);
+      break;
+    case DwForm::DW_FORM_ref_addr:
+      // an address in DWARF 2, an offset since
+      *value = ctx.version <= 2 ? cur->ReadUnsigned(ctx.address_size)
+                                : cur->ReadOffset(ctx.dwarf64);
+      break;
+    case DwForm::DW_FORM_flag_present:
+      *value = 1;
+      break;
+    case DwForm::DW_FORM_implicit_const:
+      *value = implicit;
+      break;
+    case DwForm::DW_FORM_indirect:
+      return ReadForm(cur, static_cast<DwForm>(cur->ReadUleb()), ctx, implicit,
+                      value, str);
+    default:
+      return false;
+  }
+  return cur->Ok();
+}
+
+static bool IsAddrx(DwForm form) {
+  switch (form) {
+    case DwForm::DW_FORM_addrx:
+    case DwForm::DW_FORM_addrx1:
+    case DwForm::DW_FORM_addrx2:
+    case DwForm::DW_FORM_addrx3:
+    case DwForm::DW_FORM_addrx4:
+    case DwForm::DW_FORM_GNU_addr_index:
+      return true;
+    default:
+      return false;
+  }
+}
+
+static std::string_view StringAt(Span<char> section, std::uint64_t offset) {
+  if (offset >= section.size())
+    return {};
+  const char* str = section.data() + offset;
+  const void* nul = std::memchr(str, '\0', section.size() - offset);
+  if (nul == nullptr)
+    return {};
+  return std::string_view(str, static_cast<const char*>(nul) - str);
+}
+
+struct LineIndex::Unit {
+  FormContext form;
+  // DW_AT_stmt_list
+  std::uint64_t line_offset = 0;
+  std::string_view comp_dir;
+  std::uint64_t addr_base = 0;
+};
+
+// A decoded line program. Rows of a sequence are in address order, the last
+// one ends it.
+struct LineIndex::Program {
+  struct Row {
+    std::uint64_t address;
+    std::uint32_t line;
+    std::uint32_t file;
+    std::uint32_t column;
+  };
+  struct Sequence {
+    std::uint64_t begin;
+    std::uint64_t end;
+    // rows [first, last)
+    std::uint32_t first;
+    std::uint32_t last;
+
+    bool operator<(const Sequence& other) const { return begin < other.begin; }
+  };
+
+  // nullptr when no sequence covers `addr`
+  const Row* Find(std::uint64_t addr) const {
+    auto seq = std::upper_bound(sequences.begin(), sequences.end(),
+                                Sequence{addr, 0, 0, 0});
+    if (seq == sequences.begin())
+      return nullptr;
+    --seq;
+    if (addr >= seq->end)
+      return nullptr;
+
+    auto row = std::upper_bound(
+        rows.begin() + seq->first, rows.begin() + seq->last, addr,
+        [](std::uint64_t a, const Row& r) { return a < r.address; });
+    if (row == rows.begin() + seq->first)
+      return nullptr;
+    return &*(row - 1);
+  }
+
+  std::vector<Row> rows;
+  // sorted by begin
+  std::vector<Sequence> sequences;
+  // by file index of the program
+  std::vector<std::string> files;
+};
+
+LineIndex::LineIndex(const Elf& elf, std::size_t cache_rows)
+    : m_elf_(elf), m_cache_rows_(cache_rows) {}
+
+LineIndex::~LineIndex() {}
+
+std::size_t LineIndex::Units() const {
+  return m_units_.size();
+}
+
+Span<char> LineIndex::Section(std::string_view name) const {
+  const auto* sh = m_elf_.FindSection(name);
+  if (sh == nullptr)
+    return {};
+  return m_elf_.SectionData(sh - m_elf_.Sections().begin());
+}
+
+bool LineIndex::Build() {
+  // compressed debug sections are inflated side by side up front
+  std::vector<std::uint16_t> sections;
+  for (auto name : {".debug_line", ".debug_info", ".debug_abbrev",
+                    ".debug_str", ".debug_line_str", ".debug_addr",
+                    ".debug_ranges", ".debug_rnglists"}) {
+    const auto* sh = m_elf_.FindSection(name);
+    if (sh != nullptr)
+      sections.push_back(sh - m_elf_.Sections().begin());
+  }
+  m_elf_.Decompress(sections);
+
+  m_line_ = Section(".debug_line");
+  if (m_line_.empty())
+    return false;
+
+  bool little = m_elf_.Header().GetData() ==
+                static_cast<std::uint8_t>(EIdata::ELFDATA2LSB);
+  m_swap_ = little != kHostLittle;
+  m_info_ = Section(".debug_info");
+  m_abbrev_ = Section(".debug_abbrev");
+  m_str_ = Section(".debug_str");
+  m_line_str_ = Section(".debug_line_str");
+  m_addr_ = Section(".debug_addr");
+  m_ranges_ = Section(".debug_ranges");
+  m_rnglists_ = Section(".debug_rnglists");
+
+  for (std::uint64_t offset = 0; offset < m_info_.size();) {
+    offset = ReadUnit(offset);
+    if (offset == 0)
+      break;
+  }
+  std::sort(m_ranges_index_.begin(), m_ranges_index_.end());
+
+  spdlog::debug("{}: {} units, {} address ranges", m_elf_.Filename(),
+                m_units_.size(), m_ranges_index_.size());
+  return true;
+}
+
+std::uint64_t LineIndex::ReadUnit(std::uint64_t offset) {
+  DwarfCursor cur(m_info_, m_swap_, offset);
+  Unit unit;
+  auto end = cur.ReadLength(&unit.form.dwarf64);
+  unit.form.version = cur.Read<std::uint16_t>();
+  if (!cur.Ok() || unit.form.version < 2 || unit.form.version > 5)
+    return 0;
+
+  auto type = DwUnitType::DW_UT_compile;
+  std::uint64_t abbrev_offset;
+  if (unit.form.version >= 5) {
+    type = static_cast<DwUnitType>(cur.Read<std::uint8_t>());
+    unit.form.address_size = cur.Read<std::uint8_t>();
+    abbrev_offset = cur.ReadOffset(unit.form.dwarf64);
+  } else {
+    abbrev_offset = cur.ReadOffset(unit.form.dwarf64);
+    unit.form.address_size = cur.Read<std::uint8_t>();
+  }
+  if (!ValidAddressSize(unit.form.address_size))
+    return cur.Ok() ? end : 0;
+  // type units and the split halves of units map no addresses
+  if (type != DwUnitType::DW_UT_compile && type != DwUnitType::DW_UT_partial &&
+      type != DwUnitType::DW_UT_skeleton)
+    return end;
+  if (type == DwUnitType::DW_UT_skeleton)
+    cur.Skip(sizeof(std::uint64_t));
+
+  // the abbreviation of the unit DIE, usually the first of its table
+  auto code = cur.ReadUleb();
+  DwarfCursor abbrev(m_abbrev_, m_swap_, abbrev_offset);
+  while (abbrev.Ok()) {
+    auto abbrev_code = abbrev.ReadUleb();
+    if (abbrev_code == 0) {
+      abbrev.Seek(m_abbrev_.size() + 1);
+      break;
+    }
+    abbrev.ReadUleb();
+    abbrev.Read<std::uint8_t>();
+    if (abbrev_code == code)
+      break;
+    while (abbrev.Ok()) {
+      auto attr = abbrev.ReadUleb();
+      auto form = abbrev.ReadUleb();
+      if (form == static_cast<std::uint64_t>(DwForm::DW_FORM_implicit_const))
+        abbrev.ReadSleb();
+      if (attr == 0 && form == 0)
+        break;
+    }
+  }
+  if (!cur.Ok() || !abbrev.Ok())
+    return end;
+
+  bool has_line = false;
+  bool has_low = false;
+  bool has_high = false;
+  bool has_ranges = false;
+  std::uint64_t low = 0;
+  std::uint64_t high = 0;
+  std::uint64_t ranges = 0;
+  std::uint64_t rnglists_base = 0;
+  auto low_form = DwForm::DW_FORM_addr;
+  auto high_form = DwForm::DW_FORM_addr;
+  auto ranges_form = DwForm::DW_FORM_sec_offset;
+  while (true) {
+    auto attr = static_cast<DwAt>(abbrev.ReadUleb());
+    auto form = static_cast<DwForm>(abbrev.ReadUleb());
+    std::int64_t implicit = 0;
+    if (form == DwForm::DW_FORM_implicit_const)
+      implicit = abbrev.ReadSleb();
+    if (!abbrev.Ok())
+      return end;
+    if (attr == DwAt{} && form == DwForm{})
+      break;
+
+    std::uint64_t value;
+    std::string_view str;
+    if (!ReadForm(&cur, form, unit.form, implicit, &value, &str))
+      return end;
+
+    switch (attr) {
+      case DwAt::DW_AT_stmt_list:
+        has_line = true;
+        unit.line_offset = value;
+        break;
+      case DwAt::DW_AT_low_pc:
+        has_low = true;
+        low = value;
+        low_form = form;
+        break;
+      case DwAt::DW_AT_high_pc:
+        has_high = true;
+        high = value;
+        high_form = form;
+        break;
+      case DwAt::DW_AT_ranges:
+        has_ranges = true;
+        ranges = value;
+        ranges_form = form;
+        break;
+      case DwAt::DW_AT_comp_dir:
+        unit.comp_dir = FormString(form, value, str);
+        break;
+      case DwAt::DW_AT_addr_base:
+      case DwAt::DW_AT_GNU_addr_base:
+        unit.addr_base = value;
+        break;
+      case DwAt::DW_AT_rnglists_base:
+        rnglists_base = value;
+        break;
+      default:
+        break;
+    }
+  }
+  if (!has_line)
+    return end;
+
+  // attributes may refer to bases that come after them
+  if (has_low && IsAddrx(low_form))
+    low = Addrx(unit, low);
+  if (has_high && IsAddrx(high_form)) {
+    high = Addrx(unit, high);
+  } else if (has_high && high_form != DwForm::DW_FORM_addr) {
+    // a constant high_pc is the size of the unit
+    high += low;
+  }
+
+  auto idx = static_cast<std::uint32_t>(m_units_.size());
+  m_units_.push_back(unit);
+
+  bool indexed = false;
+  if (has_ranges) {
+    if (ranges_form == DwForm::DW_FORM_rnglistx) {
+      // an index into the offsets following the rnglists header
+      auto size = unit.form.dwarf64 ? 8 : 4;
+      DwarfCursor offsets(m_rnglists_, m_swap_, rnglists_base + ranges * size);
+      ranges = rnglists_base + offsets.ReadOffset(unit.form.dwarf64);
+      has_ranges = offsets.Ok();
+    }
+    indexed = has_ranges && AddRanges(unit, ranges, has_low ? low : 0, idx);
+  } else if (has_low && has_high && high > low) {
+    m_ranges_index_.push_back({low, high, idx});
+    indexed = true;
+  }
+
+  // without ranges the sequences of the program tell where the unit is
+  if (!indexed) {
+    const auto* program = Store(idx, Decode(unit));
+    for (const auto& seq : program->sequences) {
+      m_ranges_index_.push_back({seq.begin, seq.end, idx});
+    }
+  }
+  return end;
+}
+
+bool LineIndex::AddRanges(const Unit& unit,
+                          std::uint64_t offset,
+                          std::uint64_t base,
+                          std::uint32_t idx) {
+  auto size = m_ranges_index_.size();
+  auto address_size = unit.form.address_size;
+
+  if (unit.form.version < 5) {
+    // .debug_ranges: pairs relative to the base, a pair starting with the
+    // largest address selects a new base
+    std::uint64_t max = address_size == 4 ? UINT32_MAX : UINT64_MAX;
+    DwarfCursor cur(m_ranges_, m_swap_, offset);
+    while (cur.Ok()) {
+      auto begin = cur.ReadUnsigned(address_size);
+      auto end = cur.ReadUnsigned(address_size);
+      if (!cur.Ok() || (begin == 0 && end == 0))
+        break;
+      if (begin == max) {
+        base = end;
+      } else if (end > begin) {
+        m_ranges_index_.push_back({base + begin, base + end, idx});
+      }
+    }
+    return m_ranges_index_.size() > size;
+  }
+
+  DwarfCursor cur(m_rnglists_, m_swap_, offset);
+  while (cur.Ok()) {
+    std::uint64_t begin = 0;
+    std::uint64_t end = 0;
+    switch (static_cast<DwRle>(cur.Read<std::uint8_t>())) {
+      case DwRle::DW_RLE_end_of_list:
+        return m_ranges_index_.size() > size;
+      case DwRle::DW_RLE_base_addressx:
+        base = Addrx(unit, cur.ReadUleb());
+        continue;
+      case DwRle::DW_RLE_base_address:
+        base = cur.ReadUnsigned(address_size);
+        continue;
+      case DwRle::DW_RLE_startx_endx:
+        begin = Addrx(unit, cur.ReadUleb());
+        end = Addrx(unit, cur.ReadUleb());
+        break;
+      case DwRle::DW_RLE_startx_length:
+        begin = Addrx(unit, cur.ReadUleb());
+        end = begin + cur.ReadUleb();
+        break;
+      case DwRle::DW_RLE_offset_pair:
+        begin = base + cur.ReadUleb();
+        end = base + cur.ReadUleb();
+        break;
+      case DwRle::DW_RLE_start_end:
+        begin = cur.ReadUnsigned(address_size);
+        end = cur.ReadUnsigned(address_size);
+        break;
+      case DwRle::DW_RLE_start_length:
+        begin = cur.ReadUnsigned(address_size);
+        end = begin + cur.ReadUleb();
+        break;
+      default:
+        return m_ranges_index_.size() > size;
+    }
+    if (cur.Ok() && end > begin)
+      m_ranges_index_.push_back({begin, end, idx});
+  }
+  return m_ranges_index_.size() > size;
+}
+
+std::uint64_t LineIndex::Addrx(const Unit& unit, std::uint64_t index) const {
+  auto size = unit.form.address_size;
+  DwarfCursor cur(m_addr_, m_swap_, unit.addr_base + index * size);
+  return cur.ReadUnsigned(size);
+}
+
+std::string_view LineIndex::FormString(DwForm form,
+                                       std::uint64_t value,
+                                       std::string_view str) const {
+  switch (form) {
+    case DwForm::DW_FORM_string:
+      return str;
+    case DwForm::DW_FORM_strp:
+      return StringAt(m_str_, value);
+    case DwForm::DW_FORM_line_strp:
+      return StringAt(m_line_str_, value);
+    default:
+      // strx needs .debug_str_offsets, which split units keep elsewhere
+      return {};
+  }
+}
+
+std::unique_ptr<LineIndex::Program> LineIndex::Decode(const Unit& unit) const {
+  auto program = std::make_unique<Program>();
+
+  DwarfCursor cur(m_line_, m_swap_, unit.line_offset);
+  FormContext form = unit.form;
+  auto end = cur.ReadLength(&form.dwarf64);
+  form.version = cur.Read<std::uint16_t>();
+  if (!cur.Ok() || form.version < 2 || form.version > 5)
+    return program;
+  if (form.version >= 5) {
+    form.address_size = cur.Read<std::uint8_t>();
+    cur.Read<std::uint8_t>();  // segment selector size
+  }
+  if (!ValidAddressSize(form.address_size))
+    return program;
+  auto header_length = cur.ReadOffset(form.dwarf64);
+  auto program_offset = cur.Offset() + header_length;
+  std::uint8_t min_inst_length = cur.Read<std::uint8_t>();
+  if (form.version >= 4)
+    cur.Read<std::uint8_t>();  // VLIW ops per instruction, taken as 1
+  cur.Read<std::uint8_t>();    // default_is_stmt
+  auto line_base = static_cast<std::int8_t>(cur.Read<std::uint8_t>());
+  std::uint8_t line_range = cur.Read<std::uint8_t>();
+  std::uint8_t opcode_base = cur.Read<std::uint8_t>();
+  std::vector<std::uint8_t> opcode_lengths;
+  for (int i = 1; i < opcode_base; i++) {
+    opcode_lengths.push_back(cur.Read<std::uint8_t>());
+  }
+
+  // directory 0 is the compilation directory, before DWARF 5 it is implied
+  // and file 0 does not exist
+  std::vector<std::string_view> dirs;
+  std::vector<std::pair<std::string_view, std::uint64_t>> files;
+  if (form.version < 5) {
+    dirs.push_back(unit.comp_dir);
+    for (auto dir = cur.ReadString(); !dir.empty(); dir = cur.ReadString()) {
+      dirs.push_back(dir);
+    }
+    files.emplace_back();
+    for (auto file = cur.ReadString(); !file.empty(); file = cur.ReadString()) {
+      auto dir = cur.ReadUleb();
+      cur.ReadUleb();  // modification time
+      cur.ReadUleb();  // size
+      files.emplace_back(file, dir);
+    }
+  } else {
+    // both tables are described by a list of (content, form)
+    auto read_entries = [&](auto add) {
+      std::vector<std::pair<DwLnct, DwForm>> format(cur.Read<std::uint8_t>());
+      for (auto& it : format) {
+        it.first = static_cast<DwLnct>(cur.ReadUleb());
+        it.second = static_cast<DwForm>(cur.ReadUleb());
+      }
+      auto count = cur.ReadUleb();
+      for (std::uint64_t i = 0; i < count && cur.Ok(); i++) {
+        std::string_view path;
+        std::uint64_t dir = 0;
+        for (const auto& it : format) {
+          std::uint64_t value;
+          std::string_view str;
+          if (!ReadForm(&cur, it.second, form, 0, &value, &str))
+            return;
+          if (it.first == DwLnct::DW_LNCT_path)
+            path = FormString(it.second, value, str);
+          else if (it.first == DwLnct::DW_LNCT_directory_index)
+            dir = value;
+        }
+        add(path, dir);
+      }
+    };
+    read_entries([&](std::string_view path, std::uint64_t) {
+      dirs.push_back(path);
+    });
+    read_entries([&](std::string_view path, std::uint64_t dir) {
+      files.emplace_back(path, dir);
+    });
+  }
+  if (!cur.Ok() || line_range == 0)
+    return program;
+
+  for (const auto& file : files) {
+    std::string path;
+    if (!file.first.empty() && file.first[0] != '/' &&
+        file.second < dirs.size()) {
+      auto dir = dirs[file.second];
+      // directories other than 0 may be relative to it
+      if (file.second != 0 && (dir.empty() || dir[0] != '/') &&
+          !dirs[0].empty()) {
+        path.append(dirs[0]).append("/");
+      }
+      if (!dir.empty())
+        path.append(dir).append("/");
+    }
+    path.append(file.first);
+    program->files.push_back(std::move(path));
+  }
+
+  // the line number state machine, rows are appended as they are emitted
+  std::uint64_t address = 0;
+  std::uint32_t file = 1;
+  std::int64_t line = 1;
+  std::uint64_t column = 0;
+  std::uint32_t first = 0;
+  auto emit = [&]() {
+    program->rows.push_back({address, static_cast<std::uint32_t>(line), file,
+                             static_cast<std::uint32_t>(column)});
+  };
+
+  cur.Seek(program_offset);
+  while (cur.Ok() && cur.Offset() < end) {
+    std::uint8_t opcode = cur.Read<std::uint8_t>();
+    if (opcode >= opcode_base) {
+      std::uint8_t adjusted = opcode - opcode_base;
+      address += (adjusted / line_range) * min_inst_length;
+      line += line_base + adjusted % line_range;
+      emit();
+      continue;
+    }
+
+    if (opcode == 0) {
+      auto length = cur.ReadUleb();
+      if (length > cur.Remaining())
+        break;
+      auto next = cur.Offset() + length;
+      if (length == 0)
+        continue;
+      switch (static_cast<DwLne>(cur.Read<std::uint8_t>())) {
+        case DwLne::DW_LNE_end_sequence:
+          emit();
+          if (address > program->rows[first].address) {
+            program->sequences.push_back(
+                {program->rows[first].address, address, first,
+                 static_cast<std::uint32_t>(program->rows.size())});
+          }
+          first = program->rows.size();
+          address = 0;
+          file = 1;
+          line = 1;
+          column = 0;
+          break;
+        case DwLne::DW_LNE_set_address:
+          // any other operand size is malformed, the address is kept
+          if (length - 1 == form.address_size)
+            address = cur.ReadUnsigned(form.address_size);
+          break;
+        default:
+          break;
+      }
+      cur.Seek(next);
+      continue;
+    }
+
+    switch (static_cast<DwLns>(opcode)) {
+      case DwLns::DW_LNS_copy:
+        emit();
+        break;
+      case DwLns::DW_LNS_advance_pc:
+        address += cur.ReadUleb() * min_inst_length;
+        break;
+      case DwLns::DW_LNS_advance_line:
+        line += cur.ReadSleb();
+        break;
+      case DwLns::DW_LNS_set_file:
+        file = cur.ReadUleb();
+        break;
+      case DwLns::DW_LNS_set_column:
+        column = cur.ReadUleb();
+        break;
+      case DwLns::DW_LNS_const_add_pc:
+        address += ((255 - opcode_base) / line_range) * min_inst_length;
+        break;
+      case DwLns::DW_LNS_fixed_advance_pc:
+        address += cur.Read<std::uint16_t>();
+        break;
+      case DwLns::DW_LNS_negate_stmt:
+      case DwLns::DW_LNS_set_basic_block:
+      case DwLns::DW_LNS_set_prologue_end:
+      case DwLns::DW_LNS_set_epilogue_begin:
+        break;
+      default:
+        // DW_LNS_set_isa and opcodes of later versions
+        for (int i = 0; i < opcode_lengths[opcode - 1]; i++) {
+          cur.ReadUleb();
+        }
+        break;
+    }
+  }
+
+  std::sort(program->sequences.begin(), program->sequences.end());
+  return program;
+}
+
+const LineIndex::Program* LineIndex::Store(std::uint32_t unit,
+                                           std::unique_ptr<Program> program) {
+  m_decodes_++;
+  m_cached_rows_ += program->rows.size();
+  m_lru_.push_front(unit);
+  const auto* stored = program.get();
+  m_programs_[unit] = std::make_pair(std::move(program), m_lru_.begin());
+
+  // the program just stored stays, however large it is
+  while (m_cached_rows_ > m_cache_rows_ && m_lru_.size() > 1) {
+    auto it = m_programs_.find(m_lru_.back());
+    m_cached_rows_ -= it->second.first->rows.size();
+    m_programs_.erase(it);
+    m_lru_.pop_back();
+  }
+  return stored;
+}
+
+const LineIndex::Program* LineIndex::Decoded(std::uint32_t unit) {
+  auto it = m_programs_.find(unit);
+  if (it == m_programs_.end())
+    return Store(unit, Decode(m_units_[unit]));
+
+  m_lru_.splice(m_lru_.begin(), m_lru_, it->second.second);
+  return it->second.first.get();
+}
+
+LineInfo LineIndex::Lookup(std::uint64_t addr) {
+  LineInfo info;
+  auto range = std::upper_bound(m_ranges_index_.begin(), m_ranges_index_.end(),
+                                Range{addr, 0, 0});
+  if (range == m_ranges_index_.begin())
+    return info;
+  --range;
+  if (addr >= range->end)
+    return info;
+
+  const auto* program = Decoded(range->unit);
+  const auto* row = program->Find(addr);
+  if (row == nullptr)
+    return info;
+
+  const auto& files = program->files;
+  info.file = row->file < files.size() ? files[row->file] : "??";
+  info.line = row->line;
+  info.column = row->column;
+  return info;
+}
+
+}  // namespace xorg
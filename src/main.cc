@@ -2,14 +2,343 @@
  * Copyright 2022 hupeng.
  * SPDX-License-Identifier: MIT
  */
+#include <llvm/Support/CommandLine.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/spdlog.h>
-#include <fstream>
-#include <ios>
+#include <unistd.h>
+#include <csignal>
+#include <iostream>
 #include <memory>
+#include <string>
+#include <thread>
+#include <vector>
 
+#include "address_space.h"
+#include "bloat_report.h"
+#include "core_file.h"
+#include "demangler.h"
+#include "dependency_resolver.h"
 #include "elf.h"
+#include "elf_diff.h"
+#include "elf_range.h"
+#include "line_index.h"
+#include "output.h"
+#include "parse_cache.h"
+#include "scanner.h"
+#include "string_index.h"
+#include "symbol_server.h"
+#include "symbolizer.h"
+
+static llvm::cl::list<std::string> InputFiles(
+    llvm::cl::Positional,
+    llvm::cl::desc("<elf file, '-' for stdin, defaults to this program>"));
+
+static llvm::cl::opt<bool> Symbolize(
+    "symbolize",
+    llvm::cl::desc("Read addresses from stdin, print the symbol of each"));
+
+static llvm::cl::opt<bool> Lines(
+    "lines",
+    llvm::cl::desc("With --symbolize, add the source file and line of each "
+                   "address from .debug_line"));
+
+static llvm::cl::opt<bool> Relocs(
+    "relocs",
+    llvm::cl::desc("Print the relocations instead of the symbols"));
+
+static llvm::cl::opt<bool> RelocStats(
+    "reloc-stats",
+    llvm::cl::desc("Print relocation counts by type and by target section"));
+
+static llvm::cl::opt<bool> CheckNames(
+    "check-names",
+    llvm::cl::desc("Check where the section and symbol names point in their "
+                   "string tables"));
+
+static llvm::cl::opt<bool> Diff(
+    "diff",
+    llvm::cl::desc("Compare two ELF files <old> <new>: sections and symbols "
+                   "added, removed or resized"));
+
+static llvm::cl::opt<bool> Core(
+    "core",
+    llvm::cl::desc("Print the threads, mapped files and auxiliary vector of "
+                   "a core file"));
+
+static llvm::cl::list<std::string> Memory(
+    "memory",
+    llvm::cl::desc("Dump <len> bytes (64 by default) at virtual address "
+                   "<addr>, from the PT_LOAD segments of a file or the "
+                   "memory of a core"),
+    llvm::cl::value_desc("addr[+len]"),
+    llvm::cl::CommaSeparated);
+
+static llvm::cl::opt<bool> Bloat(
+    "bloat",
+    llvm::cl::desc("Sum the sizes of the functions and objects defined in "
+                   "the inputs by namespace, class and template"));
+
+static llvm::cl::opt<unsigned> Top(
+    "top",
+    llvm::cl::desc("With --bloat, the largest <n> scopes at each level"),
+    llvm::cl::value_desc("n"),
+    llvm::cl::init(10));
+
+static llvm::cl::opt<unsigned> BloatDepth(
+    "bloat-depth",
+    llvm::cl::desc("With --bloat, how many levels of scopes to print"),
+    llvm::cl::value_desc("n"),
+    llvm::cl::init(3));
+
+static llvm::cl::opt<bool> Scan(
+    "scan",
+    llvm::cl::desc("Summarize every ELF file found in the inputs: files, "
+                   "directories, glob patterns or @file lists"));
+
+static llvm::cl::opt<bool> Deps(
+    "deps",
+    llvm::cl::desc("Print the shared libraries each ELF file found in the "
+                   "inputs loads, resolved like ld.so does"));
+
+static llvm::cl::opt<std::string> Sysroot(
+    "sysroot",
+    llvm::cl::desc("Resolve --deps below <dir> instead of /"),
+    llvm::cl::value_desc("dir"),
+    llvm::cl::init("/"));
+
+static llvm::cl::opt<std::string> LibraryPath(
+    "library-path",
+    llvm::cl::desc("Colon separated directories --deps searches like "
+                   "LD_LIBRARY_PATH"),
+    llvm::cl::value_desc("dirs"));
+
+static llvm::cl::opt<std::string> Serve(
+    "serve",
+    llvm::cl::desc("Symbolize batches of addresses for clients on the Unix "
+                   "socket <path>, see symbol_server.h for the protocol"),
+    llvm::cl::value_desc("path"));
+
+static llvm::cl::opt<unsigned> CacheMb(
+    "cache-mb",
+    llvm::cl::desc("With --serve, keep parsed binaries up to <n> MB"),
+    llvm::cl::value_desc("n"),
+    llvm::cl::init(1024));
+
+static llvm::cl::opt<std::string> BuildIdDir(
+    "build-id-dir",
+    llvm::cl::desc("With --serve, find binaries by build-id as "
+                   "<dir>/xx/xxxx.debug"),
+    llvm::cl::value_desc("dir"),
+    llvm::cl::init("/usr/lib/debug/.build-id"));
+
+static llvm::cl::opt<unsigned> Jobs(
+    "jobs",
+    llvm::cl::desc("Worker threads for --scan, --deps, --bloat and --serve, "
+                   "0 uses one per core"),
+    llvm::cl::init(0));
+
+static llvm::cl::opt<std::string> CacheDir(
+    "cache-dir",
+    llvm::cl::desc("Keep decoded symbols in <dir>, keyed by build-id, for "
+                   "--symbolize to use on later runs without parsing"),
+    llvm::cl::value_desc("dir"));
+
+static llvm::cl::opt<xorg::OutputFormat> Format(
+    "format",
+    llvm::cl::desc("Output format"),
+    llvm::cl::values(
+        clEnumValN(xorg::OutputFormat::kTable, "table", "readelf style table"),
+        clEnumValN(xorg::OutputFormat::kJsonLines, "jsonl",
+                   "one JSON object per line"),
+        clEnumValN(xorg::OutputFormat::kCsv, "csv", "comma separated values")),
+    llvm::cl::init(xorg::OutputFormat::kTable));
+
+static int ScanInputs(xorg::Output& out) {
+  xorg::Scanner scanner(Jobs);
+  for (const auto& input : InputFiles) {
+    scanner.Add(input);
+  }
+
+  for (const auto& result : scanner.Run()) {
+    if (out.IsTable()) {
+      if (!result.ok) {
+        out.Print("{}\tunreadable\n", result.path);
+        continue;
+      }
+      out.Print("{}\t{}\t{}\t{} segments\t{} sections\t{} symbols\t{} "
+                "bytes parsed\n",
+                result.path, result.type, result.machine, result.segments,
+                result.sections, result.symbols, result.parse_bytes);
+      continue;
+    }
+
+    out.BeginRecord();
+    out.Field("path", result.path);
+    out.Flag("ok", result.ok);
+    out.Field("type", result.type);
+    out.Field("machine", result.machine);
+    out.Field("segments", result.segments);
+    out.Field("sections", result.sections);
+    out.Field("symbols", result.symbols);
+    out.Field("parse_bytes", result.parse_bytes);
+    out.EndRecord();
+  }
+  return 0;
+}
+
+static int ResolveDependencies(xorg::Output& out) {
+  xorg::Scanner scanner;
+  for (const auto& input : InputFiles) {
+    scanner.Add(input);
+  }
+  std::vector<std::string> paths;
+  for (const auto& path : scanner.Paths()) {
+    if (xorg::Scanner::IsElf(path))
+      paths.push_back(path);
+  }
+
+  xorg::DependencyResolver resolver(Sysroot, LibraryPath);
+  for (const auto& closure : resolver.ResolveAll(paths, Jobs)) {
+    if (out.IsTable()) {
+      out.Print("{}{}\n", closure.path, closure.ok ? ":" : ": unreadable");
+      for (const auto& dep : closure.dependencies) {
+        out.Print("{:>{}}{} => {}\n", "", dep.depth * 2, dep.name,
+                  dep.path.empty() ? "not found" : dep.path);
+      }
+      continue;
+    }
+
+    for (const auto& dep : closure.dependencies) {
+      out.BeginRecord();
+      out.Field("path", closure.path);
+      out.Field("needed", dep.name);
+      out.Field("resolved", dep.path);
+      out.Field("needed_by", dep.needed_by);
+      out.Field("depth", dep.depth);
+      out.EndRecord();
+    }
+  }
+  spdlog::debug("{} shared objects parsed", resolver.Cache().size());
+  return 0;
+}
+
+static int SymbolizeStdin(const xorg::Symbolizer& symbolizer,
+                          xorg::Output& out) {
+  auto addrs = xorg::Symbolizer::ReadAddresses(std::cin, "stdin");
+  symbolizer.Print(xorg::Span<std::uint64_t>(addrs.data(), addrs.size()), out);
+  return 0;
+}
+
+static int CheckNameOffsets(const xorg::Elf& elf, xorg::Output& out) {
+  xorg::NameOffsetReport report;
+  report.Build(elf);
+  report.Print(out);
+  return 0;
+}
+
+static int DiffFiles(xorg::Output& out) {
+  if (InputFiles.size() != 2) {
+    spdlog::error("--diff takes two files, <old> <new>");
+    return 1;
+  }
+
+  xorg::Elf old_elf(InputFiles[0]);
+  xorg::Elf new_elf(InputFiles[1]);
+  if (!old_elf.Parse() || !new_elf.Parse())
+    return 1;
+
+  xorg::ElfDiff diff;
+  diff.Build(old_elf, new_elf);
+  diff.Print(out);
+  return 0;
+}
+
+static int PrintCore(const xorg::Elf& elf, xorg::Output& out) {
+  xorg::CoreFile core(elf);
+  if (!core.Parse())
+    return 1;
+  core.Print(out);
+  return 0;
+}
+
+// Reads the --memory ranges, and no other part of the segments.
+static int DumpMemory(const xorg::Elf& elf, xorg::Output& out) {
+  xorg::AddressSpace memory;
+  memory.Build(elf);
+
+  for (const auto& range : Memory) {
+    auto plus = range.find('+');
+    std::uint64_t addr;
+    std::uint64_t size = 64;
+    if (!xorg::ParseAddress(range.substr(0, plus), &addr) ||
+        (plus != std::string::npos &&
+         !xorg::ParseAddress(range.substr(plus + 1), &size))) {
+      spdlog::error("--memory={}: expected addr[+len]", range);
+      return 1;
+    }
+    memory.Dump(addr, size, out);
+  }
+  return 0;
+}
+
+// Defined functions and objects of every input, one Demangler for all of
+// them so that names repeated across files are demangled once.
+static int BloatInputs(xorg::Output& out) {
+  xorg::Demangler demangler(Jobs);
+  xorg::BloatReport report;
+  for (const auto& input : InputFiles) {
+    // the scopes are copies held by the demangler, the file can go
+    xorg::Elf elf(input);
+    if (!elf.Parse())
+      return 1;
+
+    std::vector<std::string_view> names;
+    std::vector<std::uint64_t> sizes;
+    for (auto entry : xorg::SymbolRange(elf)) {
+      const auto& symbol = entry.symbol;
+      auto undef = static_cast<std::uint16_t>(xorg::SHNdx::SHN_UNDEF);
+      if (symbol.Shndx() == undef || symbol.Size() == 0 ||
+          (symbol.Type() != xorg::STType::STT_FUNC &&
+           symbol.Type() != xorg::STType::STT_OBJECT))
+        continue;
+      names.push_back(entry.name);
+      sizes.push_back(symbol.Size());
+    }
+
+    auto scopes = demangler.Scopes(names);
+    for (std::size_t i = 0; i < scopes.size(); i++) {
+      report.Add(scopes[i], sizes[i]);
+    }
+    spdlog::debug("{}: {} symbols, {} names demangled so far", input,
+                  names.size(), demangler.size());
+  }
+
+  report.Print(out, Top, BloatDepth);
+  return 0;
+}
+
+// Serves until SIGINT or SIGTERM, which a thread waits for so that the
+// server is stopped outside of a signal handler.
+static int ServeSymbols() {
+  xorg::SymbolServer server(Jobs, std::uint64_t(CacheMb) << 20, BuildIdDir);
+
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+  std::thread([&server, signals]() {
+    int signal;
+    sigwait(&signals, &signal);
+    server.Stop();
+  }).detach();
+
+  return server.Run(Serve) ? 0 : 1;
+}
 
 int main(int argc, char* argv[]) {
+  // diagnostics go to stderr, stdout carries the records
+  spdlog::set_default_logger(spdlog::stderr_color_mt("stderr"));
   // spdlog::set_level(spdlog::level::debug);
   spdlog::set_pattern("%v");
 
@@ -18,10 +347,74 @@ int main(int argc, char* argv[]) {
     spdlog::debug("argv[{}]: {}", i, argv[i]);
   }
 
-  // use current file
-  auto elf = std::make_unique<xorg::Elf>(argv[0]);
-  elf->Parse();
-  elf->Print();
+  llvm::cl::ParseCommandLineOptions(argc, argv, "ELF study\n");
+
+  // use current file by default
+  if (InputFiles.empty())
+    InputFiles.push_back(argv[0]);
+
+  if (!Serve.empty())
+    return ServeSymbols();
+
+  xorg::Output out(STDOUT_FILENO, Format);
+  if (Scan)
+    return ScanInputs(out);
+  if (Deps)
+    return ResolveDependencies(out);
+  if (Diff)
+    return DiffFiles(out);
+  if (Bloat)
+    return BloatInputs(out);
+
+  if (Symbolize && InputFiles.front() == "-") {
+    spdlog::error("--symbolize reads addresses from stdin, pass a file");
+    return 1;
+  }
+
+  // a cache hit does not read the file, .debug_line is in there though
+  if (Symbolize && !Lines && !CacheDir.empty()) {
+    auto cached = xorg::ParseCache(CacheDir).Find(InputFiles.front());
+    if (cached != nullptr)
+      return SymbolizeStdin(xorg::Symbolizer(*cached), out);
+  }
+
+  auto elf = std::make_unique<xorg::Elf>(InputFiles.front());
+  if (!elf->Parse())
+    return 1;
+
+  if (!CacheDir.empty()) {
+    xorg::ParseCache cache(CacheDir);
+    if (cache.Find(*elf) == nullptr)
+      cache.Store(*elf);
+  }
+
+  if (Symbolize) {
+    xorg::Symbolizer symbolizer(*elf);
+    xorg::LineIndex lines(*elf);
+    if (Lines) {
+      if (!lines.Build())
+        spdlog::warn("{}: no .debug_line, --lines ignored", elf->Filename());
+      symbolizer.SetLines(&lines);
+    }
+    auto status = SymbolizeStdin(symbolizer, out);
+    spdlog::debug("{} of {} line programs decoded", lines.Decodes(),
+                  lines.Units());
+    return status;
+  }
+  if (CheckNames)
+    return CheckNameOffsets(*elf, out);
+  if (!Memory.empty())
+    return DumpMemory(*elf, out);
+  if (Core)
+    return PrintCore(*elf, out);
+
+  if (Relocs) {
+    elf->PrintRelocations(out);
+  } else if (RelocStats) {
+    elf->PrintRelocationStats(out);
+  } else {
+    elf->Print(out);
+  }
 
   return 0;
 }
@@ -0,0 +1,88 @@
+/**
+ * Copyright 2022 hupeng.
+ * SPDX-License-Identifier: MIT
+ */
+#include "mapped_file.h"
+
+#include <fcntl.h>
+#include <spdlog/spdlog.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+namespace xorg {
+
+MappedFile::~MappedFile() {
+  Close();
+}
+
+bool MappedFile::Open(const std::string& filename) {
+  Close();
+
+  int fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    spdlog::error("open {} failed: {}", filename, std::strerror(errno));
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) < 0 || st.st_size == 0) {
+    spdlog::error("{} is empty or cannot be stat'ed", filename);
+    close(fd);
+    return false;
+  }
+
+  void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED) {
+    spdlog::error("mmap {} failed: {}", filename, std::strerror(errno));
+    return false;
+  }
+
+  m_data_ = static_cast<const char*>(addr);
+  m_size_ = st.st_size;
+  return true;
+}
+
+void MappedFile::Close() {
+  if (m_data_ != nullptr) {
+    munmap(const_cast<char*>(m_data_), m_size_);
+    m_data_ = nullptr;
+    m_size_ = 0;
+  }
+}
+
+void MappedFile::Advise(std::uint64_t offset,
+                        std::uint64_t length,
+                        Access access) const {
+  if (m_data_ == nullptr || offset >= m_size_)
+    return;
+
+  static const long kPageSize = sysconf(_SC_PAGESIZE);
+  // madvise wants a page aligned start address
+  std::uint64_t begin = offset & ~(static_cast<std::uint64_t>(kPageSize) - 1);
+  // lengths come from headers, offset + length may wrap
+  std::uint64_t end = length > m_size_ - offset ? m_size_ : offset + length;
+
+  int advice = MADV_NORMAL;
+  switch (access) {
+    case Access::kSequential:
+      advice = MADV_SEQUENTIAL;
+      break;
+    case Access::kRandom:
+      advice = MADV_RANDOM;
+      break;
+    case Access::kWillNeed:
+      advice = MADV_WILLNEED;
+      break;
+    case Access::kNormal:
+    default:
+      break;
+  }
+
+  madvise(const_cast<char*>(m_data_) + begin, end - begin, advice);
+}
+
+}  // namespace xorg
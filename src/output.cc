@@ -0,0 +1,202 @@
+/**
+ * Copyright 2022 hupeng.
+ * SPDX-License-Identifier: MIT
+ */
+#include "output.h"
+
+#include <spdlog/spdlog.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+namespace xorg {
+
+// Length of the well formed UTF-8 sequence at the start of `s`, 0 when it is
+// not one: overlong forms, surrogates and code points past U+10FFFF included.
+static std::size_t Utf8Length(std::string_view s) {
+  auto byte = [&](std::size_t i) { return static_cast<unsigned char>(s[i]); };
+  auto lead = byte(0);
+  std::size_t n;
+  unsigned char lo = 0x80, hi = 0xbf;
+  if (lead < 0x80) {
+    return 1;
+  } else if (lead >= 0xc2 && lead <= 0xdf) {
+    n = 2;
+  } else if (lead >= 0xe0 && lead <= 0xef) {
+    n = 3;
+    if (lead == 0xe0)
+      lo = 0xa0;
+    else if (lead == 0xed)
+      hi = 0x9f;
+  } else if (lead >= 0xf0 && lead <= 0xf4) {
+    n = 4;
+    if (lead == 0xf0)
+      lo = 0x90;
+    else if (lead == 0xf4)
+      hi = 0x8f;
+  } else {
+    return 0;
+  }
+
+  if (s.size() < n || byte(1) < lo || byte(1) > hi)
+    return 0;
+  for (std::size_t i = 2; i < n; i++) {
+    if ((byte(i) & 0xc0) != 0x80)
+      return 0;
+  }
+  return n;
+}
+
+Output::Output(int fd, OutputFormat format) : m_fd_(fd), m_format_(format) {}
+
+Output::~Output() {
+  Flush();
+}
+
+void Output::Flush() {
+  const char* data = m_buffer_.data();
+  std::size_t left = m_buffer_.size();
+  while (left > 0) {
+    ssize_t n = write(m_fd_, data, left);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0) {
+      spdlog::error("write output failed: {}", std::strerror(errno));
+      break;
+    }
+    data += n;
+    left -= n;
+  }
+  m_buffer_.clear();
+}
+
+void Output::BeginRecord() {
+  m_keys_.clear();
+  m_row_.clear();
+}
+
+void Output::Key(std::string_view key) {
+  bool first = m_keys_.empty();
+  m_keys_.push_back(key);
+
+  if (m_format_ == OutputFormat::kCsv) {
+    if (!first)
+      m_row_.push_back(',');
+    return;
+  }
+
+  m_row_.push_back(first ? '{' : ',');
+  Quoted(key);
+  m_row_.push_back(':');
+}
+
+void Output::Field(std::string_view key, std::string_view value) {
+  Key(key);
+  Quoted(value);
+}
+
+void Output::Field(std::string_view key, std::uint64_t value) {
+  Key(key);
+  fmt::format_to(fmt::appender(m_row_), "{}", value);
+}
+
+void Output::SignedField(std::string_view key, std::int64_t value) {
+  Key(key);
+  fmt::format_to(fmt::appender(m_row_), "{}", value);
+}
+
+void Output::HexField(std::string_view key, std::uint64_t value) {
+  Key(key);
+  // JSON has no hex literals
+  if (m_format_ == OutputFormat::kCsv) {
+    fmt::format_to(fmt::appender(m_row_), "{:#x}", value);
+  } else {
+    fmt::format_to(fmt::appender(m_row_), "\"{:#x}\"", value);
+  }
+}
+
+void Output::Flag(std::string_view key, bool value) {
+  Key(key);
+  m_row_.append(std::string_view(value ? "true" : "false"));
+}
+
+void Output::EndRecord() {
+  if (m_format_ == OutputFormat::kCsv) {
+    if (m_keys_ != m_header_) {
+      m_header_ = m_keys_;
+      for (std::size_t i = 0; i < m_header_.size(); i++) {
+        if (i > 0)
+          m_buffer_.push_back(',');
+        m_buffer_.append(m_header_[i]);
+      }
+      m_buffer_.push_back('\n');
+    }
+  } else {
+    if (m_keys_.empty())
+      m_row_.push_back('{');
+    m_row_.push_back('}');
+  }
+
+  m_buffer_.append(m_row_);
+  m_buffer_.push_back('\n');
+  FlushIfFull();
+}
+
+void Output::Quoted(std::string_view value) {
+  if (m_format_ == OutputFormat::kCsv) {
+    // RFC 4180, only quote when needed
+    if (value.find_first_of(",\"\r\n") == std::string_view::npos) {
+      m_row_.append(value);
+      return;
+    }
+    m_row_.push_back('"');
+    for (char c : value) {
+      if (c == '"')
+        m_row_.push_back('"');
+      m_row_.push_back(c);
+    }
+    m_row_.push_back('"');
+    return;
+  }
+
+  m_row_.push_back('"');
+  for (std::size_t i = 0; i < value.size(); i++) {
+    char c = value[i];
+    switch (c) {
+      case '"':
+        m_row_.append(std::string_view("\\\""));
+        break;
+      case '\\':
+        m_row_.append(std::string_view("\\\\"));
+        break;
+      case '\n':
+        m_row_.append(std::string_view("\\n"));
+        break;
+      case '\t':
+        m_row_.append(std::string_view("\\t"));
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          fmt::format_to(fmt::appender(m_row_), "\\u{:04x}",
+                         static_cast<unsigned>(c));
+        } else if (static_cast<unsigned char>(c) >= 0x80) {
+          // names are arbitrary bytes, strict parsers reject invalid UTF-8:
+          // such bytes are escaped as the code point of the same value
+          auto n = Utf8Length(value.substr(i));
+          if (n == 0) {
+            fmt::format_to(fmt::appender(m_row_), "\\u{:04x}",
+                           static_cast<unsigned char>(c));
+          } else {
+            m_row_.append(value.substr(i, n));
+            i += n - 1;
+          }
+        } else {
+          m_row_.push_back(c);
+        }
+        break;
+    }
+  }
+  m_row_.push_back('"');
+}
+
+}  // namespace xorg
@@ -0,0 +1,278 @@
+/**
+ * Copyright 2022 hupeng.
+ * SPDX-License-Identifier: MIT
+ */
+#include "parse_cache.h"
+
+#include <spdlog/fmt/fmt.h>
+#include <spdlog/spdlog.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <system_error>
+#include <thread>
+
+#include "elf.h"
+#include "elf_spec.h"
+
+namespace xorg {
+
+namespace fs = std::filesystem;
+
+static const char kMagic[8] = {'E', 'L', 'F', 'S', 'C', 'A', 'C', 'H'};
+// bump whenever the layout below changes
+static const std::uint32_t kVersion = 1;
+
+struct CacheHeader {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t sections;
+  std::uint64_t symbols;
+  std::uint64_t section_names_size;
+  std::uint64_t symbol_names_size;
+};
+
+// The blocks following the header, each starts 8 byte aligned so that the
+// columns can be used in place.
+struct CacheLayout {
+  explicit CacheLayout(const CacheHeader& header) {
+    std::uint64_t offset = sizeof(CacheHeader);
+    auto next = [&](std::uint64_t size) {
+      std::uint64_t start = offset;
+      offset = (offset + size + 7) & ~static_cast<std::uint64_t>(7);
+      return start;
+    };
+
+    sections = next(header.sections * sizeof(Elf64_Shdr));
+    value = next(header.symbols * sizeof(std::uint64_t));
+    size = next(header.symbols * sizeof(std::uint64_t));
+    name = next(header.symbols * sizeof(std::uint32_t));
+    shndx = next(header.symbols * sizeof(std::uint16_t));
+    info = next(header.symbols * sizeof(std::uint8_t));
+    section_names = next(header.section_names_size);
+    symbol_names = next(header.symbol_names_size);
+    end = offset;
+  }
+
+  std::uint64_t sections;
+  std::uint64_t value;
+  std::uint64_t size;
+  std::uint64_t name;
+  std::uint64_t shndx;
+  std::uint64_t info;
+  std::uint64_t section_names;
+  std::uint64_t symbol_names;
+  std::uint64_t end;
+};
+
+bool CachedParse::Open(const std::string& path) {
+  if (!m_file_.Open(path))
+    return false;
+
+  const auto* header = m_file_.View<CacheHeader>(0);
+  if (header == nullptr ||
+      std::memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 ||
+      header->version != kVersion) {
+    spdlog::warn("{}: not a cache file of this version", path);
+    return false;
+  }
+
+  // counts are checked one by one, their sum must not overflow
+  std::uint64_t limit = m_file_.Size();
+  if (header->sections > limit || header->symbols > limit ||
+      header->section_names_size > limit || header->symbol_names_size > limit) {
+    spdlog::warn("{}: truncated cache file", path);
+    return false;
+  }
+  CacheLayout layout(*header);
+  if (layout.end > limit) {
+    spdlog::warn("{}: truncated cache file", path);
+    return false;
+  }
+
+  const char* base = m_file_.Data();
+  m_sections_ = Span<SectionHeader>(
+      reinterpret_cast<const SectionHeader*>(base + layout.sections),
+      header->sections);
+  m_section_names_ = StringTab(base + layout.section_names,
+                               header->section_names_size, 0);
+  m_symbol_names_ =
+      StringTab(base + layout.symbol_names, header->symbol_names_size, 0);
+  m_columns_.Attach(
+      header->symbols,
+      reinterpret_cast<const std::uint64_t*>(base + layout.value),
+      reinterpret_cast<const std::uint64_t*>(base + layout.size),
+      reinterpret_cast<const std::uint8_t*>(base + layout.info),
+      reinterpret_cast<const std::uint16_t*>(base + layout.shndx),
+      reinterpret_cast<const std::uint32_t*>(base + layout.name));
+  return true;
+}
+
+// unique per writer, scanner threads may store the same entry
+static std::string TempName(const std::string& path) {
+  auto thread = std::hash<std::thread::id>()(std::this_thread::get_id());
+  return fmt::format("{}.{}.{:x}", path, getpid(), thread);
+}
+
+std::string ParseCache::BuildIdPath(const Elf& elf) const {
+  auto build_id = elf.BuildId();
+  if (build_id.empty())
+    return {};
+
+  auto symbols = elf.SymbolsSection();
+  const char* table =
+      symbols != 0 && elf.Sections()[symbols].Type() ==
+                          static_cast<std::uint32_t>(SHType::SHT_SYMTAB)
+          ? "symtab"
+          : "dynsym";
+
+  fmt::memory_buffer key;
+  for (auto byte : build_id) {
+    fmt::format_to(fmt::appender(key), "{:02x}", byte);
+  }
+  return fmt::format("{}/{}.{}", m_dir_, fmt::to_string(key), table);
+}
+
+std::string ParseCache::StatPath(const std::string& filename) const {
+  struct stat st;
+  if (filename == "-" || stat(filename.c_str(), &st) != 0 ||
+      !S_ISREG(st.st_mode))
+    return {};
+
+  std::uint64_t mtime = st.st_mtim.tv_sec * 1000000000ull + st.st_mtim.tv_nsec;
+  return fmt::format("{}/{:x}-{:x}-{:x}-{:x}", m_dir_, st.st_dev, st.st_ino,
+                     st.st_size, mtime);
+}
+
+void ParseCache::Link(const std::string& entry, const std::string& path) const {
+  auto tmp = TempName(path);
+  std::error_code ec;
+  fs::create_hard_link(entry, tmp, ec);
+  if (ec)
+    fs::copy_file(entry, tmp, ec);
+  if (!ec)
+    fs::rename(tmp, path, ec);
+  if (ec) {
+    spdlog::warn("cannot link cache entry {}: {}", path, ec.message());
+    fs::remove(tmp, ec);
+  }
+}
+
+std::unique_ptr<CachedParse> ParseCache::Find(
+    const std::string& filename) const {
+  auto path = StatPath(filename);
+  if (path.empty() || access(path.c_str(), R_OK) != 0)
+    return nullptr;
+
+  auto cached = std::make_unique<CachedParse>();
+  if (!cached->Open(path))
+    return nullptr;
+  return cached;
+}
+
+std::unique_ptr<CachedParse> ParseCache::Find(const Elf& elf) const {
+  auto path = BuildIdPath(elf);
+  if (path.empty() || access(path.c_str(), R_OK) != 0)
+    return nullptr;
+
+  auto cached = std::make_unique<CachedParse>();
+  if (!cached->Open(path))
+    return nullptr;
+
+  // a build-id is only as unique as the linker made it
+  if (cached->Sections().size() != elf.Sections().size() ||
+      cached->Columns().size() != elf.Symbols().size()) {
+    spdlog::warn("{}: cache entry {} does not match", elf.Filename(), path);
+    return nullptr;
+  }
+
+  auto stat_path = StatPath(elf.Filename());
+  if (!stat_path.empty())
+    Link(path, stat_path);
+  return cached;
+}
+
+bool ParseCache::Store(const Elf& elf) const {
+  auto stat_path = StatPath(elf.Filename());
+  auto path = BuildIdPath(elf);
+  if (path.empty())
+    path = stat_path;
+  if (path.empty())
+    return false;
+
+  std::error_code ec;
+  fs::create_directories(m_dir_, ec);
+  if (ec) {
+    spdlog::warn("cannot create cache directory {}: {}", m_dir_, ec.message());
+    return false;
+  }
+
+  auto sections = elf.Sections();
+  const auto& columns = elf.Columns();
+  const auto* section_names = elf.StrTab(elf.Header().GetShStrndx());
+  const StringTab* symbol_names = nullptr;
+  if (auto idx = elf.SymbolsSection())
+    symbol_names = elf.StrTab(sections[idx].Link());
+
+  CacheHeader header;
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.sections = sections.size();
+  header.symbols = columns.size();
+  header.section_names_size = section_names ? section_names->size() : 0;
+  header.symbol_names_size = symbol_names ? symbol_names->size() : 0;
+  CacheLayout layout(header);
+
+  auto tmp = TempName(path);
+  {
+    std::ofstream file(tmp, std::ios::binary | std::ios::trunc);
+    auto put = [&](std::uint64_t offset, const void* data, std::uint64_t size) {
+      // zero pad up to the start of the block
+      static const char kZero[8] = {};
+      file.write(kZero, offset - file.tellp());
+      file.write(static_cast<const char*>(data), size);
+    };
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    put(layout.sections, sections.data(), sections.size() * sizeof(Elf64_Shdr));
+    put(layout.value, columns.Value().data(),
+        columns.size() * sizeof(std::uint64_t));
+    put(layout.size, columns.Size().data(),
+        columns.size() * sizeof(std::uint64_t));
+    put(layout.name, columns.Name().data(),
+        columns.size() * sizeof(std::uint32_t));
+    put(layout.shndx, columns.Shndx().data(),
+        columns.size() * sizeof(std::uint16_t));
+    put(layout.info, columns.Info().data(),
+        columns.size() * sizeof(std::uint8_t));
+    if (section_names)
+      put(layout.section_names, section_names->data(), section_names->size());
+    if (symbol_names)
+      put(layout.symbol_names, symbol_names->data(), symbol_names->size());
+    put(layout.end, nullptr, 0);
+
+    if (!file) {
+      spdlog::warn("cannot write cache entry {}", tmp);
+      file.close();
+      fs::remove(tmp, ec);
+      return false;
+    }
+  }
+
+  fs::rename(tmp, path, ec);
+  if (ec) {
+    spdlog::warn("cannot store cache entry {}: {}", path, ec.message());
+    fs::remove(tmp, ec);
+    return false;
+  }
+
+  if (path != stat_path && !stat_path.empty())
+    Link(path, stat_path);
+  return true;
+}
+
+}  // namespace xorg
@@ -2,42 +2,32 @@
  * Copyright 2022 hupeng.
  * SPDX-License-Identifier: MIT
  */
-#include <spdlog/spdlog.h>
 #include <cstdint>
-#include <iomanip>
-#include <ios>
 #include <map>
-#include <sstream>
 #include <string>
+#include <string_view>
 
 #include "common.h"
 #include "elf.h"
 #include "elf_header.h"
 #include "elf_spec.h"
+#include "output.h"
 #include "program_header.h"
 
 namespace xorg {
 
-void ProgramHeader::PrintHeader() {
-  spdlog::info("Program Headers:");
+void ProgramHeader::PrintHeader(Output& out) {
+  if (!out.IsTable())
+    return;
 
-  std::stringstream ss;
-  ss << "  " << std::left << std::setw(15) << std::setfill(' ') << "Type"
-     << std::setw(19) << std::setfill(' ') << "Offset" << std::setw(19)
-     << std::setfill(' ') << "VirtAddr" << std::setw(19) << std::setfill(' ')
-     << "PhysAddr";
-  spdlog::info("{}", ss.str());
-
-  ss.str("");
-  ss << "  " << std::left << std::setw(15) << std::setfill(' ') << " "
-     << std::setw(19) << std::setfill(' ') << "FileSiz" << std::setw(20)
-     << std::setfill(' ') << "MemSiz" << std::setw(7) << std::setfill(' ')
-     << "Flags"
-     << "Align";
-  spdlog::info("{}", ss.str());
+  out.Print("Program Headers:\n");
+  out.Print("  {:<15}{:<19}{:<19}{:<19}\n", "Type", "Offset", "VirtAddr",
+            "PhysAddr");
+  out.Print("  {:<15}{:<19}{:<20}{:<7}Align\n", " ", "FileSiz", "MemSiz",
+            "Flags");
 }
 
-void ProgramHeader::Print() const {
+void ProgramHeader::Print(Output& out) const {
   static const std::map<PHType, std::string> typeMap{
       {PHType::PT_NULL, "NULL"},
       {PHType::PT_LOAD, "LOAD"},
@@ -51,45 +41,38 @@ void ProgramHeader::Print() const {
       {PHType::PT_GNU_STACK, "GNU_STACK"},
       {PHType::PT_GNU_RELRO, "GNU_RELRO"},
   };
+  static const std::string unknown("Unknown");
 
-  std::stringstream ss;
-  ss << "  " << std::left << std::setw(15) << std::setfill(' ')
-     << GetMapValWithDef(typeMap, static_cast<PHType>(p_type),
-                         std::string("Unknown"))
-     << std::setw(19) << std::setfill(' ') << GetHex(p_offset) << std::setw(19)
-     << std::setfill(' ') << GetHex(p_vaddr) << std::setw(18)
-     << std::setfill(' ') << GetHex(p_paddr);
-  spdlog::info("{}", ss.str());
-
-  ss.str("");
-  ss << "  " << std::left << std::setw(15) << std::setfill(' ') << " "
-     << std::setw(19) << std::setfill(' ') << GetHex(p_filesz) << std::setw(20)
-     << std::setfill(' ') << GetHex(p_memsz) << std::setw(7)
-     << std::setfill(' ') << GetFlags(p_flags) << GetHex(p_align, false);
-  spdlog::info("{}", ss.str());
-}
-
-std::string ProgramHeader::GetFlags(std::uint32_t flag) const {
-  std::stringstream ss;
-#define CHECKFLAG(f) (flag & static_cast<std::uint32_t>(PHFlag::f))
+  const std::string& type =
+      GetMapValWithDef(typeMap, static_cast<PHType>(p_type), unknown);
 
-  ss << (CHECKFLAG(PF_R) ? 'R' : ' ');
-  ss << (CHECKFLAG(PF_W) ? 'W' : ' ');
-  ss << (CHECKFLAG(PF_X) ? 'E' : ' ');
-
-  return ss.str();
-}
-
-std::string ProgramHeader::GetHex(std::uint64_t value, bool isAddr) const {
-  std::stringstream ss;
+#define CHECKFLAG(f) (p_flags & static_cast<std::uint32_t>(PHFlag::f))
+  const char flags[] = {
+      CHECKFLAG(PF_R) ? 'R' : ' ',
+      CHECKFLAG(PF_W) ? 'W' : ' ',
+      CHECKFLAG(PF_X) ? 'E' : ' ',
+  };
+#undef CHECKFLAG
+  std::string_view flag_view(flags, sizeof(flags));
 
-  ss << "0x";
-  if (isAddr) {
-    ss << std::right << std::setw(16) << std::setfill('0');
+  if (!out.IsTable()) {
+    out.BeginRecord();
+    out.Field("type", type);
+    out.HexField("offset", p_offset);
+    out.HexField("vaddr", p_vaddr);
+    out.HexField("paddr", p_paddr);
+    out.HexField("filesz", p_filesz);
+    out.HexField("memsz", p_memsz);
+    out.Field("flags", flag_view);
+    out.HexField("align", p_align);
+    out.EndRecord();
+    return;
   }
-  ss << std::hex << value;
 
-  return ss.str();
+  out.Print("  {:<15}0x{:016x} 0x{:016x} 0x{:016x}\n", type, p_offset,
+            p_vaddr, p_paddr);
+  out.Print("  {:<15}0x{:016x} 0x{:016x}  {:<7}0x{:x}\n", " ", p_filesz,
+            p_memsz, flag_view, p_align);
 }
 
 }  // namespace xorg
@@ -0,0 +1,118 @@
+/**
+ * Copyright 2022 hupeng.
+ * SPDX-License-Identifier: MIT
+ */
+#include "relocations.h"
+
+#include <cstdint>
+#include <map>
+#include <string_view>
+
+#include "elf_spec.h"
+#include "output.h"
+
+namespace xorg {
+
+void Relocations::Build(Span<Elf64_Rel> rel) {
+  auto count = rel.size();
+  m_offset_.resize(count);
+  m_symbol_.resize(count);
+  m_type_.resize(count);
+  m_addend_.clear();
+
+  for (std::size_t i = 0; i < count; i++) {
+    m_offset_[i] = rel[i].r_offset;
+    m_symbol_[i] = rel[i].r_info >> 32;
+    m_type_[i] = static_cast<std::uint32_t>(rel[i].r_info);
+  }
+}
+
+void Relocations::Build(Span<Elf64_Rela> rela) {
+  auto count = rela.size();
+  m_offset_.resize(count);
+  m_symbol_.resize(count);
+  m_type_.resize(count);
+  m_addend_.resize(count);
+
+  for (std::size_t i = 0; i < count; i++) {
+    m_offset_[i] = rela[i].r_offset;
+    m_symbol_[i] = rela[i].r_info >> 32;
+    m_type_[i] = static_cast<std::uint32_t>(rela[i].r_info);
+    m_addend_[i] = rela[i].r_addend;
+  }
+}
+
+void Relocations::CountTypes(
+    std::map<std::uint32_t, std::uint64_t>* counts) const {
+  // every machine keeps its common types small, count those in an array and
+  // only go to the map for the rest
+  std::uint64_t small[256] = {};
+  for (auto type : m_type_) {
+    if (type < std::size(small)) {
+      small[type]++;
+    } else {
+      (*counts)[type]++;
+    }
+  }
+
+  for (std::uint32_t type = 0; type < std::size(small); type++) {
+    if (small[type] != 0)
+      (*counts)[type] += small[type];
+  }
+}
+
+void Relocations::PrintHeader(Output& out,
+                              std::string_view section,
+                              std::uint64_t offset,
+                              std::size_t size) {
+  if (!out.IsTable())
+    return;
+
+  out.Print("Relocation section '{}' at offset {:#x} contains {} entries:\n",
+            section, offset, size);
+  out.Print("  Offset          Info           Type{:<15}Sym. Value    "
+            "Sym. Name + Addend\n",
+            "");
+}
+
+void Relocations::Print(Output& out,
+                        std::string_view section,
+                        std::size_t row,
+                        std::string_view type,
+                        std::uint64_t symbol_value,
+                        std::string_view symbol_name) const {
+  std::uint64_t info =
+      (static_cast<std::uint64_t>(m_symbol_[row]) << 32) | m_type_[row];
+  std::int64_t addend = HasAddends() ? m_addend_[row] : 0;
+
+  if (!out.IsTable()) {
+    out.BeginRecord();
+    out.Field("section", section);
+    out.HexField("offset", m_offset_[row]);
+    out.Field("type", type);
+    out.Field("symbol", m_symbol_[row]);
+    out.HexField("symbol_value", symbol_value);
+    out.Field("symbol_name", symbol_name);
+    out.SignedField("addend", addend);
+    out.EndRecord();
+    return;
+  }
+
+  if (m_symbol_[row] == 0) {
+    out.Print("{:012x}  {:012x} {:<22}{:>16x}\n", m_offset_[row], info, type,
+              addend);
+    return;
+  }
+
+  out.Print("{:012x}  {:012x} {:<18} {:016x} {}", m_offset_[row], info, type,
+            symbol_value, symbol_name);
+  if (!HasAddends()) {
+    out.Print("\n");
+  } else if (addend < 0) {
+    out.Print(" - {:x}\n", -static_cast<std::uint64_t>(addend));
+  } else {
+    out.Print(" + {:x}\n", addend);
+  }
+}
+
+}  // namespace xorg
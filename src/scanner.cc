@@ -0,0 +1,154 @@
+/**
+ * Copyright 2022 hupeng.
+ * SPDX-License-Identifier: MIT
+ */
+#include "scanner.h"
+
+#include <fcntl.h>
+#include <glob.h>
+#include <spdlog/spdlog.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <system_error>
+
+#include "arena.h"
+#include "elf.h"
+#include "thread_pool.h"
+
+namespace xorg {
+
+namespace fs = std::filesystem;
+
+void Scanner::Add(const std::string& input) {
+  if (input.size() > 1 && input[0] == '@') {
+    std::ifstream list(input.substr(1));
+    if (!list) {
+      spdlog::error("cannot read file list {}", input.substr(1));
+      return;
+    }
+    std::string line;
+    while (std::getline(list, line)) {
+      if (!line.empty())
+        Add(line);
+    }
+    return;
+  }
+
+  if (input.find_first_of("*?[") != std::string::npos) {
+    glob_t matches;
+    if (glob(input.c_str(), 0, nullptr, &matches) == 0) {
+      for (std::size_t i = 0; i < matches.gl_pathc; i++) {
+        AddPath(matches.gl_pathv[i]);
+      }
+    }
+    globfree(&matches);
+    return;
+  }
+
+  AddPath(input);
+}
+
+void Scanner::AddPath(const std::string& path) {
+  // a symlink named as an input is followed
+  std::error_code ec;
+  auto status = fs::status(path, ec);
+  if (ec) {
+    spdlog::warn("{}: {}", path, ec.message());
+    return;
+  }
+
+  if (fs::is_regular_file(status)) {
+    m_paths_.push_back(path);
+    return;
+  }
+  if (!fs::is_directory(status)) {
+    spdlog::warn("{}: not a file or directory", path);
+    return;
+  }
+
+  // symlinks inside it are not followed, a tree can link into itself
+  auto options = fs::directory_options::skip_permission_denied;
+  for (fs::recursive_directory_iterator it(path, options, ec), end;
+       !ec && it != end; it.increment(ec)) {
+    if (it->is_regular_file(ec) && !it->is_symlink(ec))
+      m_paths_.push_back(it->path().string());
+  }
+}
+
+bool Scanner::IsElf(const std::string& path) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return false;
+
+  static const char kMagic[] = {0x7f, 'E', 'L', 'F'};
+  char magic[sizeof(kMagic)];
+  bool elf = pread(fd, magic, sizeof(magic), 0) == sizeof(magic) &&
+             std::memcmp(magic, kMagic, sizeof(magic)) == 0;
+  close(fd);
+  return elf;
+}
+
+ScanResult Scanner::ScanOne(const std::string& path, Arena& arena) {
+  ScanResult result;
+  result.path = path;
+
+  Elf elf(path, &arena);
+  if (!elf.Parse())
+    return result;
+
+  result.ok = true;
+  result.type = elf.Header().TypeName();
+  result.machine = elf.Header().MachineName();
+  result.segments = elf.Segments().size();
+  result.sections = elf.Sections().size();
+  result.symbols = elf.Symbols().size();
+  result.parse_bytes = arena.Used();
+  return result;
+}
+
+std::vector<std::string> Scanner::Paths() const {
+  auto paths = m_paths_;
+  std::sort(paths.begin(), paths.end());
+  paths.erase(std::unique(paths.begin(), paths.end()), paths.end());
+  return paths;
+}
+
+std::vector<ScanResult> Scanner::Run() const {
+  auto paths = Paths();
+
+  // every task owns one slot, no locking needed for the results
+  std::vector<ScanResult> results(paths.size());
+  std::vector<char> is_elf(paths.size(), false);
+  {
+    ThreadPool pool(m_jobs_);
+    for (std::size_t i = 0; i < paths.size(); i++) {
+      pool.Submit([&, i] {
+        if (!IsElf(paths[i]))
+          return;
+        // one per worker, grown to the largest parse it has seen
+        static thread_local Arena arena;
+        is_elf[i] = true;
+        results[i] = ScanOne(paths[i], arena);
+        arena.Reset();
+      });
+    }
+    pool.Wait();
+  }
+
+  std::size_t count = 0;
+  for (std::size_t i = 0; i < results.size(); i++) {
+    if (!is_elf[i])
+      continue;
+    if (count != i)
+      results[count] = std::move(results[i]);
+    count++;
+  }
+  results.resize(count);
+  return results;
+}
+
+}  // namespace xorg
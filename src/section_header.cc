@@ -5,63 +5,56 @@
 #include "section_header.h"
 
 #include <bits/stdint-uintn.h>
-#include <spdlog/spdlog.h>
-#include <iomanip>
-#include <ios>
 #include <map>
-#include <sstream>
 #include <string>
+#include <utility>
 #include "common.h"
 #include "elf_spec.h"
+#include "output.h"
 
 namespace xorg {
 
-void SectionHeader::PrintHeader() {
-  spdlog::info("Section Headers:");
+void SectionHeader::PrintHeader(Output& out) {
+  if (!out.IsTable())
+    return;
 
-  std::stringstream ss;
-  ss << std::right << std::setw(6) << std::setfill(' ') << "[Nr]"
-     << " " << std::left << std::setw(17) << std::setfill(' ') << "Name"
-     << " " << std::setw(16) << std::setfill(' ') << "Type"
-     << " " << std::setw(16) << std::setfill(' ') << "Address"
-     << "  "
-     << "Offset";
-  spdlog::info("{}", ss.str());
-
-  ss.str("");
-  ss << std::left << std::setw(6) << std::setfill(' ') << " "
-     << " " << std::setw(16) << std::setfill(' ') << "Size"
-     << "  " << std::setw(16) << std::setfill(' ') << "EntSize"
-     << " " << std::setw(5) << std::setfill(' ') << "Flags"
-     << "  " << std::setw(4) << std::setfill(' ') << "Link"
-     << "  " << std::setw(4) << std::setfill(' ') << "Info"
-     << "  "
-     << "Align";
-  spdlog::info("{}", ss.str());
+  out.Print("Section Headers:\n");
+  out.Print("{:>6} {:<17} {:<16} {:<16}  Offset\n", "[Nr]", "Name", "Type",
+            "Address");
+  out.Print("{:<6} {:<16}  {:<16} {:<5}  {:<4}  {:<4}  Align\n", " ", "Size",
+            "EntSize", "Flags", "Link", "Info");
 }
 
-void SectionHeader::Print() const {
-  std::stringstream ss;
-  ss << "  [" << std::right << std::setw(2) << std::setfill(' ') << m_idx_
-     << "]"
-     << " " << std::left << std::setw(17) << std::setfill(' ') << m_name_ << " "
-     << std::setw(16) << std::setfill(' ') << m_type_str_ << " " << std::right
-     << std::setw(16) << std::setfill('0') << std::hex << sh_addr << "  "
-     << std::setw(8) << std::setfill('0') << std::hex << sh_offset;
-  spdlog::info("{}", ss.str());
+void SectionHeader::Print(Output& out,
+                          std::uint16_t idx,
+                          std::string_view name) const {
+  char buf[kFlagCount];
+  std::string_view flags = GetFlags(buf);
+
+  if (!out.IsTable()) {
+    out.BeginRecord();
+    out.Field("idx", idx);
+    out.Field("name", name);
+    out.Field("type", TypeName());
+    out.HexField("addr", sh_addr);
+    out.HexField("offset", sh_offset);
+    out.HexField("size", sh_size);
+    out.HexField("entsize", sh_entsize);
+    out.Field("flags", flags);
+    out.Field("link", sh_link);
+    out.Field("info", sh_info);
+    out.Field("align", sh_addralign);
+    out.EndRecord();
+    return;
+  }
 
-  ss.str("");
-  ss << std::setw(6) << std::setfill(' ') << " "
-     << " " << std::right << std::setw(16) << std::setfill('0') << std::hex
-     << sh_size << "  " << std::setw(16) << std::setfill('0') << std::hex
-     << sh_entsize << " " << std::setw(3) << std::setfill(' ') << GetFlags()
-     << "    " << std::setw(4) << std::setfill(' ') << std::dec << sh_link
-     << "  " << std::setw(4) << std::setfill(' ') << sh_info << "     "
-     << sh_addralign;
-  spdlog::info("{}", ss.str());
+  out.Print("  [{:>2}] {:<17} {:<16} {:016x}  {:08x}\n", idx, name,
+            TypeName(), sh_addr, sh_offset);
+  out.Print("{:6} {:016x}  {:016x} {:>3}    {:>4}  {:>4}     {}\n", " ",
+            sh_size, sh_entsize, flags, sh_link, sh_info, sh_addralign);
 }
 
-void SectionHeader::ParseType() {
+const std::string& SectionHeader::TypeName() const {
   static const std::map<SHType, std::string> typeMap{
       {SHType::SHT_NULL, "NULL"},
       {SHType::SHT_PROGBITS, "PROGBITS"},
@@ -72,7 +65,7 @@ void SectionHeader::ParseType() {
       {SHType::SHT_DYNAMIC, "DYNAMIC"},
       {SHType::SHT_NOTE, "NOTE"},
       {SHType::SHT_NOBITS, "NOBITS"},
-      {SHType::SHT_REL, "RELA"},
+      {SHType::SHT_REL, "REL"},
       {SHType::SHT_SHLIB, "SHLIB"},
       {SHType::SHT_DYNSYM, "DYNSYM"},
       {SHType::SHT_INIT_ARRAY, "INIT_ARRAY"},
@@ -89,37 +82,25 @@ void SectionHeader::ParseType() {
       {SHType::SHT_GNU_VERSYM, "GNU_VERSYM"},
   };
 
-  m_type_str_ = GetMapValWithDef(typeMap, static_cast<SHType>(sh_type),
-                                 std::string("Unknown Type"));
+  static const std::string unknown("Unknown Type");
+  return GetMapValWithDef(typeMap, static_cast<SHType>(sh_type), unknown);
 }
 
-const std::string SectionHeader::GetFlags() const {
-  std::stringstream ss;
-  if (sh_flags & static_cast<uint64_t>(SHFlags::SHF_WRITE))
-    ss << "W";
-  if (sh_flags & static_cast<uint64_t>(SHFlags::SHF_ALLOC))
-    ss << "A";
-  if (sh_flags & static_cast<uint64_t>(SHFlags::SHF_EXECINSTR))
-    ss << "X";
-  if (sh_flags & static_cast<uint64_t>(SHFlags::SHF_MERGE))
-    ss << "M";
-  if (sh_flags & static_cast<uint64_t>(SHFlags::SHF_STRINGS))
-    ss << "S";
-  if (sh_flags & static_cast<uint64_t>(SHFlags::SHF_INFO_LINK))
-    ss << "I";
-  if (sh_flags & static_cast<uint64_t>(SHFlags::SHF_LINK_ORDER))
-    ss << "L";
-  if (sh_flags & static_cast<uint64_t>(SHFlags::SHF_OS_NONCONFORMING))
-    ss << "O";
-  if (sh_flags & static_cast<uint64_t>(SHFlags::SHF_GROUP))
-    ss << "G";
-  if (sh_flags & static_cast<uint64_t>(SHFlags::SHF_TLS))
-    ss << "T";
-  if (sh_flags & static_cast<uint64_t>(SHFlags::SHF_COMPRESSED))
-    ss << "C";
-  if (sh_flags & static_cast<uint64_t>(SHFlags::SHF_EXCLUDE))
-    ss << "E";
+std::string_view SectionHeader::GetFlags(char* buf) const {
+  static const std::pair<SHFlags, char> kLetters[kFlagCount] = {
+      {SHFlags::SHF_WRITE, 'W'},      {SHFlags::SHF_ALLOC, 'A'},
+      {SHFlags::SHF_EXECINSTR, 'X'},  {SHFlags::SHF_MERGE, 'M'},
+      {SHFlags::SHF_STRINGS, 'S'},    {SHFlags::SHF_INFO_LINK, 'I'},
+      {SHFlags::SHF_LINK_ORDER, 'L'}, {SHFlags::SHF_OS_NONCONFORMING, 'O'},
+      {SHFlags::SHF_GROUP, 'G'},      {SHFlags::SHF_TLS, 'T'},
+      {SHFlags::SHF_COMPRESSED, 'C'}, {SHFlags::SHF_EXCLUDE, 'E'},
+  };
 
-  return ss.str();
+  std::size_t len = 0;
+  for (const auto& [flag, letter] : kLetters) {
+    if (sh_flags & static_cast<uint64_t>(flag))
+      buf[len++] = letter;
+  }
+  return std::string_view(buf, len);
 }
 }  // namespace xorg
@@ -0,0 +1,185 @@
+/**
+ * Copyright 2022 hupeng.
+ * SPDX-License-Identifier: MIT
+ */
+#include "stream_file.h"
+
+#include <fcntl.h>
+#include <spdlog/spdlog.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace xorg {
+
+static const std::uint64_t kChunkSize = 64 * 1024;
+
+StreamFile::~StreamFile() {
+  Close();
+}
+
+bool StreamFile::Open(const std::string& filename) {
+  Close();
+
+  if (filename == "-") {
+    m_fd_ = STDIN_FILENO;
+    m_owned_ = false;
+  } else {
+    m_fd_ = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    m_owned_ = true;
+  }
+
+  if (m_fd_ < 0) {
+    spdlog::error("open {} failed: {}", filename, std::strerror(errno));
+    return false;
+  }
+  return true;
+}
+
+void StreamFile::Close() {
+  if (m_owned_ && m_fd_ >= 0)
+    close(m_fd_);
+  DropSpill();
+
+  m_fd_ = -1;
+  m_owned_ = false;
+  m_pos_ = 0;
+  m_regions_.clear();
+}
+
+void StreamFile::DropSpill() {
+  if (m_spill_ != nullptr)
+    std::fclose(m_spill_);
+  m_spill_ = nullptr;
+  m_spill_begin_ = m_spill_end_ = 0;
+}
+
+bool StreamFile::Fetchable(std::uint64_t offset, std::uint64_t length) const {
+  if (Data(offset, length) != nullptr)
+    return true;
+  if (length > m_spill_limit_)
+    return false;
+  if (offset >= m_pos_)
+    return true;
+  auto behind = std::min(length, m_pos_ - offset);
+  return m_spill_ != nullptr && offset >= m_spill_begin_ &&
+         offset + behind <= m_spill_end_;
+}
+
+bool StreamFile::Fetch(std::uint64_t offset, std::uint64_t length) {
+  if (Data(offset, length) != nullptr)
+    return true;
+
+  // lengths come from untrusted headers, never hold more than we would spill
+  if (length > m_spill_limit_) {
+    spdlog::error("stream region [{:#x}, +{:#x}) is over the {:#x} byte limit",
+                  offset, length, m_spill_limit_);
+    return false;
+  }
+  std::vector<char> region(length);
+  std::uint64_t done = 0;
+
+  // head of the region is behind us, it can only come from the spill file
+  if (offset < m_pos_) {
+    done = std::min(length, m_pos_ - offset);
+    if (m_spill_ == nullptr || offset < m_spill_begin_ ||
+        offset + done > m_spill_end_) {
+      spdlog::error("stream offset {:#x} was not kept", offset);
+      return false;
+    }
+    // pread() bypasses stdio buffering
+    std::fflush(m_spill_);
+    auto n = pread(fileno(m_spill_), region.data(), done,
+                   offset - m_spill_begin_);
+    if (n != static_cast<ssize_t>(done)) {
+      spdlog::error("read spill file failed: {}", std::strerror(errno));
+      return false;
+    }
+  }
+
+  if (done < length) {
+    if (!Skip(offset + done - m_pos_) || !Read(&region[done], length - done))
+      return false;
+  }
+
+  m_regions_[offset] = std::move(region);
+  return true;
+}
+
+const char* StreamFile::Data(std::uint64_t offset,
+                             std::uint64_t length) const {
+  auto it = m_regions_.upper_bound(offset);
+  if (it == m_regions_.begin())
+    return nullptr;
+
+  --it;
+  std::uint64_t skip = offset - it->first;
+  if (skip > it->second.size() || length > it->second.size() - skip)
+    return nullptr;
+  return it->second.data() + skip;
+}
+
+bool StreamFile::Read(char* buf, std::uint64_t length) {
+  std::uint64_t done = 0;
+  while (done < length) {
+    ssize_t n = read(m_fd_, buf + done, length - done);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0) {
+      spdlog::error("unexpected end of stream at offset {:#x}", m_pos_ + done);
+      return false;
+    }
+    done += n;
+  }
+
+  m_pos_ += length;
+  return Spill(buf, length);
+}
+
+bool StreamFile::Skip(std::uint64_t length) {
+  char buf[kChunkSize];
+  while (length > 0) {
+    auto n = std::min(length, kChunkSize);
+    if (!Read(buf, n))
+      return false;
+    length -= n;
+  }
+  return true;
+}
+
+bool StreamFile::Spill(const char* buf, std::uint64_t length) {
+  if (!m_spill_on_)
+    return true;
+
+  if (m_spill_ == nullptr) {
+    m_spill_ = std::tmpfile();
+    if (m_spill_ == nullptr) {
+      spdlog::error("create spill file failed: {}", std::strerror(errno));
+      return false;
+    }
+    m_spill_begin_ = m_spill_end_ = m_pos_ - length;
+  }
+
+  // the spill file has to stay contiguous
+  if (m_spill_end_ != m_pos_ - length) {
+    spdlog::error("spill file would have a gap at {:#x}", m_spill_end_);
+    return false;
+  }
+  if (m_spill_end_ - m_spill_begin_ + length > m_spill_limit_) {
+    spdlog::warn("stream: {} bytes spilled, bytes from offset {:#x} on are "
+                 "not kept",
+                 m_spill_end_ - m_spill_begin_, m_spill_end_);
+    m_spill_on_ = false;
+    return true;
+  }
+
+  if (std::fwrite(buf, 1, length, m_spill_) != length) {
+    spdlog::error("write spill file failed: {}", std::strerror(errno));
+    return false;
+  }
+  m_spill_end_ += length;
+  return true;
+}
+
+}  // namespace xorg
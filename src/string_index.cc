@@ -0,0 +1,204 @@
+/**
+ * Copyright 2022 hupeng.
+ * SPDX-License-Identifier: MIT
+ */
+#include "string_index.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+#include "elf.h"
+#include "elf_range.h"
+
+namespace xorg {
+
+// bytes a vector pass looks at per iteration, and so the most starts it can
+// add at once
+static const std::size_t kBlock = 64;
+
+// Appends the start following every NUL of `mask`, bit i standing for the
+// byte at `base + i`. `out` has room for 64 more.
+static inline std::uint32_t* Starts(std::uint64_t mask,
+                                    std::uint64_t base,
+                                    std::uint32_t* out) {
+  while (mask != 0) {
+    *out++ = static_cast<std::uint32_t>(base + __builtin_ctzll(mask) + 1);
+    mask &= mask - 1;
+  }
+  return out;
+}
+
+#if defined(__x86_64__)
+
+// SSE2 is part of x86-64, four 16 byte compares per block.
+static std::uint64_t ScanSse2(const char* data,
+                              std::uint64_t size,
+                              std::vector<std::uint32_t>* starts,
+                              std::size_t* count) {
+  const __m128i zero = _mm_setzero_si128();
+  std::uint64_t pos = 0;
+  for (; size - pos >= kBlock; pos += kBlock) {
+    if (starts->size() - *count < kBlock)
+      starts->resize(starts->size() * 2);
+
+    const auto* in = reinterpret_cast<const __m128i*>(data + pos);
+    std::uint64_t mask = 0;
+    for (int i = 0; i < 4; i++) {
+      auto eq = _mm_cmpeq_epi8(_mm_loadu_si128(in + i), zero);
+      mask |= static_cast<std::uint64_t>(
+                  static_cast<std::uint16_t>(_mm_movemask_epi8(eq)))
+              << (16 * i);
+    }
+    *count = Starts(mask, pos, starts->data() + *count) - starts->data();
+  }
+  return pos;
+}
+
+__attribute__((target("avx2"))) static std::uint64_t ScanAvx2(
+    const char* data,
+    std::uint64_t size,
+    std::vector<std::uint32_t>* starts,
+    std::size_t* count) {
+  const __m256i zero = _mm256_setzero_si256();
+  std::uint64_t pos = 0;
+  for (; size - pos >= kBlock; pos += kBlock) {
+    if (starts->size() - *count < kBlock)
+      starts->resize(starts->size() * 2);
+
+    const auto* in = reinterpret_cast<const __m256i*>(data + pos);
+    auto lo = _mm256_cmpeq_epi8(_mm256_loadu_si256(in), zero);
+    auto hi = _mm256_cmpeq_epi8(_mm256_loadu_si256(in + 1), zero);
+    std::uint64_t mask =
+        static_cast<std::uint32_t>(_mm256_movemask_epi8(lo)) |
+        static_cast<std::uint64_t>(
+            static_cast<std::uint32_t>(_mm256_movemask_epi8(hi)))
+            << 32;
+    *count = Starts(mask, pos, starts->data() + *count) - starts->data();
+  }
+  return pos;
+}
+
+#endif
+
+void StringIndex::Build(const StringTab& strtab) {
+  m_data_ = strtab.data();
+  m_size_ = std::min<std::uint64_t>(strtab.size(), UINT32_MAX);
+  m_starts_.clear();
+  if (m_size_ == 0) {
+    m_terminated_ = 0;
+    return;
+  }
+
+  // written through a pointer and grown ahead of each block, the size is
+  // set to what was found at the end
+  m_starts_.resize(std::max<std::size_t>(m_size_ / 16, kBlock) + 1);
+  m_starts_[0] = 0;
+  std::size_t count = 1;
+
+  std::uint64_t pos = 0;
+#if defined(__x86_64__)
+  static const bool has_avx2 = __builtin_cpu_supports("avx2");
+  if (has_avx2)
+    pos = ScanAvx2(m_data_, m_size_, &m_starts_, &count);
+  else
+    pos = ScanSse2(m_data_, m_size_, &m_starts_, &count);
+#endif
+
+  m_starts_.resize(count);
+  while (pos < m_size_) {
+    const void* nul = std::memchr(m_data_ + pos, '\0', m_size_ - pos);
+    if (nul == nullptr)
+      break;
+    pos = static_cast<const char*>(nul) - m_data_ + 1;
+    m_starts_.push_back(static_cast<std::uint32_t>(pos));
+  }
+
+  // the start after the final NUL is the end of the table, not a string
+  m_terminated_ = m_starts_.back();
+  if (m_starts_.back() == m_size_)
+    m_starts_.pop_back();
+}
+
+StringIndex::Entry StringIndex::At(std::size_t idx) const {
+  std::uint64_t begin = m_starts_[idx];
+  std::uint64_t end = m_size_;
+  if (idx + 1 < m_starts_.size())
+    end = m_starts_[idx + 1] - 1;
+  else if (begin < m_terminated_)
+    end = m_terminated_ - 1;
+  return {m_starts_[idx], std::string_view(m_data_ + begin, end - begin)};
+}
+
+NameOffset StringIndex::Check(std::uint32_t offset) const {
+  if (offset >= m_terminated_)
+    return NameOffset::kInvalid;
+  return std::binary_search(m_starts_.begin(), m_starts_.end(), offset)
+             ? NameOffset::kStart
+             : NameOffset::kSuffix;
+}
+
+void NameOffsetReport::Build(const Elf& elf) {
+  m_tables_.clear();
+
+  std::vector<std::uint32_t> names;
+  for (auto section : SectionRange(elf)) {
+    names.push_back(section.header.NameValue());
+  }
+  Add("<section headers>", elf.StrTab(elf.Header().GetShStrndx()), names);
+
+  for (auto section : SectionRange(elf)) {
+    SymbolRange symbols(elf, section.index);
+    if (symbols.size() == 0)
+      continue;
+
+    names.clear();
+    for (auto entry : symbols) {
+      names.push_back(entry.symbol.Name());
+    }
+    Add(section.name, elf.StrTab(section.header.Link()), names);
+  }
+}
+
+void NameOffsetReport::Add(std::string_view section,
+                           const StringTab* strtab,
+                           const std::vector<std::uint32_t>& names) {
+  StringIndex index;
+  if (strtab != nullptr)
+    index.Build(*strtab);
+
+  Table table;
+  table.section = section;
+  table.strings = index.size();
+  for (auto name : names) {
+    table.counts[static_cast<int>(index.Check(name))]++;
+  }
+  m_tables_.push_back(table);
+}
+
+void NameOffsetReport::Print(Output& out) const {
+  for (const auto& table : m_tables_) {
+    const auto* counts = table.counts;
+    if (out.IsTable()) {
+      out.Print("{:<20} {:>8} strings {:>8} starts {:>8} suffixes {:>8} "
+                "invalid\n",
+                table.section, table.strings, counts[0], counts[1],
+                counts[2]);
+      continue;
+    }
+    out.BeginRecord();
+    out.Field("section", table.section);
+    out.Field("strings", table.strings);
+    out.Field("starts", counts[0]);
+    out.Field("suffixes", counts[1]);
+    out.Field("invalid", counts[2]);
+    out.EndRecord();
+  }
+}
+
+}  // namespace xorg
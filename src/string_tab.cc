@@ -4,27 +4,29 @@
  */
 #include "string_tab.h"
 
-#include <spdlog/spdlog.h>
 #include <cstdint>
-#include <iomanip>
-#include <ios>
-#include <sstream>
-#include <string>
+
+#include "output.h"
+#include "string_index.h"
 
 namespace xorg {
 
-void StringTab::Print() const {
-  spdlog::info("String dump of section :");
+void StringTab::Print(Output& out) const {
+  if (out.IsTable())
+    out.Print("String dump of section :\n");
 
-  std::stringstream ss;
-  auto idx = 0;
-  while (idx < size()) {
-    std::string str((char*)&((*this)[idx]));
-    ss.str("");
-    ss << "  [" << std::right << std::setw(6) << std::setfill(' ') << std::hex
-       << idx << "]  " << str;
-    spdlog::info("{}", ss.str());
-    idx += (str.length() + 1);
+  StringIndex index;
+  index.Build(*this);
+  for (const auto& entry : index) {
+    if (out.IsTable()) {
+      out.Print("  [{:>6x}]  {}\n", entry.offset, entry.str);
+    } else {
+      out.BeginRecord();
+      out.Field("section", m_idx_);
+      out.HexField("offset", entry.offset);
+      out.Field("string", entry.str);
+      out.EndRecord();
+    }
   }
 }
 
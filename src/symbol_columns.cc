@@ -0,0 +1,211 @@
+/**
+ * Copyright 2022 hupeng.
+ * SPDX-License-Identifier: MIT
+ */
+#include "symbol_columns.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+#include <cstdint>
+#include <vector>
+
+namespace xorg {
+
+SymbolFilter& SymbolFilter::Type(STType type) {
+  info_mask |= 0x0f;
+  info_value = (info_value & 0xf0) | static_cast<std::uint8_t>(type);
+  return *this;
+}
+
+SymbolFilter& SymbolFilter::Bind(STBind bind) {
+  info_mask |= 0xf0;
+  info_value = (info_value & 0x0f) | (static_cast<std::uint8_t>(bind) << 4);
+  return *this;
+}
+
+SymbolFilter& SymbolFilter::Section(std::uint16_t idx) {
+  match_shndx = true;
+  shndx = idx;
+  return *this;
+}
+
+SymbolFilter& SymbolFilter::SizeRange(std::uint64_t min, std::uint64_t max) {
+  min_size = min;
+  max_size = max;
+  return *this;
+}
+
+SymbolFilter& SymbolFilter::ValueRange(std::uint64_t min, std::uint64_t max) {
+  min_value = min;
+  max_value = max;
+  return *this;
+}
+
+void SymbolColumns::Build(Span<SymbolTab> symbols) {
+  auto count = symbols.size();
+  m_value_data_.resize(count);
+  m_size_data_.resize(count);
+  m_info_data_.resize(count);
+  m_shndx_data_.resize(count);
+  m_name_data_.resize(count);
+
+  for (std::size_t i = 0; i < count; i++) {
+    const auto& symbol = symbols[i];
+    m_value_data_[i] = symbol.Value();
+    m_size_data_[i] = symbol.Size();
+    m_info_data_[i] = symbol.Info();
+    m_shndx_data_[i] = symbol.Shndx();
+    m_name_data_[i] = symbol.Name();
+  }
+
+  m_value_ = Span<std::uint64_t>(m_value_data_.data(), count);
+  m_size_ = Span<std::uint64_t>(m_size_data_.data(), count);
+  m_info_ = Span<std::uint8_t>(m_info_data_.data(), count);
+  m_shndx_ = Span<std::uint16_t>(m_shndx_data_.data(), count);
+  m_name_ = Span<std::uint32_t>(m_name_data_.data(), count);
+}
+
+void SymbolColumns::Attach(std::size_t count,
+                           const std::uint64_t* value,
+                           const std::uint64_t* size,
+                           const std::uint8_t* info,
+                           const std::uint16_t* shndx,
+                           const std::uint32_t* name) {
+  m_value_data_.clear();
+  m_size_data_.clear();
+  m_info_data_.clear();
+  m_shndx_data_.clear();
+  m_name_data_.clear();
+
+  m_value_ = Span<std::uint64_t>(value, count);
+  m_size_ = Span<std::uint64_t>(size, count);
+  m_info_ = Span<std::uint8_t>(info, count);
+  m_shndx_ = Span<std::uint16_t>(shndx, count);
+  m_name_ = Span<std::uint32_t>(name, count);
+}
+
+std::vector<std::uint32_t> SymbolColumns::Select(
+    const SymbolFilter& filter) const {
+  std::vector<std::uint32_t> result(size());
+  std::size_t begin = 0;
+  std::size_t count = 0;
+
+#if defined(__x86_64__)
+  static const bool has_avx2 = __builtin_cpu_supports("avx2");
+  if (has_avx2) {
+    count = SelectAvx2(filter, result.data());
+    begin = size() & ~static_cast<std::size_t>(31);
+  }
+#endif
+
+  count += SelectScalar(filter, begin, result.data() + count);
+  result.resize(count);
+  return result;
+}
+
+// Branch free, so that the compiler can vectorize it for the baseline ISA.
+std::size_t SymbolColumns::SelectScalar(const SymbolFilter& filter,
+                                        std::size_t begin,
+                                        std::uint32_t* out) const {
+  // x in [min, max] <=> x - min <= max - min, in unsigned arithmetic
+  const std::uint64_t size_span = filter.max_size - filter.min_size;
+  const std::uint64_t value_span = filter.max_value - filter.min_value;
+
+  std::size_t count = 0;
+  for (std::size_t i = begin; i < size(); i++) {
+    bool match = ((m_info_[i] & filter.info_mask) == filter.info_value) &
+                 (!filter.match_shndx | (m_shndx_[i] == filter.shndx)) &
+                 (m_size_[i] - filter.min_size <= size_span) &
+                 (m_value_[i] - filter.min_value <= value_span);
+    out[count] = i;
+    count += match;
+  }
+  return count;
+}
+
+#if defined(__x86_64__)
+
+// One bit per element of p[0..32) that lies outside [min, min + span], all
+// compares are done on sign flipped values as AVX2 only has signed ones.
+__attribute__((target("avx2"))) static std::uint32_t OutOfRange32(
+    const std::uint64_t* p,
+    __m256i min,
+    __m256i span) {
+  const __m256i sign = _mm256_set1_epi64x(INT64_MIN);
+
+  std::uint32_t mask = 0;
+  for (int j = 0; j < 8; j++) {
+    __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 4 * j));
+    x = _mm256_xor_si256(_mm256_sub_epi64(x, min), sign);
+    __m256i gt = _mm256_cmpgt_epi64(x, span);
+    mask |= static_cast<std::uint32_t>(
+                _mm256_movemask_pd(_mm256_castsi256_pd(gt)))
+            << (4 * j);
+  }
+  return mask;
+}
+
+// Matches 32 symbols per iteration and leaves the tail to SelectScalar().
+__attribute__((target("avx2"))) std::size_t SymbolColumns::SelectAvx2(
+    const SymbolFilter& filter,
+    std::uint32_t* out) const {
+  const std::size_t blocks = size() / 32;
+
+  const __m256i info_mask = _mm256_set1_epi8(filter.info_mask);
+  const __m256i info_value = _mm256_set1_epi8(filter.info_value);
+  const __m256i shndx = _mm256_set1_epi16(filter.shndx);
+
+  const bool check_size = filter.min_size != 0 || filter.max_size != UINT64_MAX;
+  const __m256i min_size = _mm256_set1_epi64x(filter.min_size);
+  const __m256i size_span =
+      _mm256_set1_epi64x((filter.max_size - filter.min_size) ^ INT64_MIN);
+
+  const bool check_value =
+      filter.min_value != 0 || filter.max_value != UINT64_MAX;
+  const __m256i min_value = _mm256_set1_epi64x(filter.min_value);
+  const __m256i value_span =
+      _mm256_set1_epi64x((filter.max_value - filter.min_value) ^ INT64_MIN);
+
+  std::size_t count = 0;
+  for (std::size_t b = 0; b < blocks; b++) {
+    const std::size_t base = b * 32;
+
+    __m256i info = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(m_info_.data() + base));
+    std::uint32_t mask = _mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(_mm256_and_si256(info, info_mask), info_value));
+
+    if (filter.match_shndx && mask != 0) {
+      const auto* p = reinterpret_cast<const __m256i*>(m_shndx_.data() + base);
+      __m256i lo = _mm256_cmpeq_epi16(_mm256_loadu_si256(p), shndx);
+      __m256i hi = _mm256_cmpeq_epi16(_mm256_loadu_si256(p + 1), shndx);
+      // packs works per 128-bit lane, restore element order afterwards
+      __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi16(lo, hi),
+                                                0xd8);
+      mask &= _mm256_movemask_epi8(packed);
+    }
+
+    if (check_size && mask != 0)
+      mask &= ~OutOfRange32(m_size_.data() + base, min_size, size_span);
+    if (check_value && mask != 0)
+      mask &= ~OutOfRange32(m_value_.data() + base, min_value, value_span);
+
+    while (mask != 0) {
+      out[count++] = base + __builtin_ctz(mask);
+      mask &= mask - 1;
+    }
+  }
+  return count;
+}
+
+#else
+
+std::size_t SymbolColumns::SelectAvx2(const SymbolFilter& filter,
+                                      std::uint32_t* out) const {
+  return 0;
+}
+
+#endif
+
+}  // namespace xorg
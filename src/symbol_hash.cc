@@ -0,0 +1,149 @@
+/**
+ * Copyright 2022 hupeng.
+ * SPDX-License-Identifier: MIT
+ */
+#include "symbol_hash.h"
+
+#include <cstdint>
+#include <string_view>
+
+namespace xorg {
+
+std::uint32_t SymbolHash::GnuHash(std::string_view name) {
+  std::uint32_t h = 5381;
+  for (unsigned char c : name) {
+    h = (h << 5) + h + c;
+  }
+  return h;
+}
+
+std::uint32_t SymbolHash::SysvHash(std::string_view name) {
+  std::uint32_t h = 0;
+  for (unsigned char c : name) {
+    h = (h << 4) + c;
+    std::uint32_t g = h & 0xf0000000;
+    if (g != 0)
+      h ^= g >> 24;
+    h &= ~g;
+  }
+  return h;
+}
+
+bool SymbolHash::Init(SHType type, Span<char> data) {
+  m_type_ = type;
+  switch (type) {
+    case SHType::SHT_GNU_HASH:
+      return InitGnu(data);
+    case SHType::SHT_HASH:
+      return InitSysv(data);
+    default:
+      return false;
+  }
+}
+
+// nbuckets, symoffset, bloom_size, bloom_shift, bloom[bloom_size],
+// buckets[nbuckets], chain[]
+bool SymbolHash::InitGnu(Span<char> data) {
+  const auto* words = reinterpret_cast<const std::uint32_t*>(data.data());
+  std::uint64_t nwords = data.size() / sizeof(std::uint32_t);
+  if (nwords < 4)
+    return false;
+
+  std::uint32_t nbuckets = words[0];
+  m_symoffset_ = words[1];
+  std::uint32_t bloom_size = words[2];
+  m_bloom_shift_ = words[3];
+
+  // bloom words are 64 bits wide for ELFCLASS64
+  std::uint64_t used = 4 + 2 * static_cast<std::uint64_t>(bloom_size);
+  if (nbuckets == 0 || bloom_size == 0 || used + nbuckets > nwords)
+    return false;
+
+  m_bloom_ = Span<std::uint64_t>(
+      reinterpret_cast<const std::uint64_t*>(words + 4), bloom_size);
+  m_buckets_ = Span<std::uint32_t>(words + used, nbuckets);
+  used += nbuckets;
+  m_chain_ = Span<std::uint32_t>(words + used, nwords - used);
+  return true;
+}
+
+// nbucket, nchain, bucket[nbucket], chain[nchain]
+bool SymbolHash::InitSysv(Span<char> data) {
+  const auto* words = reinterpret_cast<const std::uint32_t*>(data.data());
+  std::uint64_t nwords = data.size() / sizeof(std::uint32_t);
+  if (nwords < 2)
+    return false;
+
+  std::uint32_t nbucket = words[0];
+  std::uint32_t nchain = words[1];
+  if (nbucket == 0 || 2 + static_cast<std::uint64_t>(nbucket) + nchain > nwords)
+    return false;
+
+  m_buckets_ = Span<std::uint32_t>(words + 2, nbucket);
+  m_chain_ = Span<std::uint32_t>(words + 2 + nbucket, nchain);
+  return true;
+}
+
+std::uint32_t SymbolHash::Find(std::string_view name,
+                               Span<SymbolTab> symbols,
+                               const StringTab& strtab) const {
+  switch (m_type_) {
+    case SHType::SHT_GNU_HASH:
+      return FindGnu(name, symbols, strtab);
+    case SHType::SHT_HASH:
+      return FindSysv(name, symbols, strtab);
+    default:
+      return kNoSymbol;
+  }
+}
+
+std::uint32_t SymbolHash::FindGnu(std::string_view name,
+                                  Span<SymbolTab> symbols,
+                                  const StringTab& strtab) const {
+  if (m_buckets_.empty())
+    return kNoSymbol;
+
+  const std::uint32_t h = GnuHash(name);
+
+  // the bloom filter rejects most misses with a single load
+  std::uint64_t word = m_bloom_[(h / 64) % m_bloom_.size()];
+  std::uint64_t mask =
+      (1ULL << (h % 64)) | (1ULL << ((h >> m_bloom_shift_) % 64));
+  if ((word & mask) != mask)
+    return kNoSymbol;
+
+  std::uint32_t idx = m_buckets_[h % m_buckets_.size()];
+  if (idx < m_symoffset_)
+    return kNoSymbol;
+
+  // the chain holds the hashes of consecutive symbols, the low bit marks the
+  // last one of a bucket
+  for (; idx < symbols.size() && idx - m_symoffset_ < m_chain_.size(); idx++) {
+    std::uint32_t h2 = m_chain_[idx - m_symoffset_];
+    if ((h | 1) == (h2 | 1) && strtab.Get(symbols[idx].Name()) == name)
+      return idx;
+    if (h2 & 1)
+      break;
+  }
+  return kNoSymbol;
+}
+
+std::uint32_t SymbolHash::FindSysv(std::string_view name,
+                                   Span<SymbolTab> symbols,
+                                   const StringTab& strtab) const {
+  if (m_buckets_.empty())
+    return kNoSymbol;
+
+  std::uint32_t idx = m_buckets_[SysvHash(name) % m_buckets_.size()];
+  // a corrupt chain could loop, it cannot be longer than the table
+  for (std::size_t steps = 0; idx != 0 && steps < m_chain_.size(); steps++) {
+    if (idx >= symbols.size() || idx >= m_chain_.size())
+      break;
+    if (strtab.Get(symbols[idx].Name()) == name)
+      return idx;
+    idx = m_chain_[idx];
+  }
+  return kNoSymbol;
+}
+
+}  // namespace xorg
@@ -0,0 +1,512 @@
+/**
+ * Copyright 2022 hupeng.
+ * SPDX-License-Identifier: MIT
+ */
+#include "symbol_server.h"
+
+#include <spdlog/fmt/fmt.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <spdlog/spdlog.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "scanner.h"
+
+namespace xorg {
+
+// larger frames are refused, 8M addresses fit
+static const std::uint32_t kMaxFrame = 64u << 20;
+// what a symbol costs in the AddressIndex and the SymbolColumns
+static const std::uint64_t kBytesPerSymbol = 64;
+
+enum class KeyKind : std::uint8_t {
+  kPath = 0,
+  kBuildId = 1,
+};
+
+static bool Stat(const std::string& path, struct stat* st) {
+  return stat(path.c_str(), st) == 0 && S_ISREG(st->st_mode);
+}
+
+static std::uint64_t MTime(const struct stat& st) {
+  return st.st_mtim.tv_sec * 1000000000ull + st.st_mtim.tv_nsec;
+}
+
+static bool SameFile(const LoadedBinary& binary, const struct stat& st) {
+  return binary.dev == st.st_dev && binary.ino == st.st_ino &&
+         binary.size == static_cast<std::uint64_t>(st.st_size) &&
+         binary.mtime == MTime(st);
+}
+
+static std::string Hex(const std::uint8_t* data, std::size_t size) {
+  fmt::memory_buffer hex;
+  for (std::size_t i = 0; i < size; i++) {
+    fmt::format_to(fmt::appender(hex), "{:02x}", data[i]);
+  }
+  return fmt::to_string(hex);
+}
+
+static std::shared_ptr<const LoadedBinary> Load(const std::string& path,
+                                                const struct stat& st) {
+  if (!Scanner::IsElf(path))
+    return nullptr;
+
+  auto binary = std::make_shared<LoadedBinary>();
+  binary->elf = std::make_unique<Elf>(path);
+  if (!binary->elf->Parse())
+    return nullptr;
+  binary->index.Build(*binary->elf);
+
+  // decode the string table and the notes now, lookups only read them
+  auto symbols = binary->elf->Symbols();
+  if (!symbols.empty())
+    binary->elf->SymbolName(symbols[0]);
+  auto build_id = binary->elf->BuildId();
+  binary->build_id = Hex(build_id.data(), build_id.size());
+
+  binary->dev = st.st_dev;
+  binary->ino = st.st_ino;
+  binary->size = st.st_size;
+  binary->mtime = MTime(st);
+  binary->bytes = binary->size + kBytesPerSymbol * symbols.size();
+  return binary;
+}
+
+std::shared_ptr<const LoadedBinary> BinaryCache::Get(const std::string& path) {
+  struct stat st;
+  if (!Stat(path, &st))
+    return nullptr;
+
+  std::promise<std::shared_ptr<const LoadedBinary>> loaded;
+  std::list<Entry>::iterator entry;
+  {
+    std::unique_lock<std::mutex> lock(m_mutex_);
+    auto it = m_entries_.find(path);
+    if (it != m_entries_.end()) {
+      entry = it->second;
+      // a file rebuilt since it was loaded is loaded again
+      if (entry->bytes == 0 || SameFile(*entry->binary.get(), st)) {
+        m_lru_.splice(m_lru_.begin(), m_lru_, entry);
+        auto future = entry->binary;
+        lock.unlock();
+        return future.get();
+      }
+      m_bytes_ -= entry->bytes;
+      m_lru_.erase(entry);
+      m_entries_.erase(it);
+    }
+    m_lru_.push_front({path, loaded.get_future().share(), 0});
+    entry = m_lru_.begin();
+    m_entries_.emplace(path, entry);
+  }
+
+  // loaded outside the lock, other paths go on meanwhile; entries being
+  // loaded are not evicted, `entry` stays valid
+  auto binary = Load(path, st);
+  loaded.set_value(binary);
+
+  std::lock_guard<std::mutex> lock(m_mutex_);
+  if (binary == nullptr) {
+    // not kept, the file may be fixed by the next request
+    m_entries_.erase(path);
+    m_lru_.erase(entry);
+    return nullptr;
+  }
+  entry->bytes = binary->bytes;
+  m_bytes_ += entry->bytes;
+  Evict();
+  return binary;
+}
+
+void BinaryCache::Evict() {
+  // the most recently used entry stays even when it alone is over budget
+  auto it = m_lru_.end();
+  while (m_bytes_ > m_budget_ && it != m_lru_.begin()) {
+    --it;
+    if (it == m_lru_.begin())
+      break;
+    if (it->bytes == 0)
+      continue;
+    spdlog::debug("evicting {}, {} bytes", it->path, it->bytes);
+    m_bytes_ -= it->bytes;
+    m_entries_.erase(it->path);
+    it = m_lru_.erase(it);
+  }
+}
+
+std::size_t BinaryCache::size() const {
+  std::lock_guard<std::mutex> lock(m_mutex_);
+  return m_lru_.size();
+}
+
+std::uint64_t BinaryCache::Bytes() const {
+  std::lock_guard<std::mutex> lock(m_mutex_);
+  return m_bytes_;
+}
+
+// Writes all of `buf` to the non-blocking `fd`, waiting for room as long as
+// the client reads. False when it hung up or the server is stopping.
+static bool WriteAll(int fd,
+                     const void* buf,
+                     std::size_t size,
+                     const std::atomic<bool>& stop) {
+  const auto* p = static_cast<const char*>(buf);
+  while (size > 0) {
+    // a client gone away is an error here, not a SIGPIPE
+    auto n = send(fd, p, size, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      if (stop.load())
+        return false;
+      pollfd out = {fd, POLLOUT, 0};
+      poll(&out, 1, 1000);
+      continue;
+    }
+    if (n <= 0)
+      return false;
+    p += n;
+    size -= n;
+  }
+  return true;
+}
+
+// Wakes the poll thread up through the pipe end `fd`. Only write(2) is
+// called, signal handlers can use it.
+static void Wake(int fd) {
+  if (fd < 0)
+    return;
+  char byte = 0;
+  // a full pipe wakes it up as well
+  while (write(fd, &byte, 1) < 0 && errno == EINTR) {
+  }
+}
+
+template <typename T>
+static void Append(std::string* out, T value) {
+  out->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+static T Take(const std::string& in, std::size_t offset) {
+  T value;
+  std::memcpy(&value, in.data() + offset, sizeof(value));
+  return value;
+}
+
+// a response with no addresses, the size is filled in by Respond()
+static std::string StatusFrame(ServerStatus status) {
+  std::string frame;
+  Append<std::uint32_t>(&frame, 0);
+  Append(&frame, status);
+  frame.append(3, '\0');
+  Append<std::uint32_t>(&frame, 0);
+  Append<std::uint32_t>(&frame, 0);
+  return frame;
+}
+
+SymbolServer::SymbolServer(std::size_t jobs,
+                           std::uint64_t cache_bytes,
+                           const std::string& build_id_dir)
+    : m_jobs_(jobs), m_build_id_dir_(build_id_dir), m_cache_(cache_bytes) {
+  if (pipe2(m_wake_, O_CLOEXEC | O_NONBLOCK) != 0)
+    spdlog::error("pipe: {}", std::strerror(errno));
+}
+
+SymbolServer::~SymbolServer() {
+  for (auto fd : m_wake_) {
+    if (fd >= 0)
+      close(fd);
+  }
+}
+
+bool SymbolServer::Run(const std::string& socket_path) {
+  sockaddr_un addr = {};
+  addr.sun_family = AF_UNIX;
+  if (socket_path.size() >= sizeof(addr.sun_path)) {
+    spdlog::error("socket path {} is too long", socket_path);
+    return false;
+  }
+  std::memcpy(addr.sun_path, socket_path.c_str(), socket_path.size() + 1);
+  if (m_wake_[0] < 0)
+    return false;
+
+  // a socket left by a server that is gone, never any other file
+  struct stat st;
+  if (lstat(socket_path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode))
+    unlink(socket_path.c_str());
+
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+  if (fd < 0 ||
+      bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+      listen(fd, SOMAXCONN) != 0) {
+    spdlog::error("cannot listen on {}: {}", socket_path, std::strerror(errno));
+    if (fd >= 0)
+      close(fd);
+    return false;
+  }
+
+  ThreadPool pool(m_jobs_);
+  spdlog::info("listening on {}, {} threads", socket_path, pool.size());
+
+  std::unordered_map<int, Connection> connections;
+  std::vector<pollfd> fds;
+  while (!m_stop_.load()) {
+    fds.clear();
+    fds.push_back({fd, POLLIN, 0});
+    fds.push_back({m_wake_[0], POLLIN, 0});
+    for (const auto& it : connections) {
+      if (!it.second.busy)
+        fds.push_back({it.first, POLLIN, 0});
+    }
+    if (poll(fds.data(), fds.size(), -1) < 0) {
+      if (errno == EINTR)
+        continue;
+      spdlog::error("poll: {}", std::strerror(errno));
+      break;
+    }
+
+    // connections whose answer is out, polled again from now on
+    if (fds[1].revents != 0) {
+      char drain[64];
+      while (read(m_wake_[0], drain, sizeof(drain)) > 0) {
+      }
+      std::vector<std::pair<int, bool>> done;
+      {
+        std::lock_guard<std::mutex> lock(m_mutex_);
+        done.swap(m_done_);
+      }
+      for (auto [client, ok] : done) {
+        auto& conn = connections[client];
+        conn.busy = false;
+        if (!ok) {
+          connections.erase(client);
+          close(client);
+          continue;
+        }
+        // a request may have come along with the previous one
+        Dispatch(client, &conn, &pool);
+      }
+    }
+
+    // the connections polled this round, none of them is busy
+    for (std::size_t i = 2; i < fds.size(); i++) {
+      if (fds[i].revents == 0)
+        continue;
+      int client = fds[i].fd;
+      auto& conn = connections[client];
+      if (!Receive(client, &conn)) {
+        connections.erase(client);
+        close(client);
+        continue;
+      }
+      Dispatch(client, &conn, &pool);
+    }
+
+    if (fds[0].revents != 0) {
+      for (;;) {
+        int client =
+            accept4(fd, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK);
+        if (client < 0) {
+          if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR &&
+              errno != ECONNABORTED)
+            spdlog::warn("accept on {}: {}", socket_path,
+                         std::strerror(errno));
+          break;
+        }
+        connections.emplace(client, Connection());
+      }
+    }
+  }
+
+  close(fd);
+  unlink(socket_path.c_str());
+  // the answers being written are let through, then everyone is hung up on
+  pool.Wait();
+  for (const auto& it : connections) {
+    close(it.first);
+  }
+  spdlog::info("stopped, {} binaries cached, {} bytes", m_cache_.size(),
+               m_cache_.Bytes());
+  return true;
+}
+
+void SymbolServer::Stop() {
+  m_stop_.store(true);
+  Wake(m_wake_[1]);
+}
+
+bool SymbolServer::Receive(int fd, Connection* conn) {
+  char buf[64 << 10];
+  for (;;) {
+    auto n = recv(fd, buf, sizeof(buf), 0);
+    if (n > 0) {
+      conn->in.append(buf, n);
+      continue;
+    }
+    if (n < 0 && errno == EINTR)
+      continue;
+    // all there is for now
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+      return true;
+    return false;
+  }
+}
+
+void SymbolServer::Dispatch(int fd, Connection* conn, ThreadPool* pool) {
+  std::uint32_t size;
+  if (conn->busy || conn->in.size() < sizeof(size))
+    return;
+  std::memcpy(&size, conn->in.data(), sizeof(size));
+
+  conn->busy = true;
+  if (size > kMaxFrame) {
+    // refused, and the connection with it: the stream cannot be resynced
+    pool->Submit([this, fd]() {
+      auto frame = StatusFrame(ServerStatus::kBadRequest);
+      std::uint32_t rest = frame.size() - sizeof(std::uint32_t);
+      std::memcpy(&frame[0], &rest, sizeof(rest));
+      WriteAll(fd, frame.data(), frame.size(), m_stop_);
+      Done(fd, false);
+    });
+    return;
+  }
+  if (conn->in.size() - sizeof(size) < size) {
+    conn->busy = false;
+    return;
+  }
+
+  auto body = conn->in.substr(sizeof(size), size);
+  conn->in.erase(0, sizeof(size) + size);
+  pool->Submit(
+      [this, fd, body = std::move(body)]() { Respond(fd, body); });
+}
+
+void SymbolServer::Respond(int fd, const std::string& body) {
+  auto start = std::chrono::steady_clock::now();
+  auto frame = Answer(body);
+  std::uint32_t rest = frame.size() - sizeof(std::uint32_t);
+  std::memcpy(&frame[0], &rest, sizeof(rest));
+  bool ok = WriteAll(fd, frame.data(), frame.size(), m_stop_);
+  spdlog::debug("answered {} bytes in {} us", frame.size(),
+                std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - start)
+                    .count());
+  Done(fd, ok);
+}
+
+void SymbolServer::Done(int fd, bool ok) {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex_);
+    m_done_.emplace_back(fd, ok);
+  }
+  Wake(m_wake_[1]);
+}
+
+std::string SymbolServer::Answer(const std::string& body) {
+  // kind, reserved, key size
+  static const std::size_t kKeyOffset = 4;
+  if (body.size() < kKeyOffset)
+    return StatusFrame(ServerStatus::kBadRequest);
+  auto kind = Take<std::uint8_t>(body, 0);
+  auto key_size = Take<std::uint16_t>(body, 2);
+  auto addrs_offset = kKeyOffset + key_size + sizeof(std::uint32_t);
+  if (body.size() < addrs_offset)
+    return StatusFrame(ServerStatus::kBadRequest);
+  auto count = Take<std::uint32_t>(body, addrs_offset - sizeof(std::uint32_t));
+  if (body.size() - addrs_offset != count * sizeof(std::uint64_t))
+    return StatusFrame(ServerStatus::kBadRequest);
+
+  if (kind != static_cast<std::uint8_t>(KeyKind::kPath) &&
+      kind != static_cast<std::uint8_t>(KeyKind::kBuildId))
+    return StatusFrame(ServerStatus::kBadRequest);
+
+  auto binary = Resolve(kind, body.substr(kKeyOffset, key_size));
+  if (binary == nullptr)
+    return StatusFrame(ServerStatus::kNotFound);
+
+  // the addresses may sit anywhere in the frame, copy them to align them
+  std::vector<std::uint64_t> addrs(count);
+  std::memcpy(addrs.data(), body.data() + addrs_offset,
+              count * sizeof(std::uint64_t));
+  auto hits = binary->index.Lookup(Span<std::uint64_t>(addrs.data(), count));
+
+  // each name is sent once however many addresses it covers
+  const auto& elf = *binary->elf;
+  auto symbols = elf.Symbols();
+  std::unordered_map<std::uint32_t, std::uint32_t> names;
+  std::vector<std::uint32_t> order;
+  for (const auto& hit : hits) {
+    if (hit.Found() && names.emplace(hit.symbol, names.size()).second)
+      order.push_back(hit.symbol);
+  }
+
+  std::string frame = StatusFrame(ServerStatus::kOk);
+  std::memcpy(&frame[8], &count, sizeof(count));
+  std::uint32_t name_count = order.size();
+  std::memcpy(&frame[12], &name_count, sizeof(name_count));
+  for (auto symbol : order) {
+    auto name = elf.SymbolName(symbols[symbol]);
+    Append<std::uint32_t>(&frame, name.size());
+    frame.append(name.data(), name.size());
+  }
+  frame.reserve(frame.size() + count * 12);
+  for (const auto& hit : hits) {
+    if (hit.Found()) {
+      Append<std::uint32_t>(&frame, names[hit.symbol]);
+      Append<std::uint64_t>(&frame, hit.offset);
+    } else {
+      Append<std::uint32_t>(&frame, SymbolHit::kNoSymbol);
+      Append<std::uint64_t>(&frame, 0);
+    }
+  }
+  return frame;
+}
+
+std::shared_ptr<const LoadedBinary> SymbolServer::Resolve(
+    std::uint8_t kind,
+    const std::string& key) {
+  if (kind == static_cast<std::uint8_t>(KeyKind::kPath)) {
+    auto binary = m_cache_.Get(key);
+    if (binary != nullptr && !binary->build_id.empty()) {
+      std::lock_guard<std::mutex> lock(m_mutex_);
+      m_build_ids_[binary->build_id] = key;
+    }
+    return binary;
+  }
+  if (key.empty())
+    return nullptr;
+
+  auto build_id =
+      Hex(reinterpret_cast<const std::uint8_t*>(key.data()), key.size());
+  std::string path;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex_);
+    auto it = m_build_ids_.find(build_id);
+    if (it != m_build_ids_.end())
+      path = it->second;
+  }
+  // the file known by this build-id may have been rebuilt since
+  if (!path.empty()) {
+    auto binary = m_cache_.Get(path);
+    if (binary != nullptr && binary->build_id == build_id)
+      return binary;
+  }
+
+  path = fmt::format("{}/{}/{}.debug", m_build_id_dir_, build_id.substr(0, 2),
+                     build_id.substr(2));
+  auto binary = m_cache_.Get(path);
+  if (binary == nullptr || binary->build_id != build_id)
+    return nullptr;
+  return binary;
+}
+
+}  // namespace xorg
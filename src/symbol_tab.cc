@@ -4,48 +4,66 @@
  */
 #include "symbol_tab.h"
 
-#include <spdlog/spdlog.h>
 #include <cstdint>
-#include <iomanip>
-#include <ios>
 #include <map>
-#include <sstream>
 #include <string>
+#include <string_view>
 
 #include "common.h"
 #include "elf_spec.h"
+#include "output.h"
 
 namespace xorg {
 
-void SymbolTab::PrintHeader(std::uint32_t size) {
-  spdlog::info("Symbol table '.symtab' contains {} entries:", size);
-  std::stringstream ss;
-  ss << std::right << std::setw(6) << std::setfill(' ') << "Num"
-     << ":    "
-     << "Value" << std::setw(14) << std::setfill(' ') << "Size"
-     << " " << std::left << std::setw(8) << std::setfill(' ') << "Type"
-     << std::setw(7) << "Bind" << std::setw(9) << "Vis"
-     << "Ndx Name";
-
-  spdlog::info("{}", ss.str());
-}
+static const std::string kUnknown("UKN");
 
-void SymbolTab::Print() const {
-  std::stringstream ss;
+void SymbolTab::PrintHeader(Output& out,
+                            std::string_view section,
+                            std::uint32_t size) {
+  if (!out.IsTable())
+    return;
 
-  ss << std::right << std::setw(6) << std::setfill(' ') << std::dec << m_num_
-     << ": " << std::setw(16) << std::setfill('0') << std::hex << st_value
-     << " " << std::setw(5) << std::setfill(' ') << std::dec << st_size << " "
-     << std::left << std::setw(7) << GetType() << " " << std::setw(6)
-     << GetBind() << " " << std::setw(8) << GetVisible() << " " << std::right
-     << std::setw(3) << GetShndx() << " " << m_name_.substr(0, 25);
-  spdlog::info("{}", ss.str());
+  out.Print("Symbol table '{}' contains {} entries:\n", section, size);
+  out.Print("{:>6}:    Value{:>14} {:<8}{:<7}{:<9}Ndx Name\n", "Num", "Size",
+            "Type", "Bind", "Vis");
 }
 
-void SymbolTab::Parse() {
-  m_type_ = static_cast<STType>(st_info & 0xf);
-  m_bind_ = static_cast<STBind>(st_info >> 4);
-  m_visible_ = static_cast<STVisable>(st_other & 0x03);
+void SymbolTab::Print(Output& out,
+                      std::string_view table,
+                      std::uint32_t num,
+                      std::string_view name,
+                      const SymbolVersion& version) const {
+  char buf[8];
+  std::string_view ndx = GetShndx(buf, sizeof(buf));
+  // the symbols defining a version carry its name already
+  bool versioned = !version.name.empty() && version.name != name;
+
+  if (!out.IsTable()) {
+    out.BeginRecord();
+    out.Field("table", table);
+    out.Field("num", num);
+    out.HexField("value", st_value);
+    out.Field("size", st_size);
+    out.Field("type", GetType());
+    out.Field("bind", GetBind());
+    out.Field("vis", GetVisible());
+    out.Field("ndx", ndx);
+    out.Field("name", name);
+    out.Field("version", versioned ? version.name : std::string_view());
+    out.Flag("default_version", versioned && version.is_default);
+    out.EndRecord();
+    return;
+  }
+
+  if (versioned) {
+    out.Print("{:>6}: {:016x} {:>5} {:<7} {:<6} {:<8} {:>3} {}{}{}\n", num,
+              st_value, st_size, GetType(), GetBind(), GetVisible(), ndx,
+              name.substr(0, 25), version.Separator(), version.name);
+  } else {
+    out.Print("{:>6}: {:016x} {:>5} {:<7} {:<6} {:<8} {:>3} {}\n", num,
+              st_value, st_size, GetType(), GetBind(), GetVisible(), ndx,
+              name.substr(0, 25));
+  }
 }
 
 const std::string& SymbolTab::GetType() const {
@@ -56,7 +74,7 @@ const std::string& SymbolTab::GetType() const {
       {STType::STT_TLS, "TLS"},
   };
 
-  return GetMapValWithDef(typeMap, m_type_, std::string("UKN"));
+  return GetMapValWithDef(typeMap, Type(), kUnknown);
 }
 
 const std::string& SymbolTab::GetBind() const {
@@ -65,7 +83,7 @@ const std::string& SymbolTab::GetBind() const {
       {STBind::STB_GLOBAL, "GLOBAL"},
       {STBind::STB_WEAK, "WEAK"},
   };
-  return GetMapValWithDef(bindMap, m_bind_, std::string("UKN"));
+  return GetMapValWithDef(bindMap, Bind(), kUnknown);
 }
 
 const std::string& SymbolTab::GetVisible() const {
@@ -75,29 +93,24 @@ const std::string& SymbolTab::GetVisible() const {
       {STVisable::STV_HIDDEN, "HIDDEN"},
       {STVisable::STV_PROTECTED, "PROTECT"},
   };
-  return GetMapValWithDef(visibleMap, m_visible_, std::string("UKN"));
+  return GetMapValWithDef(visibleMap, Visible(), kUnknown);
 }
 
-const std::string SymbolTab::GetShndx() const {
-  std::stringstream ss;
-
+std::string_view SymbolTab::GetShndx(char* buf, std::size_t size) const {
   switch (static_cast<SHNdx>(st_shndx)) {
     case SHNdx::SHN_UNDEF:
-      ss << "UND";
-      break;
+      return "UND";
     case SHNdx::SHN_ABS:
-      ss << "ABS";
-      break;
+      return "ABS";
     case SHNdx::SHN_COMMON:
-      ss << "CMN";
-      break;
+      return "CMN";
     case SHNdx::SHN_XINDEX:
     default:
-      ss << st_shndx;
       break;
   }
 
-  return ss.str();
+  auto result = fmt::format_to_n(buf, size, "{}", st_shndx);
+  return std::string_view(buf, result.size);
 }
 
 }  // namespace xorg
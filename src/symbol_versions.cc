@@ -0,0 +1,95 @@
+/**
+ * Copyright 2022 hupeng.
+ * SPDX-License-Identifier: MIT
+ */
+#include "symbol_versions.h"
+
+#include <cstdint>
+
+#include "elf_spec.h"
+
+namespace xorg {
+
+// Returns the T at `offset` in `data`, or nullptr if it does not fit.
+template <class T>
+static const T* At(Span<char> data, std::uint64_t offset) {
+  if (offset > data.size() || sizeof(T) > data.size() - offset)
+    return nullptr;
+  return reinterpret_cast<const T*>(data.data() + offset);
+}
+
+void SymbolVersions::AddDefinitions(Span<char> verdef,
+                                    std::uint32_t count,
+                                    const StringTab& strtab) {
+  std::uint64_t offset = 0;
+  for (std::uint32_t i = 0; i < count; i++) {
+    const auto* vd = At<Elf64_Verdef>(verdef, offset);
+    if (vd == nullptr)
+      break;
+
+    // the first aux entry names the version, the others its parents
+    const auto* vda = At<Elf64_Verdaux>(verdef, offset + vd->vd_aux);
+    if (vda != nullptr && !(vd->vd_flags & VER_FLG_BASE))
+      SetName(vd->vd_ndx, strtab.Get(vda->vda_name), true);
+
+    if (vd->vd_next == 0)
+      break;
+    offset += vd->vd_next;
+  }
+}
+
+void SymbolVersions::AddNeeds(Span<char> verneed,
+                              std::uint32_t count,
+                              const StringTab& strtab) {
+  std::uint64_t offset = 0;
+  for (std::uint32_t i = 0; i < count; i++) {
+    const auto* vn = At<Elf64_Verneed>(verneed, offset);
+    if (vn == nullptr)
+      break;
+
+    std::uint64_t aux = offset + vn->vn_aux;
+    for (std::uint16_t j = 0; j < vn->vn_cnt; j++) {
+      const auto* vna = At<Elf64_Vernaux>(verneed, aux);
+      if (vna == nullptr)
+        break;
+
+      SetName(vna->vna_other, strtab.Get(vna->vna_name), false);
+      if (vna->vna_next == 0)
+        break;
+      aux += vna->vna_next;
+    }
+
+    if (vn->vn_next == 0)
+      break;
+    offset += vn->vn_next;
+  }
+}
+
+void SymbolVersions::SetName(std::uint16_t idx,
+                             std::string_view name,
+                             bool defined) {
+  idx &= VERSYM_VERSION;
+  if (idx >= m_names_.size()) {
+    m_names_.resize(idx + 1);
+    m_defined_.resize(idx + 1);
+  }
+  m_names_[idx] = name;
+  m_defined_[idx] = defined;
+}
+
+SymbolVersion SymbolVersions::Get(std::uint32_t symbol) const {
+  if (symbol >= m_versym_.size())
+    return {};
+
+  std::uint16_t versym = m_versym_[symbol];
+  std::uint16_t idx = versym & VERSYM_VERSION;
+  if (idx <= VER_NDX_GLOBAL || idx >= m_names_.size())
+    return {};
+
+  SymbolVersion version;
+  version.name = m_names_[idx];
+  version.is_default = m_defined_[idx] && !(versym & VERSYM_HIDDEN);
+  return version;
+}
+
+}  // namespace xorg
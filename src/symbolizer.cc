@@ -0,0 +1,100 @@
+/**
+ * Copyright 2022 hupeng.
+ * SPDX-License-Identifier: MIT
+ */
+#include "symbolizer.h"
+
+#include <spdlog/spdlog.h>
+#include <cerrno>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "elf.h"
+#include "line_index.h"
+#include "parse_cache.h"
+
+namespace xorg {
+
+bool ParseAddress(const std::string& str, std::uint64_t* value) {
+  auto begin = str.find_first_not_of(" \t");
+  if (begin == std::string::npos || str[begin] == '-' || str[begin] == '+')
+    return false;
+
+  errno = 0;
+  char* end = nullptr;
+  *value = std::strtoull(str.c_str() + begin, &end, 0);
+  if (errno != 0 || end == str.c_str() + begin)
+    return false;
+  return str.find_first_not_of(" \t\r", end - str.c_str()) ==
+         std::string::npos;
+}
+
+Symbolizer::Symbolizer(const Elf& elf) {
+  m_index_.Build(elf);
+  auto symbols = elf.Symbols();
+  m_name_of_ = [&elf, symbols](std::uint32_t row) {
+    return elf.SymbolName(symbols[row]);
+  };
+}
+
+Symbolizer::Symbolizer(const CachedParse& cached) {
+  m_index_.Build(cached.Columns());
+  m_name_of_ = [&cached](std::uint32_t row) {
+    return cached.SymbolName(row);
+  };
+}
+
+std::vector<std::uint64_t> Symbolizer::ReadAddresses(std::istream& in,
+                                                     std::string_view source) {
+  std::vector<std::uint64_t> addrs;
+  std::string line;
+  std::size_t line_no = 0;
+  while (std::getline(in, line)) {
+    line_no++;
+    if (line.find_first_not_of(" \t\r") == std::string::npos)
+      continue;
+    std::uint64_t addr;
+    if (!ParseAddress(line, &addr)) {
+      spdlog::warn("{}:{}: not an address: {}", source, line_no, line);
+      continue;
+    }
+    addrs.push_back(addr);
+  }
+  return addrs;
+}
+
+void Symbolizer::Print(Span<std::uint64_t> addrs, Output& out) const {
+  auto hits = m_index_.Lookup(addrs);
+  for (std::size_t i = 0; i < addrs.size(); i++) {
+    std::string_view name;
+    if (hits[i].Found())
+      name = m_name_of_(hits[i].symbol);
+    LineInfo line_info;
+    if (m_lines_ != nullptr)
+      line_info = m_lines_->Lookup(addrs[i]);
+
+    if (!out.IsTable()) {
+      out.BeginRecord();
+      out.HexField("address", addrs[i]);
+      out.Field("symbol", name);
+      out.HexField("offset", hits[i].Found() ? hits[i].offset : 0);
+      if (m_lines_ != nullptr) {
+        out.Field("file", line_info.file);
+        out.Field("line", line_info.line);
+      }
+      out.EndRecord();
+      continue;
+    }
+
+    if (hits[i].Found())
+      out.Print("{:#x} {}+{:#x}", addrs[i], name, hits[i].offset);
+    else
+      out.Print("{:#x} ??", addrs[i]);
+    if (line_info.Found())
+      out.Print(" at {}:{}", line_info.file, line_info.line);
+    out.Print("\n");
+  }
+}
+
+}  // namespace xorg
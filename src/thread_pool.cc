@@ -0,0 +1,110 @@
+/**
+ * Copyright 2022 hupeng.
+ * SPDX-License-Identifier: MIT
+ */
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace xorg {
+
+// pool and worker id of the current thread, t_pool is null outside a pool
+static thread_local const ThreadPool* t_pool = nullptr;
+static thread_local std::size_t t_worker = 0;
+
+ThreadPool::ThreadPool(std::size_t threads) {
+  if (threads == 0)
+    threads = std::max(1U, std::thread::hardware_concurrency());
+
+  for (std::size_t i = 0; i < threads; i++) {
+    m_queues_.push_back(std::make_unique<Queue>());
+  }
+  for (std::size_t i = 0; i < threads; i++) {
+    m_threads_.emplace_back([this, i] { Run(i); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex_);
+    m_stop_ = true;
+  }
+  m_work_cv_.notify_all();
+
+  for (auto& thread : m_threads_) {
+    thread.join();
+  }
+}
+
+void ThreadPool::Submit(std::function<void()> task) {
+  std::size_t id = (t_pool == this)
+                       ? t_worker
+                       : m_next_.fetch_add(1) % m_queues_.size();
+
+  // counted under m_mutex_ so that an idle worker cannot miss the wakeup,
+  // and before the push so that Pop() never takes the count below zero
+  m_pending_++;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex_);
+    m_queued_++;
+  }
+  {
+    std::lock_guard<std::mutex> lock(m_queues_[id]->mutex);
+    m_queues_[id]->tasks.push_back(std::move(task));
+  }
+  m_work_cv_.notify_one();
+}
+
+void ThreadPool::Wait() {
+  std::unique_lock<std::mutex> lock(m_mutex_);
+  m_done_cv_.wait(lock, [this] { return m_pending_ == 0; });
+}
+
+void ThreadPool::Run(std::size_t id) {
+  t_pool = this;
+  t_worker = id;
+
+  std::function<void()> task;
+  while (true) {
+    if (Pop(id, task)) {
+      task();
+      task = nullptr;
+
+      if (--m_pending_ == 0) {
+        std::lock_guard<std::mutex> lock(m_mutex_);
+        m_done_cv_.notify_all();
+      }
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex_);
+    m_work_cv_.wait(lock, [this] { return m_stop_ || m_queued_ > 0; });
+    if (m_stop_ && m_queued_ == 0)
+      return;
+  }
+}
+
+bool ThreadPool::Pop(std::size_t id, std::function<void()>& task) {
+  const std::size_t n = m_queues_.size();
+  for (std::size_t i = 0; i < n; i++) {
+    auto& queue = *m_queues_[(id + i) % n];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty())
+      continue;
+
+    // own work in submission order, stolen work from the other end
+    if (i == 0) {
+      task = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+    } else {
+      task = std::move(queue.tasks.back());
+      queue.tasks.pop_back();
+    }
+    m_queued_--;
+    return true;
+  }
+  return false;
+}
+
+}  // namespace xorg